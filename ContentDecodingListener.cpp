@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ContentDecodingListener.h"
+
+#include <zlib.h>
+
+#include "HttpAscii.h"
+
+namespace
+{
+
+std::string_view trim(std::string_view value) noexcept
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        value.remove_suffix(1);
+    return value;
+}
+
+constexpr int GzipWindowBits = 16 + MAX_WBITS;
+constexpr int ZlibWindowBits = MAX_WBITS;
+constexpr int RawDeflateWindowBits = -MAX_WBITS;
+
+} // namespace
+
+ContentDecodingListener::ContentDecodingListener(HttpListener* next,
+                                                 std::function<void()> error,
+                                                 size_t bufferSize,
+                                                 size_t maxRatio):
+    _next(next),
+    _error(std::move(error)),
+    _bufferSize(bufferSize),
+    _maxRatio(maxRatio),
+    _buffer(std::make_unique<char[]>(bufferSize))
+{
+}
+
+ContentDecodingListener::~ContentDecodingListener()
+{
+    if (_stream)
+        inflateEnd(_stream.get());
+}
+
+void ContentDecodingListener::reset() noexcept
+{
+    _encoding = Encoding::Identity;
+    _state = State::Passthrough;
+    _firstChunk = true;
+    _hasLeadByte = false;
+}
+
+bool ContentDecodingListener::startInflating(int windowBits) noexcept
+{
+    if (!_stream)
+    {
+        _stream = std::make_unique<z_stream>();
+        if (inflateInit2(_stream.get(), windowBits) != Z_OK)
+        {
+            _stream.reset();
+            return false;
+        }
+    }
+    else if (inflateReset2(_stream.get(), windowBits) != Z_OK)
+        return false;
+
+    _state = State::Inflating;
+    return true;
+}
+
+void ContentDecodingListener::fail()
+{
+    _state = State::Failed;
+
+    if (_error)
+        _error();
+}
+
+void ContentDecodingListener::onProxyHeader(HttpProxyHeader const& header)
+{
+    _next->onProxyHeader(header);
+}
+
+void ContentDecodingListener::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version)
+{
+    reset();
+    _next->onMessageBegin(method, entity, version);
+}
+
+void ContentDecodingListener::onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text)
+{
+    reset();
+    _next->onMessageBegin(version, code, text);
+}
+
+void ContentDecodingListener::onMessageBegin()
+{
+    reset();
+    _next->onMessageBegin();
+}
+
+void ContentDecodingListener::onMessageHeader(std::string_view name, std::string_view value)
+{
+    if (iequals(name, "Content-Encoding"))
+    {
+        auto const coding = trim(value);
+        if (iequals(coding, "gzip") || iequals(coding, "x-gzip"))
+            _encoding = Encoding::Gzip;
+        else if (iequals(coding, "deflate"))
+            _encoding = Encoding::Deflate;
+        else
+            _encoding = Encoding::Identity; // forwarded as is, including codings we do not support
+    }
+
+    _next->onMessageHeader(name, value);
+}
+
+void ContentDecodingListener::onMessageHeaderEnd()
+{
+    switch (_encoding)
+    {
+        case Encoding::Gzip:
+            if (!startInflating(GzipWindowBits))
+                fail();
+            break;
+        case Encoding::Deflate: _state = State::Detecting; break;
+        case Encoding::Identity: break;
+    }
+
+    _next->onMessageHeaderEnd();
+}
+
+bool ContentDecodingListener::onExpectContinue()
+{
+    return _next->onExpectContinue();
+}
+
+void ContentDecodingListener::onMessageContent(std::string_view chunk)
+{
+    switch (_state)
+    {
+        case State::Passthrough: _next->onMessageContent(chunk); return;
+        case State::Finished:
+        case State::Failed: return; // trailing garbage, or the rest of a rejected body
+        case State::Detecting: detectDeflate(chunk); return;
+        case State::Inflating: inflateChunk(chunk); return;
+    }
+}
+
+/// Tells zlib-wrapped from raw deflate data by the first two bytes of the body, then inflates it.
+void ContentDecodingListener::detectDeflate(std::string_view chunk)
+{
+    if (chunk.empty())
+        return;
+
+    _firstChunk = false;
+    if (!_hasLeadByte && chunk.size() < 2)
+    {
+        _leadByte = chunk.front();
+        _hasLeadByte = true;
+        return;
+    }
+
+    // "deflate" is frequently sent as raw deflate data, lacking the zlib wrapper
+    auto const cmf = static_cast<unsigned char>(_hasLeadByte ? _leadByte : chunk[0]);
+    auto const flg = static_cast<unsigned char>(_hasLeadByte ? chunk[0] : chunk[1]);
+    auto const zlibWrapped =
+        (cmf & 0x0F) == Z_DEFLATED && (cmf >> 4) + 8 <= MAX_WBITS && (cmf << 8 | flg) % 31 == 0;
+
+    if (!startInflating(zlibWrapped ? ZlibWindowBits : RawDeflateWindowBits))
+    {
+        fail();
+        return;
+    }
+
+    if (_hasLeadByte)
+    {
+        _hasLeadByte = false;
+        inflateChunk(std::string_view(&_leadByte, 1));
+        if (_state != State::Inflating)
+            return;
+    }
+    inflateChunk(chunk);
+}
+
+void ContentDecodingListener::inflateChunk(std::string_view chunk)
+{
+    auto& stream = *_stream;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(chunk.data()));
+    stream.avail_in = static_cast<uInt>(chunk.size());
+    _firstChunk = false;
+
+    // a full output buffer may leave output within zlib even once all input has been consumed
+    do
+    {
+        stream.next_out = reinterpret_cast<Bytef*>(_buffer.get());
+        stream.avail_out = static_cast<uInt>(_bufferSize);
+
+        auto const result = inflate(&stream, Z_NO_FLUSH);
+
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+        {
+            fail();
+            return;
+        }
+
+        if (_maxRatio != 0 && stream.total_out > _bufferSize
+            && stream.total_out / _maxRatio > stream.total_in)
+        {
+            fail();
+            return;
+        }
+
+        auto const produced = _bufferSize - stream.avail_out;
+        if (produced)
+            _next->onMessageContent(std::string_view(_buffer.get(), produced));
+
+        if (result == Z_STREAM_END)
+        {
+            _state = State::Finished;
+            return;
+        }
+
+        if (result == Z_BUF_ERROR)
+            return; // no progress possible without more input
+    } while (stream.avail_in > 0 || stream.avail_out == 0);
+}
+
+void ContentDecodingListener::onMessageEnd()
+{
+    if ((_state == State::Inflating || _state == State::Detecting) && !_firstChunk)
+        fail(); // truncated; a body that is missing altogether (e.g. responses to HEAD) is fine though
+
+    _next->onMessageEnd();
+}
+
+void ContentDecodingListener::onProtocolError()
+{
+    _next->onProtocolError();
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "HttpMessageParser.h"
+
+struct z_stream_s;
+
+/// HttpListener adapter decoding gzip and deflate message bodies on the fly.
+///
+/// It sits between the HttpParser and the actual listener, forwarding all events as they are, except
+/// for the content of messages with a Content-Encoding of gzip, x-gzip or deflate: that is inflated
+/// incrementally into one fixed-size output buffer, which is handed on via onMessageContent() every time
+/// it fills up. Memory use thus stays constant, no matter the size of a body. Headers are forwarded
+/// unmodified, i.e. Content-Encoding and Content-Length still describe the encoded body.
+///
+/// A body is rejected if it is malformed, truncated, or inflates more than maxRatio times its encoded
+/// size (decompression bombs). The error callback is invoked then, and the rest of that body is dropped;
+/// the listener still sees onMessageEnd().
+class ContentDecodingListener: public HttpListener
+{
+  public:
+    static constexpr size_t DefaultBufferSize = 16 * 1024;
+    static constexpr size_t DefaultMaxRatio = 100;
+
+    /// @param next        listener receiving all (decoded) events
+    /// @param error       invoked for every body failing to decode
+    /// @param bufferSize  size of the output buffer, i.e. the maximum size of a decoded chunk
+    /// @param maxRatio    maximum ratio of decoded to encoded bytes of a body, or 0 for no limit
+    explicit ContentDecodingListener(HttpListener* next,
+                                     std::function<void()> error = {},
+                                     size_t bufferSize = DefaultBufferSize,
+                                     size_t maxRatio = DefaultMaxRatio);
+    ~ContentDecodingListener() override;
+
+    ContentDecodingListener(ContentDecodingListener const&) = delete;
+    ContentDecodingListener& operator=(ContentDecodingListener const&) = delete;
+
+    /// Whether or not the body of the current message failed to decode.
+    bool failed() const noexcept { return _state == State::Failed; }
+
+    void onProxyHeader(HttpProxyHeader const& header) override;
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override;
+    void onMessageBegin() override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+    bool onExpectContinue() override;
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+  private:
+    enum class Encoding
+    {
+        Identity,
+        Gzip,
+        Deflate,
+    };
+
+    enum class State
+    {
+        Passthrough, //!< body is forwarded as is
+        Detecting,   //!< deflate, with or without zlib wrapper yet to be told
+        Inflating,
+        Finished,    //!< end of the compressed stream has been reached
+        Failed,
+    };
+
+    void reset() noexcept;
+    bool startInflating(int windowBits) noexcept;
+    void detectDeflate(std::string_view chunk);
+    void inflateChunk(std::string_view chunk);
+    void fail();
+
+    HttpListener* _next;
+    std::function<void()> _error;
+    size_t _bufferSize;
+    size_t _maxRatio;
+    std::unique_ptr<char[]> _buffer;
+    std::unique_ptr<z_stream_s> _stream; //!< lazily initialized, then reused across messages
+
+    Encoding _encoding = Encoding::Identity;
+    State _state = State::Passthrough;
+    bool _firstChunk = true;   //!< no content has been received yet
+    bool _hasLeadByte = false; //!< whether _leadByte holds the first byte of a deflate body
+    char _leadByte = 0;
+};
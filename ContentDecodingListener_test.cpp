@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "ContentDecodingListener.h"
+
+namespace
+{
+
+std::string compress(std::string_view input, int windowBits)
+{
+    z_stream stream {};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+
+    std::string output(deflateBound(&stream, static_cast<uLong>(input.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+std::string response(std::string_view encoding, std::string_view body)
+{
+    return "HTTP/1.1 200 Ok\r\n"
+           "Content-Encoding: "
+           + std::string(encoding) + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n"
+           + std::string(body);
+}
+
+struct BodyCollector: public HttpListener
+{
+    std::vector<std::string> bodies;
+    size_t largestChunk = 0;
+
+    void onMessageBegin(HttpVersion, HttpStatus, std::string_view) override { bodies.emplace_back(); }
+    void onMessageContent(std::string_view chunk) override
+    {
+        bodies.back() += chunk;
+        largestChunk = std::max(largestChunk, chunk.size());
+    }
+};
+
+void parse(HttpParser& parser, std::string_view input, size_t fragmentSize)
+{
+    while (!input.empty())
+    {
+        auto fragment = input.substr(0, fragmentSize);
+        input.remove_prefix(fragment.size());
+        while (!fragment.empty())
+            fragment.remove_prefix(parser.parseFragment(fragment));
+    }
+}
+
+} // namespace
+
+TEST_CASE("ContentDecodingListener.decodes")
+{
+    std::string text;
+    for (int i = 0; i < 5000; ++i)
+        text += "line " + std::to_string(i) + "\n";
+
+    BodyCollector collector;
+    int errors = 0;
+    ContentDecodingListener decoder(&collector, [&]() { ++errors; }, 1024);
+    HttpParser parser(HttpParseMode::RESPONSE, &decoder);
+
+    auto const input = response("gzip", compress(text, 16 + MAX_WBITS)) + response("deflate", compress(text, MAX_WBITS))
+                       + response("deflate", compress(text, -MAX_WBITS)) + response("identity", "plain");
+    parse(parser, input, 100);
+
+    REQUIRE(0 == errors);
+    REQUIRE(4 == collector.bodies.size());
+    REQUIRE(text == collector.bodies[0]);
+    REQUIRE(text == collector.bodies[1]);
+    REQUIRE(text == collector.bodies[2]);
+    REQUIRE("plain" == collector.bodies[3]);
+    REQUIRE(collector.largestChunk <= 1024); // bounded by the output buffer
+}
+
+TEST_CASE("ContentDecodingListener.ratioCap")
+{
+    auto const bomb = compress(std::string(1024 * 1024, '\0'), 16 + MAX_WBITS);
+
+    BodyCollector collector;
+    int errors = 0;
+    ContentDecodingListener decoder(&collector, [&]() { ++errors; }, 4096, 100);
+    HttpParser parser(HttpParseMode::RESPONSE, &decoder);
+
+    parse(parser, response("gzip", bomb) + response("gzip", compress("fine", 16 + MAX_WBITS)), 512);
+
+    REQUIRE(1 == errors);
+    REQUIRE(2 == collector.bodies.size());
+    REQUIRE(collector.bodies[0].size() < 1024 * 1024);
+    REQUIRE("fine" == collector.bodies[1]);
+}
+
+TEST_CASE("ContentDecodingListener.unlimitedRatio")
+{
+    auto const text = std::string(1024 * 1024, '\0');
+
+    BodyCollector collector;
+    int errors = 0;
+    ContentDecodingListener decoder(&collector, [&]() { ++errors; }, 4096, 0);
+    HttpParser parser(HttpParseMode::RESPONSE, &decoder);
+
+    parse(parser, response("gzip", compress(text, 16 + MAX_WBITS)), 512);
+
+    REQUIRE(0 == errors);
+    REQUIRE(1 == collector.bodies.size());
+    REQUIRE(text == collector.bodies[0]);
+}
+
+TEST_CASE("ContentDecodingListener.malformed")
+{
+    BodyCollector collector;
+    int errors = 0;
+    ContentDecodingListener decoder(&collector, [&]() { ++errors; });
+    HttpParser parser(HttpParseMode::RESPONSE, &decoder);
+
+    auto const truncated = compress("some text to be truncated", 16 + MAX_WBITS);
+    parse(parser, response("gzip", "not gzip at all") + response("gzip", truncated.substr(0, truncated.size() / 2)), 7);
+
+    REQUIRE(2 == errors);
+    REQUIRE(decoder.failed());
+    REQUIRE(2 == collector.bodies.size());
+}
+
+TEST_CASE("ContentDecodingListener.fragmented")
+{
+    // compresses well, so that single input bytes fill the output buffer
+    std::string text;
+    for (int i = 0; i < 2000; ++i)
+        text += "repeated line " + std::to_string(i % 10) + "\n";
+
+    BodyCollector collector;
+    int errors = 0;
+    ContentDecodingListener decoder(&collector, [&]() { ++errors; }, 256, 1000);
+    HttpParser parser(HttpParseMode::RESPONSE, &decoder);
+
+    auto const input = response("deflate", compress(text, -MAX_WBITS))
+                       + response("deflate", compress(text, MAX_WBITS))
+                       + response("gzip", compress(text, 16 + MAX_WBITS));
+    parse(parser, input, 1);
+
+    REQUIRE(0 == errors);
+    REQUIRE(3 == collector.bodies.size());
+    REQUIRE(text == collector.bodies[0]);
+    REQUIRE(text == collector.bodies[1]);
+    REQUIRE(text == collector.bodies[2]);
+}
+
+TEST_CASE("ContentDecodingListener.expectContinue")
+{
+    struct: HttpListener
+    {
+        int expectations = 0;
+        bool onExpectContinue() override
+        {
+            ++expectations;
+            return false;
+        }
+    } handler;
+    ContentDecodingListener decoder(&handler);
+    HttpParser parser(HttpParseMode::REQUEST, &decoder);
+
+    parser.parseFragment("PUT / HTTP/1.1\r\nExpect: 100-continue\r\nContent-Length: 2\r\n\r\nok");
+    REQUIRE(1 == handler.expectations);
+    REQUIRE(HttpParserState::EXPECT_CONTINUE == parser.state());
+}
+
+TEST_CASE("ContentDecodingListener.proxyHeader")
+{
+    struct: HttpListener
+    {
+        std::string client;
+        void onProxyHeader(HttpProxyHeader const& header) override { client = header.sourceAddress; }
+    } handler;
+    ContentDecodingListener decoder(&handler);
+    HttpParser parser(HttpParseMode::REQUEST, &decoder);
+    parser.expectProxyHeader();
+
+    parser.parseFragment("PROXY TCP4 192.0.2.1 198.51.100.2 56324 443\r\nGET / HTTP/1.1\r\n\r\n");
+    REQUIRE("192.0.2.1" == handler.client);
+    REQUIRE(HttpParserState::PROTOCOL_ERROR != parser.state());
+}
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "EventStreamParser.h"
+
+namespace
+{
+
+constexpr std::string_view ByteOrderMark = "\xEF\xBB\xBF";
+constexpr size_t MaxRetryDigits = 18; // fits into uint64_t
+
+} // namespace
+
+size_t EventStreamParser::parseFragment(std::string_view chunk)
+{
+    if (_failed)
+        return 0;
+
+    size_t offset = 0;
+    if (_skipLf && !chunk.empty())
+    {
+        _skipLf = false;
+        if (chunk.front() == '\n')
+            offset = 1;
+    }
+
+    while (offset < chunk.size())
+    {
+        auto const end = chunk.find_first_of("\r\n", offset);
+        auto const line = chunk.substr(offset, end == std::string_view::npos ? end : end - offset);
+        if (_line.size() + line.size() > _maxEventSize)
+            return fail(offset);
+
+        if (end == std::string_view::npos)
+        {
+            // carried over until its line end arrives
+            _line += line;
+            offset = chunk.size();
+            break;
+        }
+
+        if (_line.empty())
+        {
+            if (!processLine(line))
+                return fail(offset);
+        }
+        else
+        {
+            _line += line;
+            if (!processLine(_line))
+                return fail(offset);
+            retainEvent(); // before the fields pointing into _line are gone
+            _line.clear();
+        }
+
+        offset = end + 1;
+        if (chunk[end] == '\r')
+        {
+            if (offset == chunk.size())
+                _skipLf = true;
+            else if (chunk[offset] == '\n')
+                ++offset;
+        }
+    }
+
+    retainEvent();
+    return offset;
+}
+
+bool EventStreamParser::processLine(std::string_view line)
+{
+    if (_atStart)
+    {
+        _atStart = false;
+        if (line.starts_with(ByteOrderMark))
+            line.remove_prefix(ByteOrderMark.size());
+    }
+
+    if (line.empty())
+    {
+        dispatch();
+        return true;
+    }
+
+    if (line.front() == ':')
+        return true; // comment, e.g. to keep the connection alive
+
+    auto const colon = line.find(':');
+    auto const name = line.substr(0, colon);
+    auto value = colon == std::string_view::npos ? std::string_view() : line.substr(colon + 1);
+    if (value.starts_with(' '))
+        value.remove_prefix(1);
+
+    if (name == "data")
+    {
+        if (!_hasData)
+        {
+            _hasData = true;
+            _data = value;
+            return true;
+        }
+
+        // lines are joined by LF, which takes a buffer of their own
+        if (_data.size() + 1 + value.size() > _maxEventSize)
+            return false;
+        if (!_dataOwned)
+        {
+            _dataBuffer.assign(_data);
+            _dataOwned = true;
+        }
+        _dataBuffer += '\n';
+        _dataBuffer += value;
+        _data = _dataBuffer;
+    }
+    else if (name == "event")
+    {
+        _type = value;
+        _typeOwned = false;
+    }
+    else if (name == "id")
+    {
+        if (value.find('\0') == std::string_view::npos)
+            _id = value;
+    }
+    else if (name == "retry")
+    {
+        if (value.empty() || value.size() > MaxRetryDigits)
+            return true;
+
+        uint64_t milliseconds = 0;
+        for (auto const c: value)
+        {
+            if (c < '0' || c > '9')
+                return true;
+            milliseconds = milliseconds * 10 + static_cast<uint64_t>(c - '0');
+        }
+        _listener->onRetry(milliseconds);
+    }
+
+    return true;
+}
+
+/// Copies the fields of the event being assembled that still point into the fed bytes.
+void EventStreamParser::retainEvent()
+{
+    if (_hasData && !_dataOwned)
+    {
+        _dataBuffer.assign(_data);
+        _data = _dataBuffer;
+        _dataOwned = true;
+    }
+
+    if (!_type.empty() && !_typeOwned)
+    {
+        _typeBuffer.assign(_type);
+        _type = _typeBuffer;
+        _typeOwned = true;
+    }
+}
+
+void EventStreamParser::dispatch()
+{
+    if (_hasData)
+        _listener->onEvent(_type.empty() ? std::string_view("message") : _type, _data, _id);
+
+    _hasData = false;
+    _dataOwned = false;
+    _typeOwned = false;
+    _data = {};
+    _type = {};
+}
+
+size_t EventStreamParser::fail(size_t offset)
+{
+    _failed = true;
+    _listener->onProtocolError();
+    return offset;
+}
+
+void EventStreamParser::reset() noexcept
+{
+    _failed = false;
+    _atStart = true;
+    _skipLf = false;
+    _line.clear();
+    _hasData = false;
+    _dataOwned = false;
+    _typeOwned = false;
+    _data = {};
+    _type = {};
+}
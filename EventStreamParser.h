@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class EventStreamListener // {{{
+{
+  public:
+    virtual ~EventStreamListener() = default;
+
+    /// An event has been dispatched, i.e. a blank line has been reached after at least one data field.
+    ///
+    /// @param type the event field, or "message" if there is none
+    /// @param data the data fields, joined by LF
+    /// @param id   the last event ID seen on the stream so far, if any
+    virtual void onEvent(std::string_view type, std::string_view data, std::string_view id) {}
+
+    /// A retry field has set the reconnection time.
+    virtual void onRetry(uint64_t milliseconds) {}
+
+    /// A line or event exceeded the maximum event size. The parser stops.
+    virtual void onProtocolError() {}
+}; // }}}
+
+/// Incremental parser for Server-Sent Events streams (text/event-stream, HTML Living Standard 9.2.6).
+///
+/// It is fed the body of an event stream response in pieces of any size, e.g. from
+/// HttpListener::onMessageContent(). The data of an event with a single data line is handed on as a view
+/// into the fed bytes if the event lies within one piece; only multi-line data, and the fields of an event
+/// still incomplete at the end of a piece, are copied. Memory use thus stays at the size of the largest
+/// event, no matter how long the stream runs.
+class EventStreamParser
+{
+  public:
+    static constexpr size_t DefaultMaxEventSize = 1024 * 1024;
+
+    /// @param listener     receives the events
+    /// @param maxEventSize maximum size of a line, and of the data of an event
+    explicit EventStreamParser(EventStreamListener* listener,
+                               size_t maxEventSize = DefaultMaxEventSize) noexcept:
+        _listener(listener), _maxEventSize(maxEventSize)
+    {
+    }
+
+    /// Processes a piece of the stream.
+    ///
+    /// @return number of bytes processed, less than @p chunk.size() only on protocol errors.
+    size_t parseFragment(std::string_view chunk);
+
+    /// Starts over with a new stream, e.g. after reconnecting. The last event ID is kept.
+    void reset() noexcept;
+
+    bool failed() const noexcept { return _failed; }
+
+    /// The last event ID seen on the stream, to be sent as Last-Event-ID when reconnecting.
+    std::string_view lastEventId() const noexcept { return _id; }
+
+  private:
+    bool processLine(std::string_view line);
+    void retainEvent();
+    void dispatch();
+    size_t fail(size_t offset);
+
+    EventStreamListener* _listener;
+    size_t _maxEventSize;
+    bool _failed = false;
+    bool _atStart = true; //!< no line has been processed yet, which may start with a BOM
+    bool _skipLf = false; //!< the last line ended with CR, so a leading LF is part of that line end
+    std::string _line;    //!< incomplete line carried over from the previous piece
+
+    // event being assembled, with the views pointing into the fed bytes or the buffers below
+    bool _hasData = false;
+    bool _dataOwned = false; //!< whether or not _data points into _dataBuffer
+    bool _typeOwned = false; //!< whether or not _type points into _typeBuffer
+    std::string_view _data;
+    std::string_view _type;
+    std::string _dataBuffer;
+    std::string _typeBuffer;
+    std::string _id;
+};
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "EventStreamParser.h"
+
+namespace
+{
+
+struct EventCollector: public EventStreamListener
+{
+    std::vector<std::string> events;
+    std::vector<bool> inPlace; //!< whether or not the data pointed into the fed bytes
+    std::vector<uint64_t> retries;
+    std::string_view fed;
+    int errors = 0;
+
+    void onEvent(std::string_view type, std::string_view data, std::string_view id) override
+    {
+        events.push_back(std::string(type) + "|" + std::string(data) + "|" + std::string(id));
+        inPlace.push_back(!data.empty() && fed.data() <= data.data()
+                          && data.data() < fed.data() + fed.size());
+    }
+    void onRetry(uint64_t milliseconds) override { retries.push_back(milliseconds); }
+    void onProtocolError() override { ++errors; }
+};
+
+/// Feeds @p input in pieces of @p pieceSize bytes, each of them gone once fed.
+void feed(EventStreamParser& parser, EventCollector& collector, std::string_view input, size_t pieceSize)
+{
+    for (size_t offset = 0; offset < input.size(); offset += pieceSize)
+    {
+        auto const piece = std::string(input.substr(offset, pieceSize));
+        collector.fed = piece;
+        parser.parseFragment(piece);
+    }
+}
+
+constexpr std::string_view Stream = "\xEF\xBB\xBF: keep-alive\r\n"
+                                    "data: first\r\n"
+                                    "\r\n"
+                                    "event: update\n"
+                                    "id: 42\n"
+                                    "data:line one\n"
+                                    "data: line two\n"
+                                    "data\n"
+                                    "unknown: field\n"
+                                    "\n"
+                                    "retry: 3000\r"
+                                    "retry: soon\r"
+                                    "data: third\r"
+                                    "\r"
+                                    "event: ignored\n"
+                                    "\n"
+                                    "id\n"
+                                    "data: incomplete";
+
+} // namespace
+
+TEST_CASE("EventStreamParser.events")
+{
+    std::vector<std::string> const expected = {
+        "message|first|",
+        "update|line one\nline two\n|42",
+        "message|third|42",
+    };
+
+    for (size_t const pieceSize: { 1, 2, 5, 13, 1000 })
+    {
+        EventCollector collector;
+        EventStreamParser parser(&collector);
+        feed(parser, collector, Stream, pieceSize);
+
+        REQUIRE(expected == collector.events);
+        REQUIRE(std::vector<uint64_t> { 3000 } == collector.retries);
+        REQUIRE(parser.lastEventId().empty()); // reset by the last id field
+    }
+}
+
+TEST_CASE("EventStreamParser.zeroCopy")
+{
+    EventCollector collector;
+    EventStreamParser parser(&collector);
+
+    auto const stream = std::string("data: a\n\ndata: b\ndata: c\n\ndata: spanning");
+    collector.fed = stream;
+    REQUIRE(stream.size() == parser.parseFragment(stream));
+    auto const rest = std::string(" pieces\n\n");
+    collector.fed = rest;
+    parser.parseFragment(rest);
+
+    REQUIRE(std::vector<std::string> { "message|a|", "message|b\nc|", "message|spanning pieces|" }
+            == collector.events);
+    REQUIRE(std::vector<bool> { true, false, false } == collector.inPlace);
+}
+
+TEST_CASE("EventStreamParser.maxEventSize")
+{
+    EventCollector collector;
+    EventStreamParser parser(&collector, 16);
+
+    feed(parser, collector, "data: 0123456789\n\ndata: 0123456789abcdef", 4);
+    REQUIRE(1 == collector.events.size());
+    REQUIRE(1 == collector.errors);
+    REQUIRE(parser.failed());
+    REQUIRE(0 == parser.parseFragment("\n\n"));
+
+    parser.reset();
+    REQUIRE(2 == parser.parseFragment("\n\n"));
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "GrpcMessageFramer.h"
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr uint8_t CompressedFlag = 0x01;
+constexpr uint8_t TrailersFlag = 0x80; // gRPC-Web
+
+} // namespace
+
+size_t GrpcMessageFramer::parseFragment(std::string_view chunk)
+{
+    if (_failed)
+        return 0;
+
+    size_t offset = 0;
+    while (offset < chunk.size())
+    {
+        if (_prefixSize < PrefixSize)
+        {
+            auto const n = std::min(PrefixSize - _prefixSize, chunk.size() - offset);
+            std::copy_n(chunk.data() + offset, n, _prefix.data() + _prefixSize);
+            _prefixSize += n;
+            if (_prefixSize < PrefixSize)
+                return chunk.size();
+            if (!beginMessage())
+            {
+                _failed = true;
+                _listener->onProtocolError();
+                return offset;
+            }
+            offset += n;
+
+            if (_length == 0)
+            {
+                deliver({});
+                continue;
+            }
+        }
+
+        auto const available = chunk.size() - offset;
+        if (_message.empty() && available >= _length)
+        {
+            deliver(chunk.substr(offset, _length));
+            offset += _length;
+            continue;
+        }
+
+        // spanning pieces
+        auto const n = std::min(_length - _message.size(), available);
+        _message.append(chunk.data() + offset, n);
+        offset += n;
+        if (_message.size() == _length)
+        {
+            deliver(_message);
+            _message.clear();
+        }
+    }
+
+    return offset;
+}
+
+bool GrpcMessageFramer::beginMessage() noexcept
+{
+    auto const flags = _prefix[0];
+    if (flags & ~(CompressedFlag | TrailersFlag))
+        return false;
+
+    _length = static_cast<size_t>(_prefix[1]) << 24 | static_cast<size_t>(_prefix[2]) << 16
+              | static_cast<size_t>(_prefix[3]) << 8 | static_cast<size_t>(_prefix[4]);
+    return _length <= _maxMessageSize;
+}
+
+void GrpcMessageFramer::deliver(std::string_view message)
+{
+    _prefixSize = 0;
+    if (_prefix[0] & TrailersFlag)
+        _listener->onTrailers(message);
+    else
+        _listener->onMessage(message, _prefix[0] & CompressedFlag);
+}
+
+void GrpcMessageFramer::reset() noexcept
+{
+    _failed = false;
+    _prefixSize = 0;
+    _length = 0;
+    _message.clear();
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class GrpcMessageListener // {{{
+{
+  public:
+    virtual ~GrpcMessageListener() = default;
+
+    /// A length-prefixed message has been received completely.
+    ///
+    /// @param message    the message, as serialized by the sender
+    /// @param compressed whether or not @p message is compressed with the grpc-encoding of the stream
+    virtual void onMessage(std::string_view message, bool compressed) {}
+
+    /// A trailers frame has been received (gRPC-Web only), e.g. "grpc-status: 0\r\n".
+    virtual void onTrailers(std::string_view trailers) {}
+
+    /// A frame with unknown flags, or exceeding the maximum message size. The framer stops.
+    virtual void onProtocolError() {}
+}; // }}}
+
+/// Incremental framer for the length-prefixed messages of gRPC and gRPC-Web bodies.
+///
+/// Every message is preceded by a flags byte and a 32-bit big-endian length. The framer is fed the body
+/// in pieces of any size, e.g. from HttpListener::onMessageContent(), and hands on every message lying
+/// within one piece as a view into it. Only messages spanning pieces are gathered, in a buffer reused
+/// from one message to the next.
+class GrpcMessageFramer
+{
+  public:
+    static constexpr size_t PrefixSize = 5;
+    static constexpr size_t DefaultMaxMessageSize = 4 * 1024 * 1024; //!< as gRPC implementations have
+
+    /// @param listener       receives the messages
+    /// @param maxMessageSize maximum length of a message
+    explicit GrpcMessageFramer(GrpcMessageListener* listener,
+                               size_t maxMessageSize = DefaultMaxMessageSize) noexcept:
+        _listener(listener), _maxMessageSize(maxMessageSize)
+    {
+    }
+
+    /// Processes a piece of the body.
+    ///
+    /// @return number of bytes processed, less than @p chunk.size() only on protocol errors.
+    size_t parseFragment(std::string_view chunk);
+
+    void reset() noexcept;
+
+    bool failed() const noexcept { return _failed; }
+
+    /// Whether or not the body so far ends between messages, as it must when it is complete.
+    bool atMessageBoundary() const noexcept { return _prefixSize == 0; }
+
+  private:
+    bool beginMessage() noexcept;
+    void deliver(std::string_view message);
+
+    GrpcMessageListener* _listener;
+    size_t _maxMessageSize;
+    bool _failed = false;
+
+    std::array<uint8_t, PrefixSize> _prefix {};
+    size_t _prefixSize = 0; //!< bytes of the prefix of the current message received so far
+    size_t _length = 0;     //!< length of the current message
+    std::string _message;   //!< current message received so far, if spanning pieces
+};
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "GrpcMessageFramer.h"
+
+namespace
+{
+
+struct MessageCollector: public GrpcMessageListener
+{
+    std::vector<std::string> messages;
+    std::vector<bool> inPlace; //!< whether or not the message pointed into the fed bytes
+    std::string trailers;
+    std::string_view fed;
+    int errors = 0;
+
+    void onMessage(std::string_view message, bool compressed) override
+    {
+        messages.push_back((compressed ? "z:" : "") + std::string(message));
+        inPlace.push_back(fed.data() <= message.data() && message.data() < fed.data() + fed.size());
+    }
+    void onTrailers(std::string_view block) override { trailers += block; }
+    void onProtocolError() override { ++errors; }
+};
+
+std::string frame(uint8_t flags, std::string_view message)
+{
+    auto const size = message.size();
+    std::string result;
+    result += static_cast<char>(flags);
+    result += static_cast<char>(size >> 24);
+    result += static_cast<char>(size >> 16);
+    result += static_cast<char>(size >> 8);
+    result += static_cast<char>(size);
+    result += message;
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("GrpcMessageFramer.messages")
+{
+    auto const large = std::string(70000, 'x');
+    auto const body = frame(0, "hello") + frame(1, "compressed") + frame(0, "") + frame(0, large)
+                      + frame(0x80, "grpc-status: 0\r\n");
+
+    for (size_t const pieceSize: { 1, 3, 5, 64, 100000 })
+    {
+        MessageCollector collector;
+        GrpcMessageFramer framer(&collector);
+        for (size_t offset = 0; offset < body.size(); offset += pieceSize)
+        {
+            auto const piece = body.substr(offset, pieceSize);
+            collector.fed = piece;
+            REQUIRE(piece.size() == framer.parseFragment(piece));
+        }
+
+        REQUIRE(std::vector<std::string> { "hello", "z:compressed", "", large } == collector.messages);
+        REQUIRE("grpc-status: 0\r\n" == collector.trailers);
+        REQUIRE(framer.atMessageBoundary());
+        if (pieceSize == 100000)
+            REQUIRE(collector.inPlace == std::vector<bool> { true, true, false, true });
+    }
+}
+
+TEST_CASE("GrpcMessageFramer.invalid")
+{
+    MessageCollector collector;
+    GrpcMessageFramer framer(&collector, 100);
+
+    auto const body = frame(0, "ok") + frame(0, std::string(101, 'x'));
+    REQUIRE(7 == framer.parseFragment(body));
+    REQUIRE(1 == collector.errors);
+    REQUIRE(framer.failed());
+    REQUIRE(1 == collector.messages.size());
+
+    framer.reset();
+    REQUIRE(0 == framer.parseFragment(frame(0x02, "reserved flag")));
+    REQUIRE(2 == collector.errors);
+
+    framer.reset();
+    REQUIRE(3 == framer.parseFragment(frame(0, "truncated").substr(0, 3)));
+    REQUIRE(!framer.atMessageBoundary());
+}
@@ -0,0 +1,771 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "Hpack.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+
+// {{{ Huffman code
+/// Code lengths of the HPACK Huffman code (RFC 7541, Appendix B), by symbol, EOS being symbol 256.
+///
+/// The code is canonical, i.e. the codes themselves follow from their lengths.
+constexpr std::array<uint8_t, 257> HuffmanCodeLengths = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28, // 0x00
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28, // 0x10
+    6,  10, 10, 12, 13, 6,  8,  11, 10, 10, 8,  11, 8,  6,  6,  6,  // 0x20
+    5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8,  15, 6,  12, 10, // 0x30
+    13, 6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  // 0x40
+    7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8,  13, 19, 13, 14, 6,  // 0x50
+    15, 5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,  // 0x60
+    6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7,  15, 11, 14, 13, 28, // 0x70
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23, // 0x80
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24, // 0x90
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23, // 0xA0
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23, // 0xB0
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25, // 0xC0
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27, // 0xD0
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23, // 0xE0
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26, // 0xF0
+    30,                                                             // EOS
+};
+
+constexpr unsigned EOS = 256;
+
+/// Decoding automaton consuming 4 bits per step.
+///
+/// Its states are the internal nodes of the code tree (256 of them, for 257 symbols), the root being
+/// state 0. As no code is shorter than 5 bits, a step emits at most one symbol.
+struct HuffmanTransition
+{
+    static constexpr uint8_t Emit = 1;   //!< a symbol has been completed
+    static constexpr uint8_t Accept = 2; //!< the bits since the last symbol are valid padding
+    static constexpr uint8_t Fail = 4;   //!< EOS has been decoded
+
+    uint8_t state;
+    uint8_t flags;
+    uint8_t symbol;
+};
+
+struct HuffmanTables
+{
+    std::array<uint32_t, 257> codes {};
+    std::array<std::array<HuffmanTransition, 16>, 256> transitions {};
+
+    HuffmanTables()
+    {
+        // canonical code assignment: by length, then by symbol
+        std::array<uint16_t, 257> order {};
+        for (unsigned symbol = 0; symbol <= EOS; ++symbol)
+            order[symbol] = static_cast<uint16_t>(symbol);
+        std::stable_sort(order.begin(), order.end(), [](uint16_t a, uint16_t b) {
+            return HuffmanCodeLengths[a] < HuffmanCodeLengths[b];
+        });
+
+        uint32_t code = 0;
+        unsigned length = HuffmanCodeLengths[order[0]];
+        for (auto const symbol: order)
+        {
+            code <<= HuffmanCodeLengths[symbol] - length;
+            length = HuffmanCodeLengths[symbol];
+            codes[symbol] = code++;
+        }
+
+        // code tree: non-negative children are internal nodes, negative ones leaves (~symbol)
+        struct Node
+        {
+            std::array<int, 2> children { 0, 0 };
+            unsigned depth = 0;
+            bool allOnes = true; //!< whether the path from the root consists of 1 bits only
+        };
+        std::vector<Node> nodes(1);
+        for (unsigned symbol = 0; symbol <= EOS; ++symbol)
+        {
+            size_t node = 0;
+            for (unsigned bit = HuffmanCodeLengths[symbol]; bit-- > 0;)
+            {
+                auto const b = (codes[symbol] >> bit) & 1;
+                if (bit == 0)
+                {
+                    nodes[node].children[b] = ~static_cast<int>(symbol);
+                    break;
+                }
+                if (nodes[node].children[b] == 0)
+                {
+                    nodes[node].children[b] = static_cast<int>(nodes.size());
+                    nodes.push_back(Node { { 0, 0 }, nodes[node].depth + 1, nodes[node].allOnes && b == 1 });
+                }
+                node = static_cast<size_t>(nodes[node].children[b]);
+            }
+        }
+
+        for (size_t state = 0; state < nodes.size(); ++state)
+        {
+            for (unsigned nibble = 0; nibble < 16; ++nibble)
+            {
+                HuffmanTransition transition { 0, 0, 0 };
+                size_t node = state;
+                for (unsigned bit = 4; bit-- > 0;)
+                {
+                    auto const child = nodes[node].children[(nibble >> bit) & 1];
+                    if (child >= 0)
+                    {
+                        node = static_cast<size_t>(child);
+                        continue;
+                    }
+
+                    if (static_cast<unsigned>(~child) == EOS)
+                        transition.flags |= HuffmanTransition::Fail;
+                    transition.flags |= HuffmanTransition::Emit;
+                    transition.symbol = static_cast<uint8_t>(~child);
+                    node = 0;
+                }
+
+                if (node == 0 || (nodes[node].allOnes && nodes[node].depth <= 7))
+                    transition.flags |= HuffmanTransition::Accept;
+                transition.state = static_cast<uint8_t>(node);
+                transitions[state][nibble] = transition;
+            }
+        }
+    }
+};
+
+HuffmanTables const& huffmanTables()
+{
+    static HuffmanTables const tables;
+    return tables;
+}
+// }}}
+
+// {{{ static table
+struct StaticEntry
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+/// RFC 7541, Appendix A; index 1 is at position 0.
+constexpr std::array<StaticEntry, 61> StaticTable = { {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+} };
+
+constexpr size_t DynamicTableOffset = StaticTable.size() + 1;
+// }}}
+
+bool decodeInteger(std::string_view& input, unsigned prefixBits, uint64_t& value) noexcept
+{
+    auto const mask = (1u << prefixBits) - 1;
+    value = static_cast<uint8_t>(input.front()) & mask;
+    input.remove_prefix(1);
+    if (value < mask)
+        return true;
+
+    for (unsigned shift = 0; shift <= 28; shift += 7)
+    {
+        if (input.empty())
+            return false;
+
+        auto const byte = static_cast<uint8_t>(input.front());
+        input.remove_prefix(1);
+        value += static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false; // more than we would ever accept
+}
+
+void encodeInteger(std::string& output, unsigned prefixBits, uint8_t flags, uint64_t value)
+{
+    auto const mask = (1u << prefixBits) - 1;
+    if (value < mask)
+    {
+        output += static_cast<char>(flags | value);
+        return;
+    }
+
+    output += static_cast<char>(flags | mask);
+    value -= mask;
+    while (value >= 0x80)
+    {
+        output += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    output += static_cast<char>(value);
+}
+
+void encodeString(std::string& output, std::string_view value)
+{
+    auto const huffmanSize = hpackHuffmanEncodedSize(value);
+    if (huffmanSize < value.size())
+    {
+        encodeInteger(output, 7, 0x80, huffmanSize);
+        hpackHuffmanEncode(value, output);
+    }
+    else
+    {
+        encodeInteger(output, 7, 0x00, value.size());
+        output += value;
+    }
+}
+
+bool contains(std::string_view storage, std::string_view bytes) noexcept
+{
+    return !bytes.empty() && std::less_equal<char const*>()(storage.data(), bytes.data())
+           && std::less<char const*>()(bytes.data(), storage.data() + storage.size());
+}
+
+} // namespace
+
+// {{{ Huffman coding
+void hpackHuffmanEncode(std::string_view input, std::string& output)
+{
+    auto const& tables = huffmanTables();
+
+    uint64_t bits = 0;
+    unsigned pending = 0;
+    for (auto const c: input)
+    {
+        auto const symbol = static_cast<uint8_t>(c);
+        bits = (bits << HuffmanCodeLengths[symbol]) | tables.codes[symbol];
+        pending += HuffmanCodeLengths[symbol];
+        while (pending >= 8)
+        {
+            pending -= 8;
+            output += static_cast<char>(bits >> pending);
+        }
+        bits &= (uint64_t(1) << pending) - 1;
+    }
+
+    // pad with the most significant bits of EOS, i.e. ones
+    if (pending)
+        output += static_cast<char>((bits << (8 - pending)) | (0xFF >> pending));
+}
+
+size_t hpackHuffmanEncodedSize(std::string_view input) noexcept
+{
+    size_t bits = 0;
+    for (auto const c: input)
+        bits += HuffmanCodeLengths[static_cast<uint8_t>(c)];
+    return (bits + 7) / 8;
+}
+
+bool hpackHuffmanDecode(std::string_view input, std::string& output)
+{
+    auto const& transitions = huffmanTables().transitions;
+
+    uint8_t state = 0;
+    bool accept = true;
+    for (auto const c: input)
+    {
+        auto const byte = static_cast<uint8_t>(c);
+        for (auto const nibble: { byte >> 4, byte & 0x0F })
+        {
+            auto const& transition = transitions[state][nibble];
+            if (transition.flags & HuffmanTransition::Fail)
+                return false;
+            if (transition.flags & HuffmanTransition::Emit)
+                output += static_cast<char>(transition.symbol);
+            state = transition.state;
+            accept = transition.flags & HuffmanTransition::Accept;
+        }
+    }
+
+    return accept;
+}
+// }}}
+
+// {{{ HpackDynamicTable
+HpackDynamicTable::HpackDynamicTable(size_t maxSize):
+    _slots(16), _storage(2 * maxSize, '\0'), _maxSize(maxSize)
+{
+    // Entries never exceed maxSize bytes in total, and a wrapped entry wastes less than maxSize at the
+    // end of the storage, so twice maxSize is enough for the newest entry never to overwrite live ones.
+}
+
+void HpackDynamicTable::evictOldest() noexcept
+{
+    auto const& oldest = slot(_count - 1);
+    _size -= oldest.nameLength + oldest.valueLength + EntryOverhead;
+    --_count;
+}
+
+void HpackDynamicTable::setMaxSize(size_t maxSize)
+{
+    _maxSize = maxSize;
+    while (_size > _maxSize)
+        evictOldest();
+
+    if (_storage.size() < 2 * maxSize)
+        reallocate(2 * maxSize);
+}
+
+void HpackDynamicTable::reallocate(size_t storageSize)
+{
+    std::string storage(storageSize, '\0');
+    size_t offset = 0;
+    for (size_t index = _count; index-- > 0;)
+    {
+        auto& entry = _slots[(_end - 1 - index) & (_slots.size() - 1)];
+        auto const length = entry.nameLength + entry.valueLength;
+        std::memcpy(storage.data() + offset, _storage.data() + entry.offset, length);
+        entry.offset = static_cast<uint32_t>(offset);
+        offset += length;
+    }
+    _storage.swap(storage);
+    _tail = offset;
+}
+
+void HpackDynamicTable::insert(std::string_view name, std::string_view value)
+{
+    // the new entry's bytes may overwrite an evicted entry it refers to
+    std::string copy;
+    if (contains(_storage, name) || contains(_storage, value))
+    {
+        copy.reserve(name.size() + value.size());
+        copy.append(name).append(value);
+        name = std::string_view(copy).substr(0, name.size());
+        value = std::string_view(copy).substr(name.size());
+    }
+
+    auto const length = name.size() + value.size();
+    while (_count && _size + length + EntryOverhead > _maxSize)
+        evictOldest();
+
+    // an entry larger than the whole table empties it (RFC 7541, 4.4)
+    if (length + EntryOverhead > _maxSize)
+        return;
+
+    if (_count == 0)
+        _tail = 0;
+
+    auto offset = _tail;
+    if (offset + length > _storage.size())
+        offset = 0;
+    std::memcpy(_storage.data() + offset, name.data(), name.size());
+    std::memcpy(_storage.data() + offset + name.size(), value.data(), value.size());
+    _tail = offset + length;
+
+    if (_count == _slots.size())
+    {
+        // unroll the ring into one twice the size
+        std::vector<Slot> slots(2 * _slots.size());
+        for (size_t index = 0; index < _count; ++index)
+            slots[_count - 1 - index] = slot(index);
+        _slots.swap(slots);
+        _end = _count;
+    }
+
+    _slots[_end++ & (_slots.size() - 1)] =
+        Slot { static_cast<uint32_t>(offset), static_cast<uint32_t>(name.size()), static_cast<uint32_t>(value.size()) };
+    ++_count;
+    _size += length + EntryOverhead;
+}
+
+HpackDynamicTable::Entry HpackDynamicTable::at(size_t index) const noexcept
+{
+    auto const& entry = slot(index);
+    auto const* const data = _storage.data() + entry.offset;
+    return Entry { std::string_view(data, entry.nameLength),
+                   std::string_view(data + entry.nameLength, entry.valueLength) };
+}
+
+size_t HpackDynamicTable::find(std::string_view name, std::string_view value, bool& exact) const noexcept
+{
+    auto result = std::string_view::npos;
+    exact = false;
+
+    for (size_t index = 0; index < _count; ++index)
+    {
+        auto const entry = at(index);
+        if (entry.name != name)
+            continue;
+
+        if (entry.value == value)
+        {
+            exact = true;
+            return index;
+        }
+
+        if (result == std::string_view::npos)
+            result = index;
+    }
+
+    return result;
+}
+// }}}
+
+// {{{ HpackDecoder
+HpackDecoder::HpackDecoder(HttpListener* listener, size_t maxTableSize):
+    _listener(listener), _maxTableSize(maxTableSize), _table(maxTableSize)
+{
+}
+
+bool HpackDecoder::fail()
+{
+    _listener->onProtocolError();
+    return false;
+}
+
+bool HpackDecoder::decode(std::string_view block)
+{
+    _method.clear();
+    _path.clear();
+    _authority.clear();
+    _status = 0;
+    _begun = false;
+
+    bool fieldsSeen = false;
+    while (!block.empty())
+        if (!decodeField(block, fieldsSeen))
+            return fail();
+
+    if (!_begun)
+        beginMessage();
+
+    _listener->onMessageHeaderEnd();
+    return true;
+}
+
+bool HpackDecoder::lookup(uint64_t index, HpackDynamicTable::Entry& entry) const noexcept
+{
+    if (index == 0)
+        return false;
+
+    if (index < DynamicTableOffset)
+    {
+        auto const& field = StaticTable[index - 1];
+        entry = HpackDynamicTable::Entry { field.name, field.value };
+        return true;
+    }
+
+    if (index - DynamicTableOffset >= _table.count())
+        return false;
+
+    entry = _table.at(index - DynamicTableOffset);
+    return true;
+}
+
+bool HpackDecoder::decodeString(std::string_view& input, std::string& buffer, std::string_view& result)
+{
+    if (input.empty())
+        return false;
+
+    bool const huffman = input.front() & 0x80;
+    uint64_t length = 0;
+    if (!decodeInteger(input, 7, length) || length > input.size())
+        return false;
+
+    auto const raw = input.substr(0, length);
+    input.remove_prefix(length);
+
+    if (!huffman)
+    {
+        result = raw; // zero-copy
+        return true;
+    }
+
+    buffer.clear();
+    if (!hpackHuffmanDecode(raw, buffer))
+        return false;
+    result = buffer;
+    return true;
+}
+
+bool HpackDecoder::decodeField(std::string_view& input, bool& fieldsSeen)
+{
+    auto const first = static_cast<uint8_t>(input.front());
+    uint64_t index = 0;
+
+    if (first & 0x80)
+    {
+        // indexed header field
+        HpackDynamicTable::Entry entry;
+        if (!decodeInteger(input, 7, index) || !lookup(index, entry))
+            return false;
+        fieldsSeen = true;
+        return emit(entry.name, entry.value);
+    }
+
+    if ((first & 0xE0) == 0x20)
+    {
+        // dynamic table size update, only allowed at the beginning of a block
+        uint64_t maxSize = 0;
+        if (fieldsSeen || !decodeInteger(input, 5, maxSize) || maxSize > _maxTableSize)
+            return false;
+        _table.setMaxSize(maxSize);
+        return true;
+    }
+
+    // literal header field, with incremental indexing, without indexing, or never indexed
+    bool const indexing = first & 0x40;
+    if (!decodeInteger(input, indexing ? 6 : 4, index))
+        return false;
+
+    std::string_view name;
+    if (index == 0)
+    {
+        if (!decodeString(input, _nameBuffer, name))
+            return false;
+    }
+    else
+    {
+        HpackDynamicTable::Entry entry;
+        if (!lookup(index, entry))
+            return false;
+        name = entry.name;
+    }
+
+    std::string_view value;
+    if (!decodeString(input, _valueBuffer, value))
+        return false;
+
+    fieldsSeen = true;
+    if (!emit(name, value))
+        return false;
+
+    if (indexing)
+        _table.insert(name, value);
+
+    return true;
+}
+
+bool HpackDecoder::emit(std::string_view name, std::string_view value)
+{
+    if (!name.empty() && name.front() == ':')
+    {
+        // pseudo-header fields must precede all regular ones
+        if (_begun)
+            return false;
+
+        if (name == ":method")
+            _method = value;
+        else if (name == ":path")
+            _path = value;
+        else if (name == ":authority")
+            _authority = value;
+        else if (name == ":status")
+        {
+            auto const isDigit = [](char c) { return c >= '0' && c <= '9'; };
+            if (value.size() != 3 || !std::all_of(value.begin(), value.end(), isDigit))
+                return false;
+            _status = static_cast<unsigned>((value[0] - '0') * 100 + (value[1] - '0') * 10 + (value[2] - '0'));
+        }
+        else if (name != ":scheme" && name != ":protocol")
+            return false;
+
+        return true;
+    }
+
+    if (!_begun)
+        beginMessage();
+
+    // already passed on from :authority
+    if (name == "host" && !_authority.empty())
+        return true;
+
+    _listener->onMessageHeader(name, value);
+    return true;
+}
+
+void HpackDecoder::beginMessage()
+{
+    _begun = true;
+
+    if (_status)
+        _listener->onMessageBegin(HttpVersion::VERSION_2_0, static_cast<HttpStatus>(_status), "");
+    else if (!_method.empty())
+    {
+        _listener->onMessageBegin(_method, _path.empty() ? _authority : _path, HttpVersion::VERSION_2_0);
+        if (!_authority.empty())
+            _listener->onMessageHeader("host", _authority);
+    }
+    // else: a trailer block, carrying regular fields only
+}
+// }}}
+
+// {{{ HpackEncoder
+HpackEncoder::HpackEncoder(Handler handler, size_t maxTableSize, std::string scheme):
+    _handler(std::move(handler)), _scheme(std::move(scheme)), _table(maxTableSize)
+{
+}
+
+void HpackEncoder::setMaxTableSize(size_t maxTableSize)
+{
+    _table.setMaxSize(maxTableSize);
+    _tableSizeChanged = true;
+}
+
+void HpackEncoder::encodeHeader(std::string& block, std::string_view name, std::string_view value, bool sensitive)
+{
+    size_t nameIndex = 0;
+    size_t exactIndex = 0;
+    for (size_t i = 0; i < StaticTable.size() && !exactIndex; ++i)
+    {
+        if (StaticTable[i].name != name)
+            continue;
+        if (!nameIndex)
+            nameIndex = i + 1;
+        if (StaticTable[i].value == value)
+            exactIndex = i + 1;
+    }
+
+    if (!exactIndex)
+    {
+        bool exact = false;
+        auto const index = _table.find(name, value, exact);
+        if (index != std::string_view::npos)
+        {
+            if (exact)
+                exactIndex = index + DynamicTableOffset;
+            else if (!nameIndex)
+                nameIndex = index + DynamicTableOffset;
+        }
+    }
+
+    if (exactIndex && !sensitive)
+    {
+        encodeInteger(block, 7, 0x80, exactIndex);
+        return;
+    }
+
+    // do not flush the whole table for a single huge field
+    bool const indexing =
+        !sensitive && name.size() + value.size() + HpackDynamicTable::EntryOverhead <= _table.maxSize() / 2;
+
+    if (indexing)
+        encodeInteger(block, 6, 0x40, nameIndex);
+    else
+        encodeInteger(block, 4, sensitive ? 0x10 : 0x00, nameIndex);
+
+    if (!nameIndex)
+        encodeString(block, name);
+    encodeString(block, value);
+
+    if (indexing)
+        _table.insert(name, value);
+}
+
+void HpackEncoder::beginBlock()
+{
+    _block.clear();
+
+    if (_tableSizeChanged)
+    {
+        encodeInteger(_block, 5, 0x20, _table.maxSize());
+        _tableSizeChanged = false;
+    }
+}
+
+void HpackEncoder::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion /*version*/)
+{
+    beginBlock();
+    encodeHeader(_block, ":method", method);
+
+    if (method == "CONNECT")
+    {
+        encodeHeader(_block, ":authority", entity);
+        return;
+    }
+
+    encodeHeader(_block, ":scheme", _scheme);
+    encodeHeader(_block, ":path", entity);
+}
+
+void HpackEncoder::onMessageBegin(HttpVersion /*version*/, HttpStatus code, std::string_view /*text*/)
+{
+    beginBlock();
+    encodeHeader(_block, ":status", std::to_string(static_cast<int>(code)));
+}
+
+void HpackEncoder::onMessageBegin()
+{
+    beginBlock();
+}
+
+void HpackEncoder::onMessageHeader(std::string_view name, std::string_view value)
+{
+    _name.resize(name.size());
+    std::transform(name.begin(), name.end(), _name.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+
+    // connection-specific header fields must not be sent over HTTP/2
+    if (_name == "connection" || _name == "keep-alive" || _name == "proxy-connection"
+        || _name == "transfer-encoding" || _name == "upgrade" || (_name == "te" && value != "trailers"))
+        return;
+
+    bool const sensitive = _name == "authorization" || _name == "proxy-authorization";
+    encodeHeader(_block, _name, value, sensitive);
+}
+
+void HpackEncoder::onMessageHeaderEnd()
+{
+    if (_handler)
+        _handler(_block);
+}
+// }}}
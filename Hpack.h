@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HttpMessageParser.h"
+
+/// HPACK (RFC 7541) header compression for HTTP/2, hooked up to HttpListener.
+///
+/// HpackDecoder turns a header block into the very events HttpParser emits for an HTTP/1 message head,
+/// and HpackEncoder, being an HttpListener itself, turns those events into a header block. So header
+/// processing code can be shared between HTTP/1 and HTTP/2 front-ends.
+
+/// Appends the Huffman encoding of @p input to @p output.
+void hpackHuffmanEncode(std::string_view input, std::string& output);
+
+/// Number of bytes the Huffman encoding of @p input takes.
+size_t hpackHuffmanEncodedSize(std::string_view input) noexcept;
+
+/// Appends the decoding of the Huffman encoded @p input to @p output, 4 bits per table lookup.
+///
+/// @return false if @p input is not a valid encoding (EOS symbol, or invalid padding).
+bool hpackHuffmanDecode(std::string_view input, std::string& output);
+
+/// The dynamic table of an HPACK context, as a ring of entries whose bytes live in a ring buffer.
+class HpackDynamicTable
+{
+  public:
+    struct Entry
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    /// Per-entry overhead in the table size, as defined by RFC 7541, 4.1.
+    static constexpr size_t EntryOverhead = 32;
+
+    explicit HpackDynamicTable(size_t maxSize = 4096);
+
+    /// Number of entries.
+    size_t count() const noexcept { return _count; }
+
+    /// Table size, as defined by RFC 7541, 4.1.
+    size_t size() const noexcept { return _size; }
+    size_t maxSize() const noexcept { return _maxSize; }
+
+    /// Changes the maximum table size, evicting entries as needed.
+    void setMaxSize(size_t maxSize);
+
+    /// Adds an entry, evicting the oldest ones as needed. @p name and @p value may refer to the table.
+    void insert(std::string_view name, std::string_view value);
+
+    /// @return the @p index-th newest entry, 0 being the newest one.
+    Entry at(size_t index) const noexcept;
+
+    /// @return the index of the newest entry named @p name, whose value equals @p value if @p exact.
+    size_t find(std::string_view name, std::string_view value, bool& exact) const noexcept;
+
+  private:
+    struct Slot
+    {
+        uint32_t offset;
+        uint32_t nameLength;
+        uint32_t valueLength;
+    };
+
+    Slot const& slot(size_t index) const noexcept { return _slots[(_end - 1 - index) & (_slots.size() - 1)]; }
+    void evictOldest() noexcept;
+    void reallocate(size_t storageSize);
+
+    std::vector<Slot> _slots; //!< ring of entries, its size being a power of two
+    size_t _end = 0;          //!< ring position following the newest entry
+    size_t _count = 0;
+    std::string _storage;     //!< ring of entry bytes; an entry not fitting at the end continues at offset 0
+    size_t _tail = 0;         //!< storage offset to write the next entry to
+    size_t _size = 0;
+    size_t _maxSize;
+};
+
+/// Decodes HPACK header blocks into HttpListener events.
+///
+/// For each block, pseudo-header fields are turned into onMessageBegin() (with HttpVersion::VERSION_2_0),
+/// :authority into a "host" header, and all other fields into onMessageHeader(), followed by
+/// onMessageHeaderEnd(). Content and the end of the message are up to the HTTP/2 framing layer.
+class HpackDecoder
+{
+  public:
+    /// @param listener     receives the decoded header fields
+    /// @param maxTableSize SETTINGS_HEADER_TABLE_SIZE announced to the peer
+    explicit HpackDecoder(HttpListener* listener, size_t maxTableSize = 4096);
+
+    /// Decodes a complete header block (the fragments of a HEADERS frame and its CONTINUATION frames).
+    ///
+    /// @return false on decoding errors (a connection error of type COMPRESSION_ERROR), in which case
+    ///         onProtocolError() has been invoked.
+    bool decode(std::string_view block);
+
+    HpackDynamicTable const& table() const noexcept { return _table; }
+
+  private:
+    bool decodeField(std::string_view& input, bool& fieldsSeen);
+    bool decodeString(std::string_view& input, std::string& buffer, std::string_view& result);
+    bool lookup(uint64_t index, HpackDynamicTable::Entry& entry) const noexcept;
+    bool emit(std::string_view name, std::string_view value);
+    void beginMessage();
+    bool fail();
+
+    HttpListener* _listener;
+    size_t _maxTableSize;
+    HpackDynamicTable _table;
+
+    // scratch buffers for Huffman decoded strings, reused across fields
+    std::string _nameBuffer;
+    std::string _valueBuffer;
+
+    // pseudo-header fields of the current block
+    std::string _method;
+    std::string _path;
+    std::string _authority;
+    unsigned _status = 0;
+    bool _begun = false; //!< whether onMessageBegin() has been invoked for the current block
+};
+
+/// HttpListener encoding the message head it sees into an HPACK header block.
+///
+/// Request-lines and status-lines become pseudo-header fields, header names are lowercased, and
+/// connection-specific header fields (RFC 9113, 8.2.2) are dropped. Every block is passed on once
+/// onMessageHeaderEnd() has been seen.
+class HpackEncoder: public HttpListener
+{
+  public:
+    using Handler = std::function<void(std::string_view block)>;
+
+    /// @param handler      receives each complete header block
+    /// @param maxTableSize SETTINGS_HEADER_TABLE_SIZE announced by the peer
+    /// @param scheme       value of :scheme for requests
+    explicit HpackEncoder(Handler handler, size_t maxTableSize = 4096, std::string scheme = "https");
+
+    /// Changes the dynamic table size, to be signalled at the start of the next block.
+    void setMaxTableSize(size_t maxTableSize);
+
+    /// Appends a single header field to @p block.
+    ///
+    /// @param sensitive encodes the field as never-indexed, e.g. for credentials
+    void encodeHeader(std::string& block, std::string_view name, std::string_view value, bool sensitive = false);
+
+    HpackDynamicTable const& table() const noexcept { return _table; }
+
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override;
+    void onMessageBegin() override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+
+  private:
+    void beginBlock();
+
+    Handler _handler;
+    std::string _scheme;
+    HpackDynamicTable _table;
+    bool _tableSizeChanged = false;
+    std::string _block;
+    std::string _name; //!< lowercased header name
+};
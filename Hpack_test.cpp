@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "Hpack.h"
+#include "HttpMessageParser.h"
+
+namespace
+{
+
+std::string fromHex(std::string_view hex)
+{
+    std::string result;
+    int pending = -1;
+    for (auto const c: hex)
+    {
+        if (c == ' ')
+            continue;
+
+        auto const nibble = c <= '9' ? c - '0' : c - 'a' + 10;
+        if (pending < 0)
+            pending = nibble;
+        else
+        {
+            result += static_cast<char>(pending << 4 | nibble);
+            pending = -1;
+        }
+    }
+    return result;
+}
+
+std::string toHex(std::string_view bytes)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string result;
+    for (auto const c: bytes)
+    {
+        result += digits[static_cast<uint8_t>(c) >> 4];
+        result += digits[static_cast<uint8_t>(c) & 0x0F];
+    }
+    return result;
+}
+
+/// Records the events as lines of text.
+struct HeaderCollector: public HttpListener
+{
+    std::vector<std::string> events;
+    int errors = 0;
+
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override
+    {
+        events.push_back(std::string(method) + " " + std::string(entity) + " " + std::to_string(static_cast<int>(version)));
+    }
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view /*text*/) override
+    {
+        events.push_back(std::to_string(static_cast<int>(version)) + " " + std::to_string(static_cast<int>(code)));
+    }
+    void onMessageHeader(std::string_view name, std::string_view value) override
+    {
+        events.push_back(std::string(name) + ": " + std::string(value));
+    }
+    void onMessageHeaderEnd() override { events.emplace_back("end"); }
+    void onProtocolError() override { ++errors; }
+};
+
+std::string huffman(std::string_view input)
+{
+    std::string output;
+    hpackHuffmanEncode(input, output);
+    return output;
+}
+
+} // namespace
+
+TEST_CASE("Hpack.huffman")
+{
+    // RFC 7541, C.4 and C.6
+    REQUIRE("f1e3c2e5f23a6ba0ab90f4ff" == toHex(huffman("www.example.com")));
+    REQUIRE("a8eb10649cbf" == toHex(huffman("no-cache")));
+    REQUIRE("25a849e95ba97d7f" == toHex(huffman("custom-key")));
+    REQUIRE("25a849e95bb8e8b4bf" == toHex(huffman("custom-value")));
+    REQUIRE("6402" == toHex(huffman("302")));
+    REQUIRE(12 == hpackHuffmanEncodedSize("www.example.com"));
+
+    std::string all;
+    for (int c = 0; c < 256; ++c)
+        all += static_cast<char>(c);
+
+    for (auto const& input: { std::string(), std::string("a"), all, all + all + "tail" })
+    {
+        std::string output;
+        REQUIRE(hpackHuffmanDecode(huffman(input), output));
+        REQUIRE(input == output);
+    }
+
+    std::string output;
+    REQUIRE(!hpackHuffmanDecode("\xff\xff\xff\xff", output));  // EOS
+    REQUIRE(!hpackHuffmanDecode(huffman("a") + "\xff", output)); // padding longer than 7 bits
+    REQUIRE(!hpackHuffmanDecode(std::string(1, '\0'), output)); // padding of zeros
+}
+
+TEST_CASE("Hpack.decodeRequests")
+{
+    // RFC 7541, C.3 (plain) and C.4 (Huffman coded): same fields, same table states
+    std::vector<std::vector<std::string_view>> const sequences = {
+        {
+            "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d",
+            "8286 84be 5808 6e6f 2d63 6163 6865",
+            "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65",
+        },
+        {
+            "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff",
+            "8286 84be 5886 a8eb 1064 9cbf",
+            "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf",
+        },
+    };
+
+    for (auto const& blocks: sequences)
+    {
+        HeaderCollector collector;
+        HpackDecoder decoder(&collector);
+
+        REQUIRE(decoder.decode(fromHex(blocks[0])));
+        REQUIRE(std::vector<std::string> { "GET / 20", "host: www.example.com", "end" } == collector.events);
+        REQUIRE(57 == decoder.table().size());
+
+        collector.events.clear();
+        REQUIRE(decoder.decode(fromHex(blocks[1])));
+        REQUIRE(std::vector<std::string> { "GET / 20", "host: www.example.com", "cache-control: no-cache", "end" }
+                == collector.events);
+        REQUIRE(110 == decoder.table().size());
+
+        collector.events.clear();
+        REQUIRE(decoder.decode(fromHex(blocks[2])));
+        REQUIRE(std::vector<std::string> { "GET /index.html 20", "host: www.example.com", "custom-key: custom-value",
+                                           "end" }
+                == collector.events);
+        REQUIRE(164 == decoder.table().size());
+        REQUIRE(3 == decoder.table().count());
+        REQUIRE("custom-key" == decoder.table().at(0).name);
+        REQUIRE("www.example.com" == decoder.table().at(2).value);
+        REQUIRE(0 == collector.errors);
+    }
+}
+
+TEST_CASE("Hpack.decodeResponsesWithEviction")
+{
+    // RFC 7541, C.5.1 and C.5.2, with a table of 256 bytes
+    HeaderCollector collector;
+    HpackDecoder decoder(&collector, 256);
+
+    REQUIRE(decoder.decode(fromHex("4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133"
+                                   "2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 3a2f 2f77 7777 2e65 7861 6d70"
+                                   "6c65 2e63 6f6d")));
+    REQUIRE(std::vector<std::string> { "20 302", "cache-control: private", "date: Mon, 21 Oct 2013 20:13:21 GMT",
+                                       "location: https://www.example.com", "end" }
+            == collector.events);
+    REQUIRE(222 == decoder.table().size());
+
+    collector.events.clear();
+    REQUIRE(decoder.decode(fromHex("4803 3330 37c1 c0bf")));
+    REQUIRE(std::vector<std::string> { "20 307", "cache-control: private", "date: Mon, 21 Oct 2013 20:13:21 GMT",
+                                       "location: https://www.example.com", "end" }
+            == collector.events);
+    REQUIRE(222 == decoder.table().size());
+    REQUIRE(4 == decoder.table().count());
+    REQUIRE("307" == decoder.table().at(0).value);
+    REQUIRE("private" == decoder.table().at(3).value);
+}
+
+TEST_CASE("Hpack.dynamicTableRing")
+{
+    HpackDynamicTable table(200);
+
+    // many more insertions than fit, wrapping both the slot ring and the byte ring
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto const value = std::string(static_cast<size_t>(i % 37), static_cast<char>('a' + i % 26));
+        table.insert("x-key-" + std::to_string(i), value);
+
+        REQUIRE(table.size() <= 200);
+        REQUIRE("x-key-" + std::to_string(i) == table.at(0).name);
+        REQUIRE(value == table.at(0).value);
+        if (table.count() > 1)
+            REQUIRE("x-key-" + std::to_string(i - 1) == table.at(1).name);
+    }
+
+    // an entry referring to the table, evicting what it refers to
+    auto const oldest = table.at(table.count() - 1);
+    table.insert(oldest.name, std::string(150, 'v'));
+    REQUIRE(1 == table.count());
+    REQUIRE(std::string(150, 'v') == table.at(0).value);
+
+    table.insert("too-large", std::string(200, 'x'));
+    REQUIRE(0 == table.count());
+    REQUIRE(0 == table.size());
+
+    table.insert("a", "b");
+    table.setMaxSize(4096);
+    REQUIRE("b" == table.at(0).value);
+    table.setMaxSize(0);
+    REQUIRE(0 == table.count());
+}
+
+TEST_CASE("Hpack.roundTrip")
+{
+    std::vector<std::string> blocks;
+    HpackEncoder encoder([&](std::string_view block) { blocks.emplace_back(block); });
+    HttpParser parser(HttpParseMode::REQUEST, &encoder);
+
+    auto const request = std::string_view("GET /search?q=hpack HTTP/1.1\r\n"
+                                          "Host: www.example.com\r\n"
+                                          "User-Agent: test\r\n"
+                                          "Connection: keep-alive\r\n"
+                                          "Authorization: Basic c2VjcmV0\r\n"
+                                          "\r\n");
+    parser.parseFragment(request);
+    parser.parseFragment(request);
+    REQUIRE(2 == blocks.size());
+    REQUIRE(blocks[1].size() < blocks[0].size()); // the second one is mostly indexed
+
+    HeaderCollector collector;
+    HpackDecoder decoder(&collector);
+    for (auto const& block: blocks)
+    {
+        collector.events.clear();
+        REQUIRE(decoder.decode(block));
+        REQUIRE(std::vector<std::string> { "GET /search?q=hpack 20", "host: www.example.com", "user-agent: test",
+                                           "authorization: Basic c2VjcmV0", "end" }
+                == collector.events);
+    }
+
+    // never indexed: found in neither table
+    for (size_t i = 0; i < decoder.table().count(); ++i)
+        REQUIRE("authorization" != decoder.table().at(i).name);
+
+    // a table size update is signalled once, at the start of the next block
+    encoder.setMaxTableSize(0);
+    HttpParser responseParser(HttpParseMode::RESPONSE, &encoder);
+    responseParser.parseFragment("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+    REQUIRE(3 == blocks.size());
+    REQUIRE(0x20 == blocks[2][0]);
+
+    collector.events.clear();
+    REQUIRE(decoder.decode(blocks[2]));
+    REQUIRE(std::vector<std::string> { "20 404", "content-length: 0", "end" } == collector.events);
+    REQUIRE(0 == decoder.table().count());
+}
+
+TEST_CASE("Hpack.decodeErrors")
+{
+    auto const fails = [](std::string_view hex) {
+        HeaderCollector collector;
+        HpackDecoder decoder(&collector);
+        return !decoder.decode(fromHex(hex)) && collector.errors == 1;
+    };
+
+    REQUIRE(fails("80"));              // index 0
+    REQUIRE(fails("be"));              // index beyond the (empty) dynamic table
+    REQUIRE(fails("82 3f e1 1f"));     // table size update after a field
+    REQUIRE(fails("3f e2 1f"));        // table size update above the limit
+    REQUIRE(fails("40 05 61"));        // truncated string
+    REQUIRE(fails("ff ff ff ff ff ff")); // integer overflow
+    REQUIRE(fails("40 81 ff 01 61"));  // invalid Huffman code
+    REQUIRE(fails("40 01 61 01 62 82")); // pseudo-header after a regular field
+    REQUIRE(fails("48 02 32 30"));     // malformed :status
+    REQUIRE(fails("48 03 32 30 b2"));  // :status with a non-ASCII byte
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <string_view>
+
+// Helpers shared by the translation units of this library, not meant to be included by its users.
+
+/// Lower-cases an ASCII letter, regardless of the locale.
+constexpr char toLowerAscii(char c) noexcept
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/// Compares ASCII strings, such as header names and tokens, case-insensitively.
+constexpr bool iequals(std::string_view a, std::string_view b) noexcept
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); ++i)
+        if (toLowerAscii(a[i]) != toLowerAscii(b[i]))
+            return false;
+
+    return true;
+}
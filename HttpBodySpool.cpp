@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpBodySpool.h"
+
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+
+/// Creates an anonymous file within @p directory, or a memfd if @p directory is empty.
+///
+/// @return the file, or -1 with errno set
+int createSpoolFile(std::string const& directory) noexcept
+{
+#if defined(MFD_CLOEXEC)
+    if (directory.empty())
+        return ::memfd_create("http-body", MFD_CLOEXEC);
+#endif
+
+    auto const path = directory.empty() ? std::string("/tmp") : directory;
+#if defined(O_TMPFILE)
+    auto const fd = ::open(path.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0 || (errno != EOPNOTSUPP && errno != EISDIR)) // the latter if O_TMPFILE is not supported
+        return fd;
+#endif
+
+    auto name = path + "/http-body-XXXXXX";
+    auto const tmp = ::mkstemp(name.data());
+    if (tmp >= 0)
+    {
+        ::unlink(name.c_str());
+        ::fcntl(tmp, F_SETFD, FD_CLOEXEC);
+    }
+    return tmp;
+}
+
+} // namespace
+
+HttpBodySpool::HttpBodySpool(HttpListener* next,
+                             std::function<void()> error,
+                             std::string directory,
+                             size_t threshold,
+                             size_t batchSize):
+    _next(next),
+    _error(std::move(error)),
+    _directory(std::move(directory)),
+    _threshold(threshold),
+    _batchSize(batchSize)
+{
+}
+
+HttpBodySpool::~HttpBodySpool()
+{
+    if (_fd >= 0)
+        ::close(_fd);
+}
+
+void HttpBodySpool::reset() noexcept
+{
+    _buffer.clear();
+    _size = 0;
+    _written = 0;
+    _spooled = false;
+    _failed = false;
+}
+
+/// Switches over to the spool file, which the body held in memory so far goes to with the first batch.
+bool HttpBodySpool::spill()
+{
+    if (_fd < 0)
+        _fd = createSpoolFile(_directory);
+    else if (::ftruncate(_fd, 0) < 0) // whatever the previous message left behind
+        return false;
+
+    if (_fd < 0)
+        return false;
+
+    _spooled = true;
+    return true;
+}
+
+bool HttpBodySpool::write(std::string_view bytes) noexcept
+{
+    while (!bytes.empty())
+    {
+        auto const n = ::pwrite(_fd, bytes.data(), bytes.size(), static_cast<off_t>(_written));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+
+        bytes.remove_prefix(static_cast<size_t>(n));
+        _written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void HttpBodySpool::fail()
+{
+    _failed = true;
+    _spooled = false;
+    _buffer.clear();
+    if (_error)
+        _error();
+}
+
+ssize_t HttpBodySpool::sendTo(int socket, size_t offset) const noexcept
+{
+    if (offset >= _size)
+        return 0;
+
+    if (!_spooled)
+        return ::write(socket, _buffer.data() + offset, _size - offset);
+
+    auto position = static_cast<off_t>(offset);
+    return ::sendfile(socket, _fd, &position, _size - offset);
+}
+
+int HttpBodySpool::releaseFile() noexcept
+{
+    if (!_spooled)
+        return -1;
+
+    auto const fd = _fd;
+    _fd = -1;
+    return fd;
+}
+
+// {{{ HttpListener
+void HttpBodySpool::onProxyHeader(HttpProxyHeader const& header)
+{
+    if (_next)
+        _next->onProxyHeader(header);
+}
+
+void HttpBodySpool::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version)
+{
+    reset();
+    if (_next)
+        _next->onMessageBegin(method, entity, version);
+}
+
+void HttpBodySpool::onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text)
+{
+    reset();
+    if (_next)
+        _next->onMessageBegin(version, code, text);
+}
+
+void HttpBodySpool::onMessageBegin()
+{
+    reset();
+    if (_next)
+        _next->onMessageBegin();
+}
+
+void HttpBodySpool::onMessageHeader(std::string_view name, std::string_view value)
+{
+    if (_next)
+        _next->onMessageHeader(name, value);
+}
+
+void HttpBodySpool::onMessageHeaderEnd()
+{
+    if (_next)
+        _next->onMessageHeaderEnd();
+}
+
+bool HttpBodySpool::onExpectContinue()
+{
+    return _next ? _next->onExpectContinue() : true;
+}
+
+void HttpBodySpool::onMessageContent(std::string_view chunk)
+{
+    if (_failed)
+        return;
+
+    _size += chunk.size();
+    if (!_spooled && _size <= _threshold)
+    {
+        _buffer += chunk;
+        return;
+    }
+
+    if (!_spooled && !spill())
+        return fail();
+
+    // small chunks are gathered into batches, large ones written right away
+    if (_buffer.size() + chunk.size() < _batchSize)
+    {
+        _buffer += chunk;
+        return;
+    }
+
+    if (!write(_buffer) || !write(chunk))
+        return fail();
+    _buffer.clear();
+}
+
+void HttpBodySpool::onMessageEnd()
+{
+    if (_spooled && !_failed)
+    {
+        if (write(_buffer))
+            _buffer.clear();
+        else
+            fail();
+    }
+
+    if (_next)
+        _next->onMessageEnd();
+}
+
+void HttpBodySpool::onProtocolError()
+{
+    if (_next)
+        _next->onProtocolError();
+}
+// }}}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <sys/types.h> // ssize_t
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "HttpMessageParser.h"
+#include "MappedFile.h"
+
+/// HttpListener adapter collecting message bodies, in memory while small and in a file past a threshold.
+///
+/// It sits between the HttpParser and the actual listener, forwarding all events but the content, which
+/// is complete by the time onMessageEnd() is forwarded. Up to the threshold, a body is held in a buffer
+/// reused from one message to the next. Beyond it, the body goes to an anonymous file (O_TMPFILE within
+/// the spool directory, or a memfd if none is given), written in batches of the given size. Handlers
+/// then get the file as fd() with the body at offset 0, to sendfile() it on (see sendTo()) or to map()
+/// it, so that large uploads never occupy more memory than one batch.
+///
+/// A body is rejected if its file cannot be created or written (e.g. with the disk full). The error
+/// callback is invoked then, and the rest of that body is dropped; the listener still sees onMessageEnd().
+class HttpBodySpool final: public HttpListener
+{
+  public:
+    static constexpr size_t DefaultThreshold = 64 * 1024;
+    static constexpr size_t DefaultBatchSize = 256 * 1024;
+
+    /// @param next       listener receiving all events but the content
+    /// @param error      invoked for every body failing to spool
+    /// @param directory  where to create spool files, or empty for memfds (which are backed by memory,
+    ///                   but can be swapped out)
+    /// @param threshold  maximum size of bodies held in memory
+    /// @param batchSize  bytes gathered in memory for every write to a spool file
+    explicit HttpBodySpool(HttpListener* next,
+                           std::function<void()> error = {},
+                           std::string directory = "/tmp",
+                           size_t threshold = DefaultThreshold,
+                           size_t batchSize = DefaultBatchSize);
+    ~HttpBodySpool() override;
+
+    HttpBodySpool(HttpBodySpool const&) = delete;
+    HttpBodySpool& operator=(HttpBodySpool const&) = delete;
+
+    /// Size of the body of the current message, so far.
+    size_t size() const noexcept { return _size; }
+
+    /// Whether or not the body of the current message went to a file.
+    bool isSpooled() const noexcept { return _spooled; }
+
+    /// The body of the current message if held in memory, empty if spooled.
+    std::string_view bytes() const noexcept
+    {
+        return _spooled ? std::string_view() : std::string_view(_buffer);
+    }
+
+    /// The file holding the body of the current message from offset 0 on if spooled, or -1.
+    ///
+    /// The file is reused for the next message that is spooled, see releaseFile().
+    int fd() const noexcept { return _spooled ? _fd : -1; }
+
+    /// Maps the spooled body of the current message.
+    ///
+    /// @throw std::system_error if the file cannot be mapped.
+    MappedFile map() const { return MappedFile(fd(), _spooled ? _size : 0); }
+
+    /// Writes the body of the current message to @p socket, starting at @p offset: by sendfile() if
+    /// spooled, write() otherwise.
+    ///
+    /// @return number of bytes written, or -1 with errno set (e.g. EAGAIN for non-blocking sockets)
+    ssize_t sendTo(int socket, size_t offset) const noexcept;
+
+    /// Hands the file holding the body of the current message over to the caller, who is to close it,
+    /// e.g. to keep it beyond the next message. A new file is created for the next message spooled.
+    ///
+    /// @return the file, or -1 if the body is not spooled
+    int releaseFile() noexcept;
+
+    /// Whether or not the body of the current message failed to spool.
+    bool failed() const noexcept { return _failed; }
+
+    void onProxyHeader(HttpProxyHeader const& header) override;
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override;
+    void onMessageBegin() override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+    bool onExpectContinue() override;
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+  private:
+    void reset() noexcept;
+    bool spill();
+    bool write(std::string_view bytes) noexcept;
+    void fail();
+
+    HttpListener* _next;
+    std::function<void()> _error;
+    std::string _directory;
+    size_t _threshold;
+    size_t _batchSize;
+
+    std::string _buffer; //!< the body if held in memory, else the batch not yet written
+    int _fd = -1;        //!< spool file, reused across messages
+    size_t _size = 0;    //!< body bytes received
+    size_t _written = 0; //!< body bytes written to the spool file
+    bool _spooled = false;
+    bool _failed = false;
+};
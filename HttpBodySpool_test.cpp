@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+#include "HttpBodySpool.h"
+
+namespace
+{
+
+/// Takes a copy of the body at the end of every message.
+struct BodyCollector: public HttpListener
+{
+    HttpBodySpool* spool = nullptr;
+    std::string client;
+    std::string body;
+    bool spooled = false;
+    int messages = 0;
+
+    void onProxyHeader(HttpProxyHeader const& header) override { client = header.sourceAddress; }
+    void onMessageContent(std::string_view) override { FAIL("content is not to be forwarded"); }
+    void onMessageEnd() override
+    {
+        ++messages;
+        spooled = spool->isSpooled();
+        if (spooled)
+        {
+            body.resize(spool->size());
+            REQUIRE(static_cast<ssize_t>(body.size()) == ::pread(spool->fd(), body.data(), body.size(), 0));
+        }
+        else
+            body = spool->bytes();
+    }
+};
+
+std::string request(std::string const& body)
+{
+    return "POST /upload HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+/// Parses @p input in fragments of @p fragmentSize bytes.
+void parse(HttpParser& parser, std::string_view input, size_t fragmentSize)
+{
+    for (size_t offset = 0; offset < input.size();)
+    {
+        auto const n = parser.parseFragment(input.substr(offset, fragmentSize));
+        if (n == 0)
+            break;
+        offset += n;
+    }
+}
+
+std::string pattern(size_t size)
+{
+    std::string result(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        result[i] = static_cast<char>('a' + i % 26);
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("HttpBodySpool.memory")
+{
+    BodyCollector collector;
+    HttpBodySpool spool(&collector, {}, "/tmp", 100, 64);
+    collector.spool = &spool;
+    HttpParser parser(HttpParseMode::REQUEST, &spool);
+
+    parse(parser, request(pattern(100)), 7);
+    REQUIRE(1 == collector.messages);
+    REQUIRE(!collector.spooled);
+    REQUIRE(pattern(100) == collector.body);
+    REQUIRE(-1 == spool.fd());
+}
+
+TEST_CASE("HttpBodySpool.spooled")
+{
+    for (auto const* directory: { "/tmp", "" })
+    {
+        BodyCollector collector;
+        HttpBodySpool spool(&collector, {}, directory, 100, 64);
+        collector.spool = &spool;
+        HttpParser parser(HttpParseMode::REQUEST, &spool);
+
+        // fragments smaller and larger than a batch, and a smaller body reusing the file
+        for (size_t const fragmentSize: { 10, 1000 })
+        {
+            parse(parser, request(pattern(5000)), fragmentSize);
+            REQUIRE(collector.spooled);
+            REQUIRE(pattern(5000) == collector.body);
+            REQUIRE(pattern(5000) == spool.map().bytes());
+        }
+        parse(parser, request(pattern(300)), 1000);
+        REQUIRE(pattern(300) == collector.body);
+        REQUIRE(pattern(300) == spool.map().bytes());
+
+        // handing the file over
+        auto const fd = spool.releaseFile();
+        REQUIRE(fd >= 0);
+        parse(parser, request(pattern(200)), 1000);
+        REQUIRE(pattern(200) == collector.body);
+        REQUIRE(fd != spool.fd());
+        ::close(fd);
+    }
+}
+
+TEST_CASE("HttpBodySpool.sendTo")
+{
+    BodyCollector collector;
+    HttpBodySpool spool(&collector, {}, "/tmp", 100, 64);
+    collector.spool = &spool;
+    HttpParser parser(HttpParseMode::REQUEST, &spool);
+
+    for (size_t const size: { 50, 3000 })
+    {
+        parse(parser, request(pattern(size)), 500);
+
+        auto* const output = std::tmpfile();
+        REQUIRE(output);
+        size_t offset = 10;
+        while (auto const n = spool.sendTo(::fileno(output), offset))
+        {
+            REQUIRE(n > 0);
+            offset += static_cast<size_t>(n);
+        }
+
+        std::string sent(size - 10, '\0');
+        REQUIRE(static_cast<ssize_t>(sent.size()) == ::pread(::fileno(output), sent.data(), sent.size(), 0));
+        REQUIRE(pattern(size).substr(10) == sent);
+        std::fclose(output);
+    }
+}
+
+TEST_CASE("HttpBodySpool.failure")
+{
+    int errors = 0;
+    BodyCollector collector;
+    HttpBodySpool spool(&collector, [&] { ++errors; }, "/nonexistent/directory", 100, 64);
+    collector.spool = &spool;
+    HttpParser parser(HttpParseMode::REQUEST, &spool);
+
+    parse(parser, request(pattern(1000)), 10);
+    REQUIRE(1 == errors);
+    REQUIRE(1 == collector.messages);
+    REQUIRE(spool.failed());
+    REQUIRE(collector.body.empty());
+
+    // small bodies are fine still
+    parse(parser, request(pattern(10)), 10);
+    REQUIRE(1 == errors);
+    REQUIRE(!spool.failed());
+    REQUIRE(pattern(10) == collector.body);
+}
+
+TEST_CASE("HttpBodySpool.proxyHeader")
+{
+    BodyCollector collector;
+    HttpBodySpool spool(&collector, {}, "/tmp", 100, 64);
+    collector.spool = &spool;
+    HttpParser parser(HttpParseMode::REQUEST, &spool);
+    parser.expectProxyHeader();
+
+    parse(parser, "PROXY TCP4 192.0.2.1 198.51.100.2 56324 443\r\n" + request(pattern(10)), 7);
+    REQUIRE("192.0.2.1" == collector.client);
+    REQUIRE(1 == collector.messages);
+    REQUIRE(pattern(10) == collector.body);
+}
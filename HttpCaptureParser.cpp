@@ -0,0 +1,453 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpCaptureParser.h"
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+namespace
+{
+
+constexpr size_t MaxStartLineSize = 8192; //!< longer lines are not taken for start-lines when guessing
+
+enum class EventType : uint8_t
+{
+    RequestBegin,
+    ResponseBegin,
+    MessageBegin,
+    Header,
+    HeaderEnd,
+    Content,
+    End,
+    ProtocolError,
+};
+
+struct Event
+{
+    EventType type;
+    HttpVersion version;
+    HttpStatus status;
+    std::string_view first;  //!< method, status text, header name or content
+    std::string_view second; //!< entity or header value
+};
+
+bool isDigit(char c) noexcept
+{
+    return c >= '0' && c <= '9';
+}
+
+/// Checks for "HTTP/d.d" at the start of @p text.
+bool startsWithVersion(std::string_view text) noexcept
+{
+    return text.size() >= 8 && text.starts_with("HTTP/") && isDigit(text[5]) && text[6] == '.' && isDigit(text[7]);
+}
+
+/// Tells whether @p line (without its line break) looks like the start-line of a message in @p mode.
+bool looksLikeStartLine(std::string_view line, HttpParseMode mode) noexcept
+{
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+
+    if (mode == HttpParseMode::RESPONSE)
+        return startsWithVersion(line) && line.size() >= 12 && line[8] == ' ' && isDigit(line[9])
+               && isDigit(line[10]) && isDigit(line[11]) && (line.size() == 12 || line[12] == ' ');
+
+    // method SP request-target SP HTTP-version, with methods in upper case (as all registered ones are)
+    auto const methodEnd = line.find(' ');
+    if (methodEnd == 0 || methodEnd == std::string_view::npos
+        || !std::all_of(line.begin(), line.begin() + methodEnd, [](char c) { return (c >= 'A' && c <= 'Z') || c == '-'; }))
+        return false;
+
+    auto const targetEnd = line.rfind(' ');
+    return targetEnd > methodEnd + 1 && line.size() - targetEnd == 9 && startsWithVersion(line.substr(targetEnd + 1));
+}
+
+/// @return the offset of the first line at or after @p from that looks like a start-line, or the end of
+///         @p bytes if there is none.
+size_t guessMessageStart(std::string_view bytes, size_t from, HttpParseMode mode) noexcept
+{
+    auto lineStart = from;
+    if (lineStart > 0 && bytes[lineStart - 1] != '\n')
+    {
+        lineStart = bytes.find('\n', lineStart);
+        lineStart = lineStart == std::string_view::npos ? bytes.size() : lineStart + 1;
+    }
+
+    while (lineStart < bytes.size())
+    {
+        auto const lineEnd = bytes.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos)
+            break;
+
+        if (lineEnd - lineStart <= MaxStartLineSize
+            && looksLikeStartLine(bytes.substr(lineStart, lineEnd - lineStart), mode))
+            return lineStart;
+
+        lineStart = lineEnd + 1;
+    }
+
+    return bytes.size();
+}
+
+/// Runs @p fn(thread) on @p count threads, the calling thread being the last of them.
+template <typename Fn>
+void runOnThreads(unsigned count, Fn const& fn)
+{
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t + 1 < count; ++t)
+        threads.emplace_back([&fn, t]() { fn(t); });
+    fn(count - 1);
+    for (auto& thread: threads)
+        thread.join();
+}
+
+} // namespace
+
+// {{{ internals
+struct HttpCaptureParser::Chunk
+{
+    enum class Status
+    {
+        Pending,
+        Parsing,
+        Parsed,
+        Confirmed,
+        Replaying,
+        Replayed,
+    };
+
+    Chunk(size_t begin, size_t limit) noexcept: begin(begin), limit(limit) {}
+
+    void clear() noexcept
+    {
+        events = {};
+        copies = {};
+        messages = 0;
+        stopped = false;
+        failed = false;
+    }
+
+    size_t begin; //!< guessed start of the first message, confirmed later on
+    size_t limit; //!< guessed start of the next chunk: parsing stops at the first message ending there or beyond
+    size_t end = 0;
+    Status status = Status::Pending;
+    std::vector<Event> events;
+    std::deque<std::string> copies; //!< tokens the parser had to assemble, e.g. folded header values
+    size_t messages = 0;
+    bool stopped = false; //!< nothing after this chunk is parsed, due to a protocol error or an upgrade
+    bool failed = false;
+};
+
+/// Records the events of a chunk, referring to the input wherever possible.
+class HttpCaptureParser::Recorder final: public HttpListener
+{
+  public:
+    Recorder(std::string_view input, Chunk& chunk) noexcept: _input(input), _chunk(chunk) {}
+
+    bool messageEnded = false;
+
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override
+    {
+        record(EventType::RequestBegin, method, entity, version);
+    }
+
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override
+    {
+        record(EventType::ResponseBegin, text, {}, version, code);
+    }
+
+    void onMessageBegin() override { record(EventType::MessageBegin); }
+
+    void onMessageHeader(std::string_view name, std::string_view value) override
+    {
+        record(EventType::Header, name, value);
+    }
+
+    void onMessageHeaderEnd() override { record(EventType::HeaderEnd); }
+
+    void onMessageContent(std::string_view chunk) override { record(EventType::Content, chunk); }
+
+    void onMessageEnd() override
+    {
+        record(EventType::End);
+        ++_chunk.messages;
+        messageEnded = true;
+    }
+
+    void onProtocolError() override { record(EventType::ProtocolError); }
+
+  private:
+    void record(EventType type,
+                std::string_view first = {},
+                std::string_view second = {},
+                HttpVersion version = HttpVersion::UNKNOWN,
+                HttpStatus status = {})
+    {
+        _chunk.events.push_back(Event { type, version, status, retain(first), retain(second) });
+    }
+
+    /// @return @p token itself if it refers to the input, a copy that lives as long as the chunk otherwise.
+    std::string_view retain(std::string_view token)
+    {
+        if (token.empty()
+            || (std::less_equal<char const*>()(_input.data(), token.data())
+                && std::less_equal<char const*>()(token.data() + token.size(), _input.data() + _input.size())))
+            return token;
+
+        return _chunk.copies.emplace_back(token);
+    }
+
+    std::string_view _input;
+    Chunk& _chunk;
+};
+// }}}
+
+HttpCaptureParser::HttpCaptureParser(std::string_view bytes, HttpParseMode mode) noexcept:
+    _bytes(bytes), _mode(mode)
+{
+}
+
+std::unique_ptr<HttpCaptureParser> HttpCaptureParser::open(std::string const& path, HttpParseMode mode)
+{
+    auto file = MappedFile(path);
+    auto parser = std::make_unique<HttpCaptureParser>(file.bytes(), mode);
+    parser->_file = std::move(file);
+    return parser;
+}
+
+HttpCaptureParser::~HttpCaptureParser() = default;
+
+unsigned HttpCaptureParser::threadCount() const noexcept
+{
+    if (_threadCount)
+        return _threadCount;
+
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+HttpCaptureResult HttpCaptureParser::parse(HttpListener& listener)
+{
+    return run(nullptr, &listener);
+}
+
+HttpCaptureResult HttpCaptureParser::parseUnordered(std::function<HttpListener&(unsigned thread)> const& listenerOf)
+{
+    return run(&listenerOf, nullptr);
+}
+
+void HttpCaptureParser::guessStarts(unsigned threads)
+{
+    auto const count =
+        _mode == HttpParseMode::MESSAGE ? 1 : std::max<size_t>((_bytes.size() + _chunkSize - 1) / _chunkSize, 1);
+
+    std::vector<size_t> guesses(count);
+    runOnThreads(std::min<size_t>(threads, count), [&](unsigned thread) {
+        for (size_t k = thread; k < count; k += threads)
+            guesses[k] = k == 0 ? 0 : guessMessageStart(_bytes, k * _chunkSize, _mode);
+    });
+
+    // a chunk without any start-line of its own merges into the one before
+    _chunks.clear();
+    for (auto const guess: guesses)
+    {
+        if (!_chunks.empty() && (guess <= _chunks.back()->begin || guess == _bytes.size()))
+            continue;
+        if (!_chunks.empty())
+            _chunks.back()->limit = guess;
+        _chunks.push_back(std::make_unique<Chunk>(guess, _bytes.size()));
+    }
+}
+
+void HttpCaptureParser::parseChunk(Chunk& chunk) const
+{
+    Recorder recorder(_bytes, chunk);
+    HttpParser parser(_mode, &recorder);
+
+    auto offset = chunk.begin;
+    while (offset < chunk.limit)
+    {
+        recorder.messageEnded = false;
+        offset += parser.parseFragment(_bytes.substr(offset));
+
+        if (parser.state() == HttpParserState::PROTOCOL_ERROR || parser.isUpgraded())
+        {
+            chunk.stopped = true;
+            chunk.failed = !parser.isUpgraded();
+            break;
+        }
+
+        if (!recorder.messageEnded)
+            break; // the input ends within this message
+    }
+    chunk.end = offset;
+}
+
+/// Confirms the parsed chunks at the front, in order, sending the first one whose start has been guessed
+/// wrong back to be parsed again.
+void HttpCaptureParser::confirmChunks()
+{
+    while (_confirmed < _last)
+    {
+        auto& chunk = *_chunks[_confirmed];
+        if (chunk.status != Chunk::Status::Parsed)
+            break;
+
+        if (chunk.begin != _expectedBegin)
+        {
+            chunk.clear();
+            chunk.begin = _expectedBegin;
+            chunk.status = Chunk::Status::Pending;
+            ++_result.resynchronized;
+            break;
+        }
+
+        chunk.status = Chunk::Status::Confirmed;
+        _result.messages += chunk.messages;
+        _result.bytesParsed = chunk.end;
+        _expectedBegin = chunk.end;
+        ++_confirmed;
+
+        if (chunk.stopped)
+        {
+            _result.failed = chunk.failed;
+            _last = _confirmed;
+        }
+    }
+}
+
+void HttpCaptureParser::replayChunk(Chunk& chunk, HttpListener& listener)
+{
+    for (auto const& event: chunk.events)
+    {
+        switch (event.type)
+        {
+            case EventType::RequestBegin:
+                listener.onMessageBegin(event.first, event.second, event.version);
+                break;
+            case EventType::ResponseBegin:
+                listener.onMessageBegin(event.version, event.status, event.first);
+                break;
+            case EventType::MessageBegin:
+                listener.onMessageBegin();
+                break;
+            case EventType::Header:
+                listener.onMessageHeader(event.first, event.second);
+                break;
+            case EventType::HeaderEnd:
+                listener.onMessageHeaderEnd();
+                break;
+            case EventType::Content:
+                listener.onMessageContent(event.first);
+                break;
+            case EventType::End:
+                listener.onMessageEnd();
+                break;
+            case EventType::ProtocolError:
+                listener.onProtocolError();
+                break;
+        }
+    }
+    chunk.clear();
+}
+
+/// Worker thread: parses chunks as they become due and, given a @p listener, replays confirmed ones into it.
+void HttpCaptureParser::work(HttpListener* listener)
+{
+    std::unique_lock lock(_mutex);
+    while (_confirmed < _last || (listener && _released < _last))
+    {
+        Chunk* replay = nullptr;
+        for (auto k = _released; listener && k < _confirmed && !replay; ++k)
+            if (_chunks[k]->status == Chunk::Status::Confirmed)
+                replay = _chunks[k].get();
+
+        if (replay)
+        {
+            replay->status = Chunk::Status::Replaying;
+            lock.unlock();
+            replayChunk(*replay, *listener);
+            lock.lock();
+            replay->status = Chunk::Status::Replayed;
+            while (_released < _last && _chunks[_released]->status == Chunk::Status::Replayed)
+                ++_released;
+            _changed.notify_all();
+            continue;
+        }
+
+        // chunks are parsed ahead of replaying within a window only, so as to bound memory use
+        Chunk* pending = nullptr;
+        auto const windowEnd = std::min(_last, std::max(_released + _window, _confirmed + 1));
+        for (auto k = _confirmed; k < windowEnd && !pending; ++k)
+            if (_chunks[k]->status == Chunk::Status::Pending)
+                pending = _chunks[k].get();
+
+        if (pending)
+        {
+            pending->status = Chunk::Status::Parsing;
+            lock.unlock();
+            parseChunk(*pending);
+            lock.lock();
+            pending->status = Chunk::Status::Parsed;
+            confirmChunks();
+            _changed.notify_all();
+            continue;
+        }
+
+        if (_confirmed == _last)
+            break; // whatever is left to replay is being replayed by others
+
+        _changed.wait(lock);
+    }
+}
+
+HttpCaptureResult HttpCaptureParser::run(std::function<HttpListener&(unsigned thread)> const* listenerOf,
+                                         HttpListener* orderedListener)
+{
+    auto const threads = threadCount();
+    guessStarts(threads);
+
+    _window = 4 * size_t { threads };
+    _confirmed = 0;
+    _released = 0;
+    _last = _chunks.size();
+    _expectedBegin = 0;
+    _result = {};
+    _result.chunks = _chunks.size();
+
+    std::vector<HttpListener*> listeners(threads, nullptr);
+    if (listenerOf)
+        for (unsigned t = 0; t < threads; ++t)
+            listeners[t] = &(*listenerOf)(t);
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back([this, listener = listeners[t]]() { work(listener); });
+
+    if (orderedListener)
+    {
+        std::unique_lock lock(_mutex);
+        while (_released < _last)
+        {
+            auto& chunk = *_chunks[_released];
+            if (chunk.status != Chunk::Status::Confirmed)
+            {
+                _changed.wait(lock);
+                continue;
+            }
+
+            chunk.status = Chunk::Status::Replaying;
+            lock.unlock();
+            replayChunk(chunk, *orderedListener);
+            lock.lock();
+            chunk.status = Chunk::Status::Replayed;
+            ++_released;
+            _changed.notify_all();
+        }
+    }
+
+    for (auto& worker: workers)
+        worker.join();
+
+    _chunks.clear();
+    return _result;
+}
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HttpMessageParser.h"
+#include "MappedFile.h"
+
+/// Outcome of parsing a capture with HttpCaptureParser.
+struct HttpCaptureResult
+{
+    size_t messages = 0;       //!< messages parsed completely
+    size_t bytesParsed = 0;    //!< offset up to which the input has been parsed
+    size_t chunks = 0;         //!< chunks the input has been cut into
+    size_t resynchronized = 0; //!< chunks parsed again, because the start guessed for them was off
+    bool failed = false;       //!< parsing stopped at a protocol error, at offset bytesParsed
+};
+
+/// Parses a file of concatenated raw HTTP/1 messages (a capture or a replay log) on several threads.
+///
+/// The input is memory-mapped and cut into chunks. The start of the first message of every chunk is
+/// guessed in parallel, by scanning for a line that looks like a request-line (or status-line). The
+/// chunks are then parsed from those guesses by a pool of threads, each of them taking the next chunk
+/// as soon as it is idle. A guess is confirmed once the chunk before has been parsed up to exactly that
+/// offset. Otherwise (e.g. the guess was inside a body) the chunk is parsed again, from where its
+/// predecessor actually ended. Events are recorded per chunk, as views into the mapping, and replayed
+/// once confirmed, so listeners see what a single HttpParser over the whole input would report.
+///
+/// Only chunks whose guess is off are parsed twice, so throughput scales with cores for typical
+/// captures. Input in HttpParseMode::MESSAGE has no start-lines to look for and is parsed as one chunk.
+class HttpCaptureParser
+{
+  public:
+    static constexpr size_t DefaultChunkSize = 4 * 1024 * 1024;
+
+    /// Parses @p bytes, which must outlive the parser.
+    HttpCaptureParser(std::string_view bytes, HttpParseMode mode) noexcept;
+
+    /// Parses the file at @p path, memory-mapped for as long as the parser lives.
+    ///
+    /// @throw std::system_error if the file cannot be opened or mapped.
+    static std::unique_ptr<HttpCaptureParser> open(std::string const& path,
+                                                   HttpParseMode mode = HttpParseMode::REQUEST);
+
+    ~HttpCaptureParser();
+
+    HttpCaptureParser(HttpCaptureParser const&) = delete;
+    HttpCaptureParser& operator=(HttpCaptureParser const&) = delete;
+
+    void setChunkSize(size_t size) noexcept { _chunkSize = size ? size : 1; }
+
+    /// Number of worker threads, 0 (the default) for one per core.
+    void setThreadCount(unsigned count) noexcept { _threadCount = count; }
+
+    std::string_view bytes() const noexcept { return _bytes; }
+
+    /// Parses the input, delivering all events to @p listener in input order, on the calling thread.
+    HttpCaptureResult parse(HttpListener& listener);
+
+    /// Parses the input, delivering the events of every chunk to the listener of the worker thread that
+    /// happens to replay it.
+    ///
+    /// The events of each message arrive in order, at a single listener, but messages of different
+    /// chunks arrive in no particular order.
+    ///
+    /// @param listenerOf returns the listener of worker @p thread, called once per worker before
+    ///                   parsing starts
+    HttpCaptureResult parseUnordered(std::function<HttpListener&(unsigned thread)> const& listenerOf);
+
+  private:
+    struct Chunk;
+    class Recorder;
+
+    HttpCaptureResult run(std::function<HttpListener&(unsigned thread)> const* listenerOf,
+                          HttpListener* orderedListener);
+    unsigned threadCount() const noexcept;
+    void guessStarts(unsigned threads);
+    void parseChunk(Chunk& chunk) const;
+    void confirmChunks();
+    void replayChunk(Chunk& chunk, HttpListener& listener);
+    void work(HttpListener* listener);
+
+    std::string_view _bytes;
+    HttpParseMode _mode;
+    MappedFile _file; //!< backing _bytes, if opened from a file
+    size_t _chunkSize = DefaultChunkSize;
+    unsigned _threadCount = 0;
+
+    // state of the parse being run, guarded by _mutex
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::vector<std::unique_ptr<Chunk>> _chunks;
+    size_t _window = 0;        //!< chunks parsed ahead of the first one not replayed yet
+    size_t _confirmed = 0;     //!< chunks confirmed, from the front
+    size_t _released = 0;      //!< chunks replayed, from the front
+    size_t _last = 0;          //!< number of chunks to replay, less than all after a protocol error
+    size_t _expectedBegin = 0; //!< where the first chunk not confirmed yet must begin
+    HttpCaptureResult _result;
+};
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "HttpCaptureParser.h"
+
+namespace
+{
+
+/// Records the events as lines of text, one string per message.
+struct MessageCollector: public HttpListener
+{
+    std::vector<std::string> messages;
+    std::string current;
+    int errors = 0;
+
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override
+    {
+        current += std::string(method) + " " + std::string(entity) + " " + std::to_string(static_cast<int>(version))
+                   + "\n";
+    }
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override
+    {
+        current += std::to_string(static_cast<int>(version)) + " " + std::to_string(static_cast<int>(code)) + " "
+                   + std::string(text) + "\n";
+    }
+    void onMessageHeader(std::string_view name, std::string_view value) override
+    {
+        current += std::string(name) + ": " + std::string(value) + "\n";
+    }
+    void onMessageHeaderEnd() override { current += "\n"; }
+    void onMessageContent(std::string_view chunk) override { current += chunk; }
+    void onMessageEnd() override { messages.push_back(std::exchange(current, {})); }
+    void onProtocolError() override { ++errors; }
+};
+
+/// Requests whose bodies look like requests, to throw off guessing where they start.
+std::string requests(size_t count)
+{
+    std::string result;
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const id = std::to_string(i);
+        switch (i % 4)
+        {
+            case 0:
+                result += "GET /item/" + id + " HTTP/1.1\r\nHost: example.com\r\n\r\n";
+                break;
+            case 1:
+            {
+                auto const body = "GET /not/a/request HTTP/1.1\r\nHost: body\r\n\r\n" + std::string(i % 50, 'x');
+                result += "POST /upload/" + id + " HTTP/1.1\r\nContent-Length: " + std::to_string(body.size())
+                          + "\r\n\r\n" + body;
+                break;
+            }
+            case 2:
+                result += "PUT /chunked/" + id + " HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                          "1f\r\nDELETE /fake HTTP/1.1\r\nX: y\r\n\r\n\r\n0\r\n\r\n";
+                break;
+            default:
+                result += "GET /folded/" + id + " HTTP/1.1\r\nX-Folded: first\r\n second\r\n\r\n";
+                break;
+        }
+    }
+    return result;
+}
+
+/// The messages a single HttpParser reports for @p input.
+MessageCollector parseSequentially(std::string_view input, HttpParseMode mode)
+{
+    MessageCollector collector;
+    HttpParser parser(mode, &collector);
+    for (size_t offset = 0; offset < input.size();)
+    {
+        auto const n = parser.parseFragment(input.substr(offset));
+        offset += n;
+        if (n == 0 || parser.state() == HttpParserState::PROTOCOL_ERROR)
+            break;
+    }
+    return collector;
+}
+
+} // namespace
+
+TEST_CASE("HttpCaptureParser.ordered")
+{
+    auto const input = requests(400);
+    auto const expected = parseSequentially(input, HttpParseMode::REQUEST);
+    REQUIRE(400 == expected.messages.size());
+
+    for (size_t const chunkSize: { 1, 7, 100, 4096, 1 << 20 })
+    {
+        HttpCaptureParser capture(input, HttpParseMode::REQUEST);
+        capture.setChunkSize(chunkSize);
+        capture.setThreadCount(4);
+
+        MessageCollector collector;
+        auto const result = capture.parse(collector);
+        REQUIRE(!result.failed);
+        REQUIRE(400 == result.messages);
+        REQUIRE(input.size() == result.bytesParsed);
+        REQUIRE(expected.messages == collector.messages);
+        if (chunkSize == 100)
+            REQUIRE(result.resynchronized > 0); // some chunks start with a body
+    }
+}
+
+TEST_CASE("HttpCaptureParser.unordered")
+{
+    auto const input = requests(400);
+    auto expected = parseSequentially(input, HttpParseMode::REQUEST).messages;
+
+    HttpCaptureParser capture(input, HttpParseMode::REQUEST);
+    capture.setChunkSize(512);
+    capture.setThreadCount(3);
+
+    std::vector<MessageCollector> collectors(3);
+    auto const result = capture.parseUnordered([&](unsigned thread) -> HttpListener& { return collectors[thread]; });
+    REQUIRE(400 == result.messages);
+
+    std::vector<std::string> messages;
+    for (auto const& collector: collectors)
+        messages.insert(messages.end(), collector.messages.begin(), collector.messages.end());
+    std::sort(messages.begin(), messages.end());
+    std::sort(expected.begin(), expected.end());
+    REQUIRE(expected == messages);
+}
+
+TEST_CASE("HttpCaptureParser.responses")
+{
+    std::string input;
+    for (int i = 0; i < 100; ++i)
+        input += "HTTP/1.1 200 OK\r\nContent-Length: 26\r\n\r\nHTTP/1.1 404 Not Found\r\n\r\n"
+                 "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n";
+
+    HttpCaptureParser capture(input, HttpParseMode::RESPONSE);
+    capture.setChunkSize(64);
+    capture.setThreadCount(4);
+
+    MessageCollector collector;
+    auto const result = capture.parse(collector);
+    REQUIRE(200 == result.messages);
+    REQUIRE(parseSequentially(input, HttpParseMode::RESPONSE).messages == collector.messages);
+}
+
+TEST_CASE("HttpCaptureParser.protocolError")
+{
+    auto const head = requests(50);
+    auto const input = head + "GARBAGE\x01\r\n\r\n" + requests(50);
+
+    HttpCaptureParser capture(input, HttpParseMode::REQUEST);
+    capture.setChunkSize(100);
+    capture.setThreadCount(4);
+
+    MessageCollector collector;
+    auto const result = capture.parse(collector);
+    REQUIRE(result.failed);
+    REQUIRE(50 == result.messages);
+    REQUIRE(50 == collector.messages.size());
+    REQUIRE(1 == collector.errors);
+    REQUIRE(result.bytesParsed >= head.size());
+    REQUIRE(result.bytesParsed < head.size() + 10);
+}
+
+TEST_CASE("HttpCaptureParser.file")
+{
+    auto const path = std::string("HttpCaptureParser_test.capture");
+    auto const input = requests(100);
+    std::ofstream(path, std::ios::binary) << input;
+
+    {
+        auto const capture = HttpCaptureParser::open(path);
+        REQUIRE(input == capture->bytes());
+
+        MessageCollector collector;
+        REQUIRE(100 == capture->parse(collector).messages);
+    }
+    std::remove(path.c_str());
+
+    REQUIRE_THROWS_AS(HttpCaptureParser::open(path), std::system_error);
+}
@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpEventLog.h"
+
+namespace
+{
+
+enum EventType : uint8_t
+{
+    PROXY_HEADER = 1,   // version, local, family, source, destination, source port, destination port, TLVs
+    REQUEST_BEGIN,      // version, method, entity
+    RESPONSE_BEGIN,     // version, status code, status text
+    MESSAGE_BEGIN,      // -
+    HEADER_LITERAL,     // name (appended to the name table), value
+    HEADER_INDEXED,     // index into the name table, value
+    HEADER_END,         // -
+    CONTENT,            // chunk
+    MESSAGE_END,        // -
+    PROTOCOL_ERROR,     // -
+    EXPECT_CONTINUE,    // -
+};
+
+constexpr int MaxVarintBytes = 10; // 64 bits, 7 per byte
+
+} // namespace
+
+// {{{ HttpEventLogWriter
+HttpEventLogWriter::HttpEventLogWriter(): _log(Magic)
+{
+}
+
+std::string HttpEventLogWriter::release()
+{
+    auto log = std::exchange(_log, std::string(Magic));
+    _eventCount = 0;
+    _names.clear();
+    return log;
+}
+
+void HttpEventLogWriter::beginEvent(uint8_t type)
+{
+    _log += static_cast<char>(type);
+    ++_eventCount;
+}
+
+void HttpEventLogWriter::writeNumber(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        _log += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    _log += static_cast<char>(value);
+}
+
+void HttpEventLogWriter::writeString(std::string_view value)
+{
+    writeNumber(value.size());
+    _log += value;
+}
+
+void HttpEventLogWriter::onProxyHeader(HttpProxyHeader const& header)
+{
+    beginEvent(PROXY_HEADER);
+    writeNumber(static_cast<uint64_t>(header.version));
+    writeNumber(header.local ? 1 : 0);
+    writeNumber(static_cast<uint64_t>(header.family));
+    writeString(header.sourceAddress);
+    writeString(header.destinationAddress);
+    writeNumber(header.sourcePort);
+    writeNumber(header.destinationPort);
+    writeString(header.tlvs);
+}
+
+void HttpEventLogWriter::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version)
+{
+    beginEvent(REQUEST_BEGIN);
+    writeNumber(static_cast<uint64_t>(version));
+    writeString(method);
+    writeString(entity);
+}
+
+void HttpEventLogWriter::onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text)
+{
+    beginEvent(RESPONSE_BEGIN);
+    writeNumber(static_cast<uint64_t>(version));
+    writeNumber(static_cast<uint64_t>(code));
+    writeString(text);
+}
+
+void HttpEventLogWriter::onMessageBegin()
+{
+    beginEvent(MESSAGE_BEGIN);
+}
+
+void HttpEventLogWriter::onMessageHeader(std::string_view name, std::string_view value)
+{
+    // names are indexed as logged, so that the replayer can rebuild the table on its own
+    if (auto const i = _names.find(name); i != _names.end())
+    {
+        beginEvent(HEADER_INDEXED);
+        writeNumber(i->second);
+    }
+    else
+    {
+        if (_names.size() < MaxNames)
+            _names.emplace(name, static_cast<uint32_t>(_names.size()));
+        beginEvent(HEADER_LITERAL);
+        writeString(name);
+    }
+    writeString(value);
+}
+
+void HttpEventLogWriter::onMessageHeaderEnd()
+{
+    beginEvent(HEADER_END);
+}
+
+bool HttpEventLogWriter::onExpectContinue()
+{
+    beginEvent(EXPECT_CONTINUE);
+    return true;
+}
+
+void HttpEventLogWriter::onMessageContent(std::string_view chunk)
+{
+    beginEvent(CONTENT);
+    writeString(chunk);
+}
+
+void HttpEventLogWriter::onMessageEnd()
+{
+    beginEvent(MESSAGE_END);
+}
+
+void HttpEventLogWriter::onProtocolError()
+{
+    beginEvent(PROTOCOL_ERROR);
+}
+// }}}
+
+// {{{ HttpEventLogReplayer
+HttpEventLogReplayer::HttpEventLogReplayer(std::string_view log): _log(log)
+{
+    rewind();
+}
+
+HttpEventLogReplayer HttpEventLogReplayer::open(std::string const& path)
+{
+    auto file = MappedFile(path);
+    auto replayer = HttpEventLogReplayer(file.bytes());
+    replayer._file = std::move(file);
+    return replayer;
+}
+
+void HttpEventLogReplayer::rewind() noexcept
+{
+    _names.clear();
+    _failed = !_log.starts_with(HttpEventLogWriter::Magic);
+    _offset = _failed ? _log.size() : HttpEventLogWriter::Magic.size();
+}
+
+bool HttpEventLogReplayer::readNumber(uint64_t& value) noexcept
+{
+    value = 0;
+    for (int k = 0; k < MaxVarintBytes && _offset < _log.size(); ++k)
+    {
+        auto const byte = static_cast<uint8_t>(_log[_offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << (7 * k);
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool HttpEventLogReplayer::readString(std::string_view& value) noexcept
+{
+    uint64_t size = 0;
+    if (!readNumber(size) || size > _log.size() - _offset)
+        return false;
+
+    value = _log.substr(_offset, size);
+    _offset += size;
+    return true;
+}
+
+bool HttpEventLogReplayer::next(HttpListener& listener)
+{
+    if (_failed || _offset == _log.size())
+        return false;
+
+    auto const type = static_cast<uint8_t>(_log[_offset++]);
+    uint64_t version = 0;
+    std::string_view first;
+    std::string_view second;
+
+    switch (type)
+    {
+        case PROXY_HEADER:
+        {
+            HttpProxyHeader header;
+            uint64_t local = 0;
+            uint64_t family = 0;
+            uint64_t sourcePort = 0;
+            uint64_t destinationPort = 0;
+            if (!readNumber(version) || !readNumber(local) || !readNumber(family)
+                || family > static_cast<uint64_t>(HttpProxyHeader::Family::UNIX)
+                || !readString(header.sourceAddress) || !readString(header.destinationAddress)
+                || !readNumber(sourcePort) || sourcePort > 0xFFFF || !readNumber(destinationPort)
+                || destinationPort > 0xFFFF || !readString(header.tlvs))
+                break;
+
+            header.version = static_cast<int>(version);
+            header.local = local != 0;
+            header.family = static_cast<HttpProxyHeader::Family>(family);
+            header.sourcePort = static_cast<uint16_t>(sourcePort);
+            header.destinationPort = static_cast<uint16_t>(destinationPort);
+            listener.onProxyHeader(header);
+            return true;
+        }
+        case REQUEST_BEGIN:
+            if (!readNumber(version) || !readString(first) || !readString(second))
+                break;
+            listener.onMessageBegin(first, second, static_cast<HttpVersion>(version));
+            return true;
+        case RESPONSE_BEGIN:
+        {
+            uint64_t code = 0;
+            if (!readNumber(version) || !readNumber(code) || !readString(first))
+                break;
+            listener.onMessageBegin(static_cast<HttpVersion>(version), static_cast<HttpStatus>(code), first);
+            return true;
+        }
+        case MESSAGE_BEGIN:
+            listener.onMessageBegin();
+            return true;
+        case HEADER_LITERAL:
+            if (!readString(first) || !readString(second))
+                break;
+            if (_names.size() < HttpEventLogWriter::MaxNames)
+                _names.push_back(first);
+            listener.onMessageHeader(first, second);
+            return true;
+        case HEADER_INDEXED:
+        {
+            uint64_t index = 0;
+            if (!readNumber(index) || index >= _names.size() || !readString(second))
+                break;
+            listener.onMessageHeader(_names[index], second);
+            return true;
+        }
+        case HEADER_END:
+            listener.onMessageHeaderEnd();
+            return true;
+        case EXPECT_CONTINUE:
+            listener.onExpectContinue(); // there is no parser to pause
+            return true;
+        case CONTENT:
+            if (!readString(first))
+                break;
+            listener.onMessageContent(first);
+            return true;
+        case MESSAGE_END:
+            listener.onMessageEnd();
+            return true;
+        case PROTOCOL_ERROR:
+            listener.onProtocolError();
+            return true;
+        default:
+            break;
+    }
+
+    _failed = true;
+    return false;
+}
+
+size_t HttpEventLogReplayer::replay(HttpListener& listener)
+{
+    size_t count = 0;
+    while (next(listener))
+        ++count;
+    return count;
+}
+// }}}
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "HttpMessageParser.h"
+#include "MappedFile.h"
+
+/// Records the HttpListener events it receives into a compact binary log, see HttpEventLogReplayer.
+///
+/// The log starts with a magic and version. Every event is a type byte followed by its fields: integers
+/// as LEB128 varints, strings as a varint length and the bytes. Header names are logged once each and
+/// referred to by index from then on. Logs are deterministic, so event streams of two parser builds
+/// over the same input can be compared byte by byte.
+class HttpEventLogWriter final: public HttpListener
+{
+  public:
+    static constexpr std::string_view Magic = "HTTPEVL\x01"; //!< including the format version
+    static constexpr size_t MaxNames = 4096;                  //!< header names indexed per log
+
+    HttpEventLogWriter();
+
+    /// The log written so far, including the magic.
+    std::string_view log() const noexcept { return _log; }
+
+    /// Number of events written so far.
+    size_t eventCount() const noexcept { return _eventCount; }
+
+    /// Hands over the log written so far and starts a new one.
+    std::string release();
+
+    void onProxyHeader(HttpProxyHeader const& header) override;
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override;
+    void onMessageBegin() override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+    bool onExpectContinue() override; //!< logged, going ahead with the body
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+  private:
+    void beginEvent(uint8_t type);
+    void writeNumber(uint64_t value);
+    void writeString(std::string_view value);
+
+    struct NameHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>()(name); }
+    };
+
+    std::string _log;
+    size_t _eventCount = 0;
+    std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> _names; //!< name to index
+};
+
+/// Drives any HttpListener from a log written by HttpEventLogWriter, without parsing HTTP again.
+///
+/// All strings handed to the listener point into the log itself, which is decoded in place.
+class HttpEventLogReplayer
+{
+  public:
+    /// Replays @p log, which must outlive the replayer.
+    explicit HttpEventLogReplayer(std::string_view log);
+
+    /// Replays the log stored in the file at @p path, memory-mapped for as long as the replayer lives.
+    ///
+    /// @throw std::system_error if the file cannot be opened or mapped.
+    static HttpEventLogReplayer open(std::string const& path);
+
+    /// Delivers the next event to @p listener.
+    ///
+    /// @retval true  an event has been delivered
+    /// @retval false the end of the log has been reached, or the log is malformed (see failed())
+    bool next(HttpListener& listener);
+
+    /// Delivers all remaining events to @p listener.
+    ///
+    /// @return the number of events delivered
+    size_t replay(HttpListener& listener);
+
+    /// Starts over from the first event.
+    void rewind() noexcept;
+
+    bool atEnd() const noexcept { return !_failed && _offset == _log.size(); }
+
+    /// Whether or not decoding stopped at malformed data (or the magic did not match).
+    bool failed() const noexcept { return _failed; }
+
+  private:
+    bool readNumber(uint64_t& value) noexcept;
+    bool readString(std::string_view& value) noexcept;
+
+    MappedFile _file; //!< backing _log, if opened from a file
+    std::string_view _log;
+    size_t _offset = 0;
+    bool _failed = false;
+    std::vector<std::string_view> _names;
+};
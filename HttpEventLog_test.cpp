@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "HttpEventLog.h"
+
+namespace
+{
+
+/// Records the events as lines of text.
+struct EventCollector: public HttpListener
+{
+    std::vector<std::string> events;
+
+    void onProxyHeader(HttpProxyHeader const& header) override
+    {
+        events.push_back("proxy " + std::to_string(header.version) + " " + std::string(header.sourceAddress) + ":"
+                         + std::to_string(header.sourcePort) + " " + std::string(header.destinationAddress) + ":"
+                         + std::to_string(header.destinationPort));
+    }
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override
+    {
+        events.push_back(std::string(method) + " " + std::string(entity) + " "
+                         + std::to_string(static_cast<int>(version)));
+    }
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override
+    {
+        events.push_back(std::to_string(static_cast<int>(version)) + " " + std::to_string(static_cast<int>(code))
+                         + " " + std::string(text));
+    }
+    void onMessageBegin() override { events.emplace_back("begin"); }
+    void onMessageHeader(std::string_view name, std::string_view value) override
+    {
+        events.push_back(std::string(name) + ": " + std::string(value));
+    }
+    void onMessageHeaderEnd() override { events.emplace_back("header end"); }
+    bool onExpectContinue() override
+    {
+        events.emplace_back("expect continue");
+        return true;
+    }
+    void onMessageContent(std::string_view chunk) override { events.push_back("content " + std::string(chunk)); }
+    void onMessageEnd() override { events.emplace_back("end"); }
+    void onProtocolError() override { events.emplace_back("error"); }
+};
+
+/// Parses @p input in fragments of @p fragmentSize bytes.
+void parse(HttpParser& parser, std::string_view input, size_t fragmentSize)
+{
+    for (size_t offset = 0; offset < input.size();)
+    {
+        auto const n = parser.parseFragment(input.substr(offset, fragmentSize));
+        if (n == 0)
+            break;
+        offset += n;
+    }
+}
+
+constexpr std::string_view Requests = "PROXY TCP4 192.0.2.1 198.51.100.2 56324 443\r\n"
+                                      "GET /index.html HTTP/1.1\r\n"
+                                      "Host: example.com\r\n"
+                                      "Accept: */*\r\n"
+                                      "\r\n"
+                                      "POST /upload HTTP/1.1\r\n"
+                                      "Host: example.com\r\n"
+                                      "Transfer-Encoding: chunked\r\n"
+                                      "\r\n"
+                                      "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n"
+                                      "PUT /data HTTP/1.1\r\n"
+                                      "Host: example.com\r\n"
+                                      "Expect: 100-continue\r\n"
+                                      "Content-Length: 2\r\n"
+                                      "\r\n"
+                                      "ok"
+                                      "GET /broken HTTP/1.1\r\n"
+                                      "Bad Header\r\n"
+                                      "\r\n";
+
+} // namespace
+
+TEST_CASE("HttpEventLog.roundTrip")
+{
+    EventCollector direct;
+    HttpParser directParser(HttpParseMode::REQUEST, &direct);
+    directParser.expectProxyHeader();
+    parse(directParser, Requests, 7);
+
+    HttpEventLogWriter writer;
+    HttpParser parser(HttpParseMode::REQUEST, &writer);
+    parser.expectProxyHeader();
+    parse(parser, Requests, 7);
+    REQUIRE(writer.eventCount() > 10);
+
+    auto const log = writer.release();
+    REQUIRE(HttpEventLogWriter::Magic == writer.log());
+
+    HttpEventLogReplayer replayer(log);
+    EventCollector replayed;
+    REQUIRE(direct.events.size() == replayer.replay(replayed));
+    REQUIRE(replayer.atEnd());
+    REQUIRE(!replayer.failed());
+    REQUIRE(direct.events == replayed.events);
+    REQUIRE("error" == replayed.events.back());
+    REQUIRE(1 == std::count(replayed.events.begin(), replayed.events.end(), "expect continue"));
+
+    // again, from the start
+    replayer.rewind();
+    EventCollector again;
+    replayer.replay(again);
+    REQUIRE(direct.events == again.events);
+}
+
+TEST_CASE("HttpEventLog.responses")
+{
+    auto const input = std::string_view("HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabc"
+                                        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+
+    EventCollector direct;
+    HttpParser directParser(HttpParseMode::RESPONSE, &direct);
+    parse(directParser, input, input.size());
+
+    HttpEventLogWriter writer;
+    HttpParser parser(HttpParseMode::RESPONSE, &writer);
+    parse(parser, input, input.size());
+
+    // the second Content-Length refers to the first one's name
+    REQUIRE(writer.log().find("Content-Length") == writer.log().rfind("Content-Length"));
+
+    EventCollector replayed;
+    HttpEventLogReplayer(writer.log()).replay(replayed);
+    REQUIRE(direct.events == replayed.events);
+}
+
+TEST_CASE("HttpEventLog.malformed")
+{
+    HttpEventLogWriter writer;
+    writer.onMessageBegin("GET", "/", HttpVersion::VERSION_1_1);
+    writer.onMessageHeader("Host", "example.com");
+    writer.onMessageContent(std::string(300, 'x')); // two-byte length
+    auto const log = std::string(writer.log());
+
+    // truncated anywhere within the last event
+    for (size_t size = log.size() - 302; size < log.size(); ++size)
+    {
+        HttpEventLogReplayer replayer(std::string_view(log).substr(0, size));
+        EventCollector collector;
+        REQUIRE(2 == replayer.replay(collector));
+        REQUIRE(replayer.failed());
+        REQUIRE(!replayer.atEnd());
+    }
+
+    EventCollector collector;
+    REQUIRE(0 == HttpEventLogReplayer("HTTP/1.1 200 OK\r\n").replay(collector)); // not a log
+    REQUIRE(HttpEventLogReplayer("HTTP/1.1 200 OK\r\n").failed());
+
+    // a header name index beyond the names seen so far
+    auto const badIndex = std::string(HttpEventLogWriter::Magic) + "\x06\x05\x01x";
+    REQUIRE(HttpEventLogReplayer(badIndex).replay(collector) == 0);
+}
+
+TEST_CASE("HttpEventLog.file")
+{
+    HttpEventLogWriter writer;
+    HttpParser parser(HttpParseMode::REQUEST, &writer);
+    parse(parser, "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n", 100);
+
+    auto const path = std::string("HttpEventLog_test.log");
+    std::ofstream(path, std::ios::binary) << writer.log();
+
+    {
+        auto replayer = HttpEventLogReplayer::open(path);
+        EventCollector collector;
+        REQUIRE(4 == replayer.replay(collector));
+        REQUIRE(std::vector<std::string> { "GET / 11", "Host: example.com", "header end", "end" }
+                == collector.events);
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpHeadForwarder.h"
+
+#include <algorithm>
+
+#include "HttpAscii.h"
+
+namespace
+{
+
+constexpr std::string_view HeadEnd = "\r\n";
+
+bool isHeadState(HttpParserState state) noexcept
+{
+    switch (groupOf(state))
+    {
+        case HttpParserStateGroup::REQUEST_LINE:
+        case HttpParserStateGroup::STATUS_LINE:
+        case HttpParserStateGroup::HEADER:
+        case HttpParserStateGroup::LWS: return true;
+        default: return false;
+    }
+}
+
+} // namespace
+
+HttpHeadForwarder::HttpHeadForwarder(HttpParseMode mode, HttpListener* listener):
+    _parser(mode, this), _listener(listener)
+{
+}
+
+// {{{ rules
+void HttpHeadForwarder::addHeader(std::string_view name, std::string_view value)
+{
+    _rules.push_back({ std::string(name), std::string(name) + ": " + std::string(value) + "\r\n", false });
+}
+
+void HttpHeadForwarder::setHeader(std::string_view name, std::string_view value)
+{
+    _rules.push_back({ std::string(name), std::string(name) + ": " + std::string(value) + "\r\n", true });
+}
+
+void HttpHeadForwarder::removeHeader(std::string_view name)
+{
+    _rules.push_back({ std::string(name), std::string(), true });
+}
+
+bool HttpHeadForwarder::isLeftOut(std::string_view name) const noexcept
+{
+    for (auto const& rule: _rules)
+        if (rule.replaces && iequals(name, rule.name))
+            return true;
+
+    // framing of the body, which is forwarded as is
+    if (iequals(name, "Transfer-Encoding") || iequals(name, "Trailer"))
+        return false;
+
+    return _parser.isHopByHop(name);
+}
+// }}}
+
+size_t HttpHeadForwarder::parseFragment(std::string_view chunk) noexcept
+{
+    if (_parser.state() == HttpParserState::MESSAGE_BEGIN)
+        _headParsed = false;
+
+    _fragment = chunk;
+    _fragmentOffset = _parser.bytesReceived();
+    auto const n = _parser.parseFragment(chunk);
+
+    // the rest of the head arrives with the next fragment, while this one may be gone by then
+    if (isHeadState(_parser.state()))
+        retainHead();
+
+    return n;
+}
+
+/// Gathers the bytes of the current head parsed so far in _headCopy.
+void HttpHeadForwarder::retainHead()
+{
+    if (_headCopyOffset != _parser.messageOffset())
+    {
+        _headCopy.clear();
+        _headCopyOffset = _parser.messageOffset();
+    }
+
+    auto const begin = _headCopyOffset + _headCopy.size();
+    if (begin >= _fragmentOffset)
+        _headCopy += _fragment.substr(begin - _fragmentOffset, _parser.bytesReceived() - begin);
+}
+
+std::span<iovec const> HttpHeadForwarder::forwardedHead()
+{
+    _segments.clear();
+    if (!_headParsed)
+        return {};
+
+    // runs of received bytes between the lines left out
+    size_t offset = 0;
+    for (auto const& line: _lines)
+    {
+        if (!isLeftOut(_head.substr(line.begin, line.nameLength)))
+            continue;
+
+        append(_head.substr(offset, line.begin - offset));
+        offset = line.end;
+    }
+
+    auto const end = _head.size() - HeadEnd.size();
+    append(_head.substr(offset, end - offset));
+    for (auto const& rule: _rules)
+        append(rule.line);
+    append(_head.substr(end));
+
+    return _segments;
+}
+
+void HttpHeadForwarder::append(std::string_view bytes)
+{
+    if (bytes.empty())
+        return;
+
+    // adjacent ranges (e.g. after a line left out at the very start) go into one segment
+    if (!_segments.empty())
+    {
+        auto& last = _segments.back();
+        if (static_cast<char const*>(last.iov_base) + last.iov_len == bytes.data())
+        {
+            last.iov_len += bytes.size();
+            return;
+        }
+    }
+
+    _segments.push_back({ const_cast<char*>(bytes.data()), bytes.size() });
+}
+
+void HttpHeadForwarder::reset() noexcept
+{
+    _parser.reset();
+    _headCopy.clear();
+    _headCopyOffset = SIZE_MAX;
+    _lines.clear();
+    _head = {};
+    _headParsed = false;
+    _segments.clear();
+}
+
+// {{{ HttpListener
+void HttpHeadForwarder::onProxyHeader(HttpProxyHeader const& header)
+{
+    if (_listener)
+        _listener->onProxyHeader(header);
+}
+
+void HttpHeadForwarder::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version)
+{
+    _lines.clear();
+    if (_listener)
+        _listener->onMessageBegin(method, entity, version);
+}
+
+void HttpHeadForwarder::onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text)
+{
+    _lines.clear();
+    if (_listener)
+        _listener->onMessageBegin(version, code, text);
+}
+
+void HttpHeadForwarder::onMessageBegin()
+{
+    _lines.clear();
+    if (_listener)
+        _listener->onMessageBegin();
+}
+
+void HttpHeadForwarder::onMessageHeader(std::string_view name, std::string_view value)
+{
+    auto const messageOffset = _parser.messageOffset();
+    _lines.push_back({ static_cast<uint32_t>(_parser.headerLineOffset() - messageOffset),
+                       static_cast<uint32_t>(_parser.bytesReceived() - messageOffset),
+                       static_cast<uint32_t>(name.size()) });
+
+    if (_listener)
+        _listener->onMessageHeader(name, value);
+}
+
+void HttpHeadForwarder::onMessageHeaderEnd()
+{
+    auto const messageOffset = _parser.messageOffset();
+    if (_headCopyOffset == messageOffset)
+    {
+        retainHead();
+        _head = _headCopy;
+        _headCopyOffset = SIZE_MAX;
+    }
+    else
+        _head = _fragment.substr(messageOffset - _fragmentOffset, _parser.bytesReceived() - messageOffset);
+    _headParsed = true;
+
+    if (_listener)
+        _listener->onMessageHeaderEnd();
+}
+
+bool HttpHeadForwarder::onExpectContinue()
+{
+    return _listener ? _listener->onExpectContinue() : true;
+}
+
+void HttpHeadForwarder::onMessageContent(std::string_view chunk)
+{
+    if (_listener)
+        _listener->onMessageContent(chunk);
+}
+
+void HttpHeadForwarder::onMessageEnd()
+{
+    if (_listener)
+        _listener->onMessageEnd();
+}
+
+void HttpHeadForwarder::onProtocolError()
+{
+    if (_listener)
+        _listener->onProtocolError();
+}
+// }}}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <sys/uio.h> // iovec
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HttpMessageParser.h"
+
+/// Forwards message heads as received, e.g. from a reverse proxy to its backends, for writev().
+///
+/// The forwarded head is a list of ranges of the received bytes, with the edits spliced in: hop-by-hop
+/// headers (see HttpParser::hopByHopHeaders()) and headers replaced or removed by a rule are left out,
+/// and headers added by a rule go right before the empty line. Nothing is copied or serialized again,
+/// unless a head is split across fragments; then its bytes are gathered in a buffer of its own.
+///
+/// Transfer-Encoding and Trailer are kept, as the body is meant to be forwarded as received, too.
+///
+/// @code
+/// HttpHeadForwarder forwarder(HttpParseMode::REQUEST, &router);
+/// forwarder.addHeader("X-Forwarded-For", clientAddress);
+/// forwarder.setHeader("Host", "backend.internal");
+///
+/// auto const n = forwarder.parseFragment(received);
+/// if (forwarder.hasHead())
+///     backend.writev(forwarder.forwardedHead());
+/// @endcode
+class HttpHeadForwarder final: private HttpListener
+{
+  public:
+    /// @param mode     parsing mode of the messages to forward
+    /// @param listener receives all events as well, e.g. to route the message; may be null
+    explicit HttpHeadForwarder(HttpParseMode mode = HttpParseMode::REQUEST, HttpListener* listener = nullptr);
+
+    HttpHeadForwarder(HttpHeadForwarder const&) = delete;
+    HttpHeadForwarder& operator=(HttpHeadForwarder const&) = delete;
+
+    /// Appends the header @p name with @p value to every forwarded head, next to any such header received
+    /// (e.g. X-Forwarded-For, whose values combine that way).
+    void addHeader(std::string_view name, std::string_view value);
+
+    /// Replaces any header @p name (case-insensitive) of the forwarded heads with one of @p value.
+    void setHeader(std::string_view name, std::string_view value);
+
+    /// Leaves out any header @p name (case-insensitive) of the forwarded heads.
+    void removeHeader(std::string_view name);
+
+    /// Drops all rules set up by addHeader(), setHeader() and removeHeader().
+    void clearRules() noexcept { _rules.clear(); }
+
+    /// Parses @p chunk, see HttpParser::parseFragment().
+    ///
+    /// The forwarded head of a message points into the chunk its head ends in (unless split across
+    /// fragments), which must thus be kept until the head has been written.
+    size_t parseFragment(std::string_view chunk) noexcept;
+
+    /// Whether or not the head of the current message has been parsed completely.
+    bool hasHead() const noexcept { return _headParsed; }
+
+    /// The head of the current message as it is to be forwarded, valid once hasHead() (e.g. from within
+    /// the listener's onMessageHeaderEnd()) until the next call to parseFragment().
+    std::span<iovec const> forwardedHead();
+
+    /// The head of the current message as received.
+    std::string_view head() const noexcept { return _head; }
+
+    HttpParser const& parser() const noexcept { return _parser; }
+
+    /// Expects a PROXY protocol header ahead of the first message, see HttpParser::expectProxyHeader().
+    /// It is reported to the listener, but not forwarded as part of any head.
+    void expectProxyHeader(bool expected = true) noexcept { _parser.expectProxyHeader(expected); }
+
+    void reset() noexcept;
+
+  private:
+    /// A header line of the current head, as offsets relative to the start of the head.
+    struct Line
+    {
+        uint32_t begin;      //!< first byte of the line, i.e. of the header name
+        uint32_t end;        //!< past the CR LF of the line
+        uint32_t nameLength;
+    };
+
+    struct Rule
+    {
+        std::string name;
+        std::string line; //!< serialized header to add, including CR LF, if any
+        bool replaces;    //!< whether or not received headers of that name are left out
+    };
+
+    void retainHead();
+    bool isLeftOut(std::string_view name) const noexcept;
+    void append(std::string_view bytes);
+
+    void onProxyHeader(HttpProxyHeader const& header) override;
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override;
+    void onMessageBegin() override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+    bool onExpectContinue() override;
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+    HttpParser _parser;
+    HttpListener* _listener;
+    std::vector<Rule> _rules;
+
+    std::string_view _fragment;        //!< chunk currently parsed
+    size_t _fragmentOffset = 0;        //!< offset of _fragment within all bytes received
+    std::string _headCopy;             //!< head split across fragments, gathered so far
+    size_t _headCopyOffset = SIZE_MAX; //!< offset of the message _headCopy belongs to
+
+    std::vector<Line> _lines;
+    std::string_view _head;
+    bool _headParsed = false;
+    std::vector<iovec> _segments;
+};
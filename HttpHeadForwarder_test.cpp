@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "HttpHeadForwarder.h"
+
+namespace
+{
+
+std::string concatenate(std::span<iovec const> segments)
+{
+    std::string result;
+    for (auto const& segment: segments)
+        result.append(static_cast<char const*>(segment.iov_base), segment.iov_len);
+    return result;
+}
+
+struct HeaderCollector: public HttpListener
+{
+    std::vector<std::string> headers;
+    std::string body;
+    std::string client; //!< source address of the PROXY protocol header, if any
+    int messages = 0;
+
+    void onProxyHeader(HttpProxyHeader const& header) override { client = header.sourceAddress; }
+    void onMessageHeader(std::string_view name, std::string_view value) override
+    {
+        headers.push_back(std::string(name) + ": " + std::string(value));
+    }
+    void onMessageContent(std::string_view chunk) override { body += chunk; }
+    void onMessageEnd() override { ++messages; }
+};
+
+} // namespace
+
+TEST_CASE("HttpHeadForwarder.unchanged")
+{
+    HttpHeadForwarder forwarder;
+    auto const request = std::string_view("GET /index.html HTTP/1.1\r\n"
+                                          "Host: example.com\r\n"
+                                          "Accept: */*\r\n"
+                                          "\r\n");
+    REQUIRE(request.size() == forwarder.parseFragment(request));
+    REQUIRE(forwarder.hasHead());
+
+    // one segment, pointing into the received bytes
+    auto const segments = forwarder.forwardedHead();
+    REQUIRE(1 == segments.size());
+    REQUIRE(request.data() == segments[0].iov_base);
+    REQUIRE(request.size() == segments[0].iov_len);
+}
+
+TEST_CASE("HttpHeadForwarder.rules")
+{
+    HeaderCollector collector;
+    HttpHeadForwarder forwarder(HttpParseMode::REQUEST, &collector);
+    forwarder.addHeader("X-Forwarded-For", "192.0.2.1");
+    forwarder.setHeader("Host", "backend.internal");
+    forwarder.removeHeader("Cookie");
+
+    auto const request = std::string("POST /upload HTTP/1.1\r\n"
+                                     "X-Trace: 1\r\n"
+                                     "Host: example.com\r\n"
+                                     "Connection: keep-alive, X-Trace\r\n"
+                                     "X-Forwarded-For: 198.51.100.7\r\n"
+                                     "Cookie: a=b\r\n"
+                                     "Keep-Alive: timeout=5\r\n"
+                                     "Transfer-Encoding: chunked\r\n"
+                                     "Folded: a\r\n b\r\n"
+                                     "\r\n"
+                                     "5\r\nhello\r\n0\r\n\r\n");
+    REQUIRE(request.size() == forwarder.parseFragment(request));
+    REQUIRE(1 == collector.messages);
+    REQUIRE("hello" == collector.body);
+    REQUIRE(7 == collector.headers.size()); // Transfer-Encoding: chunked is not reported
+
+    REQUIRE("POST /upload HTTP/1.1\r\n"
+            "X-Forwarded-For: 198.51.100.7\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "Folded: a\r\n b\r\n"
+            "X-Forwarded-For: 192.0.2.1\r\n"
+            "Host: backend.internal\r\n"
+            "\r\n"
+            == concatenate(forwarder.forwardedHead()));
+    REQUIRE(request.substr(0, request.find("\r\n\r\n") + 4) == forwarder.head());
+
+    forwarder.clearRules();
+    forwarder.parseFragment("GET / HTTP/1.1\r\nHost: example.com\r\nTE: trailers\r\n\r\n");
+    REQUIRE("GET / HTTP/1.1\r\nHost: example.com\r\n\r\n" == concatenate(forwarder.forwardedHead()));
+}
+
+TEST_CASE("HttpHeadForwarder.fragmented")
+{
+    auto const request = std::string_view("GET /a HTTP/1.1\r\n"
+                                          "Host: example.com\r\n"
+                                          "Proxy-Authorization: Basic eA==\r\n"
+                                          "Accept: */*\r\n"
+                                          "\r\n"
+                                          "GET /b HTTP/1.1\r\n"
+                                          "Host: example.com\r\n"
+                                          "\r\n");
+    auto const expected = std::string("GET /a HTTP/1.1\r\n"
+                                      "Host: example.com\r\n"
+                                      "Accept: */*\r\n"
+                                      "X-Forwarded-Proto: https\r\n"
+                                      "\r\n");
+
+    for (size_t const fragmentSize: { 1, 3, 16, 1000 })
+    {
+        HttpHeadForwarder forwarder;
+        forwarder.addHeader("X-Forwarded-Proto", "https");
+
+        std::vector<std::string> heads;
+        for (size_t offset = 0; offset < request.size();)
+        {
+            // every fragment is gone once it has been parsed
+            auto const fragment = std::string(request.substr(offset, fragmentSize));
+            auto const n = forwarder.parseFragment(fragment);
+            REQUIRE(n > 0);
+            offset += n;
+            if (forwarder.hasHead() && forwarder.parser().state() == HttpParserState::MESSAGE_BEGIN)
+                heads.push_back(concatenate(forwarder.forwardedHead()));
+        }
+
+        REQUIRE(2 == heads.size());
+        REQUIRE(expected == heads[0]);
+        REQUIRE("GET /b HTTP/1.1\r\nHost: example.com\r\nX-Forwarded-Proto: https\r\n\r\n" == heads[1]);
+    }
+}
+
+TEST_CASE("HttpHeadForwarder.responses")
+{
+    HttpHeadForwarder forwarder(HttpParseMode::RESPONSE);
+    forwarder.parseFragment("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nok");
+    REQUIRE(!forwarder.parser().shouldKeepAlive());
+    REQUIRE("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n" == concatenate(forwarder.forwardedHead()));
+}
+
+TEST_CASE("HttpHeadForwarder.proxyHeader")
+{
+    HeaderCollector collector;
+    HttpHeadForwarder forwarder(HttpParseMode::REQUEST, &collector);
+    forwarder.expectProxyHeader();
+
+    auto const head = std::string_view("GET / HTTP/1.1\r\n"
+                                       "Host: example.com\r\n"
+                                       "\r\n");
+    auto const input = "PROXY TCP4 192.0.2.1 198.51.100.2 56324 443\r\n" + std::string(head);
+
+    REQUIRE(input.size() == forwarder.parseFragment(input));
+    REQUIRE(HttpParserState::PROTOCOL_ERROR != forwarder.parser().state());
+    REQUIRE(forwarder.hasHead());
+    REQUIRE("192.0.2.1" == collector.client);
+    REQUIRE(head == concatenate(forwarder.forwardedHead()));
+}
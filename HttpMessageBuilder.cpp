@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpMessageBuilder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "HttpAscii.h"
+
+namespace
+{
+
+std::byte* alignUp(std::byte* pointer, size_t alignment) noexcept
+{
+    auto const value = reinterpret_cast<uintptr_t>(pointer);
+    return pointer + ((alignment - value % alignment) % alignment);
+}
+
+} // namespace
+
+// {{{ HttpArena
+HttpArena::HttpArena() noexcept: _cursor(_inline), _end(_inline + InlineSize)
+{
+}
+
+bool HttpArena::fits(size_t size, size_t alignment) const noexcept
+{
+    auto const* aligned = alignUp(_cursor, alignment);
+    return aligned <= _end && static_cast<size_t>(_end - aligned) >= size;
+}
+
+void* HttpArena::allocate(size_t size, size_t alignment)
+{
+    while (!fits(size, alignment))
+    {
+        if (_nextBlock < _blocks.size())
+        {
+            // continue with a block kept from before the last reset()
+            auto& block = _blocks[_nextBlock++];
+            _cursor = block.data.get();
+            _end = _cursor + block.size;
+            continue;
+        }
+
+        auto const previousSize = _blocks.empty() ? InlineSize : _blocks.back().size;
+        auto const blockSize = std::max(2 * previousSize, size + alignment);
+        _blocks.push_back(Block { std::unique_ptr<std::byte[]>(new std::byte[blockSize]), blockSize });
+        _nextBlock = _blocks.size();
+        _cursor = _blocks.back().data.get();
+        _end = _cursor + blockSize;
+    }
+
+    auto* const result = alignUp(_cursor, alignment);
+    _cursor = result + size;
+    return result;
+}
+
+std::string_view HttpArena::copy(std::string_view bytes)
+{
+    if (bytes.empty())
+        return {};
+
+    auto* const target = static_cast<char*>(allocate(bytes.size(), 1));
+    std::memcpy(target, bytes.data(), bytes.size());
+    return std::string_view(target, bytes.size());
+}
+
+void HttpArena::reset() noexcept
+{
+    _cursor = _inline;
+    _end = _inline + InlineSize;
+    _nextBlock = 0;
+}
+
+void HttpArena::release() noexcept
+{
+    _blocks.clear();
+    reset();
+}
+
+size_t HttpArena::capacity() const noexcept
+{
+    size_t total = InlineSize;
+    for (auto const& block: _blocks)
+        total += block.size;
+    return total;
+}
+// }}}
+
+std::string_view HttpMessage::header(std::string_view name) const noexcept
+{
+    for (auto const& header: headers)
+        if (iequals(header.name, name))
+            return header.value;
+
+    return {};
+}
+
+// {{{ HttpMessageBuilder
+HttpMessageBuilder::HttpMessageBuilder(Handler handler, std::function<void()> error):
+    _handler(std::move(handler)), _error(std::move(error))
+{
+}
+
+void HttpMessageBuilder::clear() noexcept
+{
+    _arena.reset();
+    _message = {};
+    _headers = nullptr;
+    _headerCapacity = 0;
+    _body = nullptr;
+    _bodyCapacity = 0;
+}
+
+void HttpMessageBuilder::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version)
+{
+    clear();
+    _message.method = _arena.copy(method);
+    _message.entity = _arena.copy(entity);
+    _message.version = version;
+}
+
+void HttpMessageBuilder::onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text)
+{
+    clear();
+    _message.version = version;
+    _message.status = code;
+    _message.reason = _arena.copy(text);
+}
+
+void HttpMessageBuilder::onMessageBegin()
+{
+    clear();
+}
+
+void HttpMessageBuilder::onMessageHeader(std::string_view name, std::string_view value)
+{
+    auto const count = _message.headers.count;
+    if (count == _headerCapacity)
+    {
+        auto const capacity = _headerCapacity ? 2 * _headerCapacity : InitialHeaderCapacity;
+        auto* const headers = _arena.allocate<HttpMessage::Header>(capacity);
+        std::uninitialized_copy_n(_headers, count, headers);
+        _headers = headers;
+        _headerCapacity = capacity;
+    }
+
+    new (_headers + count) HttpMessage::Header { _arena.copy(name), _arena.copy(value) };
+    _message.headers = HttpMessage::HeaderList { _headers, count + 1 };
+
+    if (iequals(name, "Content-Length") && !_body)
+    {
+        size_t contentLength = 0;
+        for (char const c: value)
+            if (std::isdigit(static_cast<unsigned char>(c)))
+                contentLength = std::min(contentLength * 10 + static_cast<size_t>(c - '0'), MaxBodyReservation);
+
+        if (contentLength)
+        {
+            _body = _arena.allocate<char>(contentLength);
+            _bodyCapacity = contentLength;
+        }
+    }
+}
+
+void HttpMessageBuilder::onMessageContent(std::string_view chunk)
+{
+    auto const size = _message.body.size();
+    if (size + chunk.size() > _bodyCapacity)
+    {
+        // the body is kept contiguous, so grow by doubling
+        auto const capacity = std::max(2 * _bodyCapacity, size + chunk.size());
+        auto* const body = _arena.allocate<char>(capacity);
+        if (size)
+            std::memcpy(body, _body, size);
+        _body = body;
+        _bodyCapacity = capacity;
+    }
+
+    if (!chunk.empty())
+        std::memcpy(_body + size, chunk.data(), chunk.size());
+    _message.body = std::string_view(_body, size + chunk.size());
+}
+
+void HttpMessageBuilder::onMessageEnd()
+{
+    if (_handler)
+        _handler(_message);
+}
+
+void HttpMessageBuilder::onProtocolError()
+{
+    clear();
+
+    if (_error)
+        _error();
+}
+// }}}
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "HttpMessageParser.h"
+
+/// Monotonic allocator with a few KB of inline storage, growing by heap blocks.
+///
+/// Memory is released all at once by reset(), which keeps the blocks for reuse, so that once warmed up
+/// a sequence of similarly sized messages costs no heap allocations.
+class HttpArena
+{
+  public:
+    static constexpr size_t InlineSize = 4096;
+
+    HttpArena() noexcept;
+    HttpArena(HttpArena const&) = delete;
+    HttpArena& operator=(HttpArena const&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /// Copies @p bytes into the arena.
+    std::string_view copy(std::string_view bytes);
+
+    /// Rewinds the arena, invalidating everything allocated from it, while keeping its blocks.
+    void reset() noexcept;
+
+    /// Frees all heap blocks.
+    void release() noexcept;
+
+    /// Total number of bytes the arena holds, including its inline storage.
+    size_t capacity() const noexcept;
+
+  private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    bool fits(size_t size, size_t alignment) const noexcept;
+
+    alignas(std::max_align_t) std::byte _inline[InlineSize];
+    std::vector<Block> _blocks;
+    size_t _nextBlock = 0; //!< index of the next block to continue with once the current one is used up
+    std::byte* _cursor;
+    std::byte* _end;
+};
+
+/// A fully materialized HTTP message, with all of its bytes living in an HttpArena.
+struct HttpMessage
+{
+    struct Header
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    struct HeaderList
+    {
+        Header const* first = nullptr;
+        size_t count = 0;
+
+        Header const* begin() const noexcept { return first; }
+        Header const* end() const noexcept { return first + count; }
+        size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+        Header const& operator[](size_t index) const noexcept { return first[index]; }
+    };
+
+    // request-line
+    std::string_view method;
+    std::string_view entity;
+
+    // status-line
+    HttpStatus status = HttpStatus::Undefined;
+    std::string_view reason;
+
+    HttpVersion version = HttpVersion::UNKNOWN;
+    HeaderList headers;
+    std::string_view body;
+
+    /// @return the value of the first header named @p name (case insensitive), or an empty view.
+    std::string_view header(std::string_view name) const noexcept;
+};
+
+/// HttpListener retaining every message it sees as an HttpMessage.
+///
+/// All tokens are copied into a per-message arena, rewound whenever the next message begins, so a
+/// message stays valid until then. Headers are kept in a flat array within the same arena, and the body
+/// is reserved according to its Content-Length upfront.
+class HttpMessageBuilder: public HttpListener
+{
+  public:
+    using Handler = std::function<void(HttpMessage const&)>;
+
+    /// @param handler invoked with every fully parsed message
+    /// @param error   invoked on protocol errors
+    explicit HttpMessageBuilder(Handler handler, std::function<void()> error = {});
+
+    /// The most recent message, possibly still in progress.
+    HttpMessage const& message() const noexcept { return _message; }
+
+    HttpArena& arena() noexcept { return _arena; }
+
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override;
+    void onMessageBegin() override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+  private:
+    void clear() noexcept;
+
+    static constexpr size_t InitialHeaderCapacity = 16;
+    static constexpr size_t MaxBodyReservation = 1024 * 1024;
+
+    Handler _handler;
+    std::function<void()> _error;
+    HttpArena _arena;
+    HttpMessage _message;
+    HttpMessage::Header* _headers = nullptr;
+    size_t _headerCapacity = 0;
+    char* _body = nullptr;
+    size_t _bodyCapacity = 0;
+};
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "HttpMessageBuilder.h"
+
+TEST_CASE("HttpArena.growsAndRecycles")
+{
+    HttpArena arena;
+
+    auto const* const small = arena.allocate<int>(4);
+    REQUIRE(reinterpret_cast<uintptr_t>(small) % alignof(int) == 0);
+    REQUIRE(HttpArena::InlineSize == arena.capacity());
+
+    std::string const big(3 * HttpArena::InlineSize, 'x');
+    REQUIRE(big == arena.copy(big));
+    auto const capacity = arena.capacity();
+    REQUIRE(capacity > HttpArena::InlineSize);
+
+    // once warmed up, the same allocation pattern needs no further blocks
+    arena.reset();
+    arena.allocate<int>(4);
+    REQUIRE(big == arena.copy(big));
+    REQUIRE(capacity == arena.capacity());
+
+    arena.release();
+    REQUIRE(HttpArena::InlineSize == arena.capacity());
+}
+
+TEST_CASE("HttpMessageBuilder.request")
+{
+    std::vector<std::string> seen;
+    HttpMessageBuilder builder([&](HttpMessage const& message) {
+        seen.emplace_back(std::string(message.method) + " " + std::string(message.entity) + " "
+                          + std::string(message.header("host")) + " " + std::string(message.body));
+    });
+    HttpParser parser(HttpParseMode::REQUEST, &builder);
+
+    std::string input = "POST /upload HTTP/1.1\r\n"
+                        "Host: example.com\r\n"
+                        "Content-Length: 11\r\n"
+                        "\r\n"
+                        "hello world";
+    parser.parseFragment(input);
+
+    // all strings outlive the input
+    input.assign(input.size(), '#');
+
+    auto const& message = builder.message();
+    REQUIRE("POST" == message.method);
+    REQUIRE("/upload" == message.entity);
+    REQUIRE(HttpVersion::VERSION_1_1 == message.version);
+    REQUIRE(2 == message.headers.size());
+    REQUIRE("Host" == message.headers[0].name);
+    REQUIRE("example.com" == message.headers[0].value);
+    REQUIRE("11" == message.header("content-length"));
+    REQUIRE("hello world" == message.body);
+    REQUIRE(1 == seen.size());
+    REQUIRE("POST /upload example.com hello world" == seen[0]);
+}
+
+TEST_CASE("HttpMessageBuilder.responseWithManyHeadersAndChunkedBody")
+{
+    size_t messages = 0;
+    HttpMessageBuilder builder([&](HttpMessage const&) { ++messages; });
+    HttpParser parser(HttpParseMode::RESPONSE, &builder);
+
+    std::string input = "HTTP/1.1 200 OK\r\n";
+    for (int i = 0; i < 40; ++i)
+        input += "X-Header-" + std::to_string(i) + ": value " + std::to_string(i) + "\r\n";
+    input += "Transfer-Encoding: chunked\r\n"
+             "\r\n"
+             "5\r\nhello\r\n"
+             "6\r\n world\r\n"
+             "0\r\n\r\n";
+
+    // each fragment is gone right after parsing it
+    for (size_t offset = 0; offset < input.size();)
+        offset += parser.parseFragment(std::string(input.substr(offset, 13)));
+
+    auto const& message = builder.message();
+    REQUIRE(1 == messages);
+    REQUIRE(HttpStatus::Ok == message.status);
+    REQUIRE("OK" == message.reason);
+    REQUIRE(40 == message.headers.size());
+    REQUIRE("X-Header-0" == message.headers[0].name);
+    REQUIRE("value 39" == message.header("x-header-39"));
+    REQUIRE("hello world" == message.body);
+}
+
+TEST_CASE("HttpMessageBuilder.keepAliveRecyclesArena")
+{
+    HttpMessageBuilder builder([](HttpMessage const&) {});
+    HttpParser parser(HttpParseMode::REQUEST, &builder);
+
+    std::string const request = "GET /index.html HTTP/1.1\r\n"
+                                "Host: localhost\r\n"
+                                "User-Agent: " + std::string(5000, 'u') + "\r\n"
+                                "\r\n";
+
+    parser.parseFragment(request);
+    auto const capacity = builder.arena().capacity();
+
+    for (int i = 0; i < 100; ++i)
+        parser.parseFragment(request);
+
+    REQUIRE(capacity == builder.arena().capacity());
+    REQUIRE("localhost" == builder.message().header("Host"));
+}
@@ -1,8 +1,22 @@
 // SPDX-License-Identifier: Apache-2.0
 #include "HttpMessageParser.h"
 
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cctype>
+#include <cstring>
+#include <functional>
+
+#include "HttpAscii.h"
+
+#if defined(HTTP_MESSAGE_PARSER_STATS) && (defined(__x86_64__) || defined(__i386__))
+    #include <x86intrin.h>
+#elif defined(HTTP_MESSAGE_PARSER_STATS)
+    #include <chrono>
+#endif
 
 namespace // helper
 {
@@ -12,20 +26,109 @@ char constexpr LF = 0x0A;
 char constexpr SP = 0x20;
 char constexpr HT = 0x09;
 
-constexpr bool iequals(std::string_view a, std::string_view b) noexcept
+/// PROXY protocol v1 headers are at most 107 bytes long, including CR LF.
+constexpr size_t MaxProxyHeaderV1Size = 107;
+
+/// PROXY protocol v2 signature, followed by version/command, family, and a 16-bit length of the rest.
+constexpr std::string_view ProxyHeaderV2Signature("\r\n\r\n\0\r\nQUIT\n", 12);
+constexpr size_t ProxyHeaderV2Size = 16;
+
+constexpr uint16_t readUInt16(std::string_view bytes, size_t offset) noexcept
 {
-    if (a.size() != b.size())
-        return false;
+    return static_cast<uint16_t>(static_cast<uint8_t>(bytes[offset]) << 8
+                                 | static_cast<uint8_t>(bytes[offset + 1]));
+}
+
+/// Jobs ahead of the current one whose parser is prefetched by HttpParser::parseFragments(). Their
+/// listeners and chunks are prefetched one job later, once the parser's line has arrived.
+constexpr size_t PrefetchDistance = 2;
 
-    for (size_t i = 0; i < a.size(); ++i)
+inline void prefetchLine(void const* address) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void) address;
+#endif
+}
+
+// {{{ hashing
+constexpr uint64_t HashSecret0 = 0xa0761d6478bd642full;
+constexpr uint64_t HashSecret1 = 0xe7037ed1a0b428dbull;
+constexpr uint64_t HashSecret2 = 0x8ebc6af09c88c6e3ull;
+
+/// 64x64 -> 128 bit multiplication, folded (the core of wyhash).
+inline uint64_t hashMix(uint64_t a, uint64_t b) noexcept
+{
+#if defined(__SIZEOF_INT128__)
+    auto const product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+    auto const product = a * (b | 1);
+    return product ^ (product >> 29) ^ (a >> 32) * b;
+#endif
+}
+
+/// Hashes @p bytes 8 at a time, optionally folding ASCII case by setting bit 5 of every byte (which
+/// is exact for header names made of letters, digits and "-").
+inline uint64_t hashBytes(std::string_view bytes, uint64_t seed, bool foldCase = false) noexcept
+{
+    constexpr uint64_t fold = 0x2020202020202020ull;
+    auto hash = seed ^ HashSecret0 ^ bytes.size();
+
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8)
     {
-        if (std::tolower(a[i]) != std::tolower(b[i]))
-            return false;
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, 8);
+        if (foldCase)
+            word |= fold;
+        hash = hashMix(hash ^ HashSecret1, word ^ HashSecret2);
     }
 
-    return true;
+    if (auto const tail = bytes.size() - i; tail != 0)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes.data() + i, tail);
+        if (foldCase)
+            word |= fold >> (64 - 8 * tail);
+        hash = hashMix(hash ^ HashSecret1, word ^ HashSecret2);
+    }
+
+    return hashMix(hash, HashSecret0 ^ bytes.size());
+}
+// }}}
+
+/// Invokes @p fn with every item of the comma separated @p list (e.g. a Connection header value),
+/// stripped of surrounding whitespace. Empty items are skipped.
+template <typename Fn>
+constexpr void forEachToken(std::string_view list, Fn&& fn)
+{
+    while (!list.empty())
+    {
+        auto const comma = list.find(',');
+        auto item = list.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+            item.remove_prefix(1);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+            item.remove_suffix(1);
+
+        if (!item.empty())
+            fn(item);
+
+        if (comma == std::string_view::npos)
+            break;
+        list.remove_prefix(comma + 1);
+    }
 }
 
+/// Headers that apply to a single connection only, whether or not the Connection header lists them
+/// (RFC 9110, section 7.6.1, plus the Proxy-* headers and the Keep-Alive of HTTP/1.0).
+constexpr std::array<std::string_view, 9> StandardHopByHopHeaders = {
+    "connection", "keep-alive", "proxy-authenticate", "proxy-authorization", "proxy-connection",
+    "te",         "trailer",    "transfer-encoding",  "upgrade",
+};
+
 constexpr ssize_t parseInt(std::string_view value) noexcept
 {
     ssize_t result = 0;
@@ -116,6 +219,13 @@ std::string_view as_string(HttpParserState state) noexcept
         // artificial
         case HttpParserState::PROTOCOL_ERROR: return "protocol-error";
         case HttpParserState::MESSAGE_BEGIN: return "message-begin";
+        case HttpParserState::UPGRADED: return "upgraded";
+        case HttpParserState::EXPECT_CONTINUE: return "expect-continue";
+
+        // PROXY protocol header
+        case HttpParserState::PROXY_HEADER_BEGIN: return "proxy-header-begin";
+        case HttpParserState::PROXY_HEADER_V1: return "proxy-header-v1";
+        case HttpParserState::PROXY_HEADER_V2: return "proxy-header-v2";
 
         // request-line
         case HttpParserState::REQUEST_LINE_BEGIN: return "request-line-begin";
@@ -179,8 +289,124 @@ std::string_view as_string(HttpParserState state) noexcept
     return "UNKNOWN";
 }
 
+std::string_view as_string(HttpParserStateGroup group) noexcept
+{
+    switch (group)
+    {
+        case HttpParserStateGroup::MESSAGE: return "message";
+        case HttpParserStateGroup::REQUEST_LINE: return "request-line";
+        case HttpParserStateGroup::STATUS_LINE: return "status-line";
+        case HttpParserStateGroup::HEADER: return "header";
+        case HttpParserStateGroup::LWS: return "lws";
+        case HttpParserStateGroup::CONTENT: return "content";
+        case HttpParserStateGroup::CONTENT_FRAMING: return "content-framing";
+    }
+
+    return "UNKNOWN";
+}
+
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+uint64_t cycleCounter() noexcept
+{
+    #if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+    #else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    #endif
+}
+#endif
+
 } // namespace
 
+std::string_view HttpProxyHeader::tlv(uint8_t type) const noexcept
+{
+    auto rest = tlvs;
+    while (rest.size() >= 3)
+    {
+        auto const length = readUInt16(rest, 1);
+        if (rest.size() - 3 < length)
+            break;
+        if (static_cast<uint8_t>(rest[0]) == type)
+            return rest.substr(3, length);
+        rest.remove_prefix(3 + length);
+    }
+    return {};
+}
+
+HttpParserStats& HttpParserStats::operator+=(HttpParserStats const& other) noexcept
+{
+    for (size_t k = 0; k < HttpParserStateGroupCount; ++k)
+    {
+        bytes[k] += other.bytes[k];
+        cycles[k] += other.cycles[k];
+        errors[k] += other.errors[k];
+    }
+
+    fragments += other.fragments;
+    sampledFragments += other.sampledFragments;
+    splitTokens += other.splitTokens;
+    messages += other.messages;
+    headers += other.headers;
+
+    for (size_t k = 0; k < headersPerMessage.size(); ++k)
+        headersPerMessage[k] += other.headersPerMessage[k];
+
+    return *this;
+}
+
+std::string HttpParserStats::toPrometheus(std::string_view prefix) const
+{
+    std::string out;
+
+    auto const header = [&](std::string_view name, std::string_view type, std::string_view help) {
+        out.append("# HELP ").append(prefix).append(name).append(" ").append(help).append("\n");
+        out.append("# TYPE ").append(prefix).append(name).append(" ").append(type).append("\n");
+    };
+
+    auto const sample = [&](std::string_view name, std::string_view labels, uint64_t value) {
+        out.append(prefix).append(name);
+        if (!labels.empty())
+            out.append("{").append(labels).append("}");
+        out.append(" ").append(std::to_string(value)).append("\n");
+    };
+
+    auto const groupCounter =
+        [&](std::string_view name, std::string_view help, GroupCounters const& counters) {
+            header(name, "counter", help);
+            for (size_t k = 0; k < HttpParserStateGroupCount; ++k)
+            {
+                auto const label = "group=\"" + std::string(as_string(static_cast<HttpParserStateGroup>(k))) + '"';
+                sample(name, label, counters[k]);
+            }
+        };
+
+    auto const counter = [&](std::string_view name, std::string_view help, uint64_t value) {
+        header(name, "counter", help);
+        sample(name, {}, value);
+    };
+
+    groupCounter("_bytes_total", "Bytes consumed, by parser state group.", bytes);
+    groupCounter("_cycles_total", "CPU cycles spent in sampled fragments, by parser state group.", cycles);
+    groupCounter("_errors_total", "Protocol errors, by the parser state group detecting them.", errors);
+    counter("_fragments_total", "Fragments parsed.", fragments);
+    counter("_sampled_fragments_total", "Fragments parsed with cycle sampling.", sampledFragments);
+    counter("_split_tokens_total", "Tokens straddling two fragments.", splitTokens);
+
+    header("_headers_per_message", "histogram", "Headers per message.");
+    uint64_t cumulative = 0;
+    for (size_t k = 0; k < headersPerMessage.size(); ++k)
+    {
+        cumulative += headersPerMessage[k];
+        auto const bound =
+            k < HeadersPerMessageBounds.size() ? std::to_string(HeadersPerMessageBounds[k]) : std::string("+Inf");
+        sample("_headers_per_message_bucket", "le=\"" + bound + '"', cumulative);
+    }
+    sample("_headers_per_message_sum", {}, headers);
+    sample("_headers_per_message_count", {}, messages);
+
+    return out;
+}
+
 bool HttpParser::isProcessingHeader() const noexcept
 {
     // XXX should we include request-line and status-line here, too?
@@ -198,6 +424,19 @@ bool HttpParser::isProcessingHeader() const noexcept
     }
 }
 
+bool HttpParser::expectsContinue() const noexcept
+{
+    // clients of HTTP/1.0 do not know about 100 (Continue)
+    return _expectContinue && _mode == HttpParseMode::REQUEST && (_versionMajor > 1 || _versionMinor >= 1)
+           && isContentExpected();
+}
+
+void HttpParser::continueMessage() noexcept
+{
+    if (_state == HttpParserState::EXPECT_CONTINUE)
+        _state = HttpParserState::CONTENT_BEGIN;
+}
+
 bool HttpParser::isProcessingBody() const noexcept
 {
     switch (_state)
@@ -216,11 +455,221 @@ bool HttpParser::isProcessingBody() const noexcept
     }
 }
 
+// {{{ HttpHeaderValue
+HttpHeaderValue::HttpHeaderValue(std::string_view raw) noexcept:
+    _raw(raw), _folded(raw.find(CR) != std::string_view::npos)
+{
+}
+
+std::string_view HttpHeaderValue::normalized(std::string& scratch) const
+{
+    if (!_folded)
+        return _raw;
+
+    scratch.clear();
+    for (size_t i = 0; i < _raw.size();)
+    {
+        if (_raw[i] != CR || i + 1 == _raw.size() || _raw[i + 1] != LF)
+        {
+            scratch += _raw[i++];
+            continue;
+        }
+
+        while (!scratch.empty() && (scratch.back() == SP || scratch.back() == HT))
+            scratch.pop_back();
+        // an obs-fold, with the whitespace around it
+        i += 2;
+        while (i < _raw.size() && (_raw[i] == SP || _raw[i] == HT))
+            ++i;
+        scratch += SP;
+    }
+    return scratch;
+}
+// }}}
+
+// {{{ HttpHeaderIndex
+void HttpHeaderIndex::clear() noexcept
+{
+    _slots.fill(0);
+    _size = 0;
+    _retained = 0;
+    _overflowed = false;
+    _arenaUsed = 0;
+}
+
+/// Copies @p token into the arena, making it point there.
+bool HttpHeaderIndex::copy(std::string_view& token) noexcept
+{
+    if (token.size() > ArenaSize - _arenaUsed)
+        return false;
+
+    auto* const target = _arena.data() + _arenaUsed;
+    std::memcpy(target, token.data(), token.size());
+    _arenaUsed += token.size();
+    token = std::string_view(target, token.size());
+    return true;
+}
+
+void HttpHeaderIndex::add(uint64_t hash, std::string_view name, std::string_view value, bool copy) noexcept
+{
+    if (_size == MaxFields || (copy && (!this->copy(name) || !this->copy(value))))
+    {
+        _overflowed = true;
+        return;
+    }
+
+    auto const index = static_cast<uint8_t>(++_size);
+    _fields[index - 1] = { hash, name, value, 0, index };
+
+    for (auto slot = hash & (SlotCount - 1);; slot = (slot + 1) & (SlotCount - 1))
+    {
+        if (_slots[slot] == 0)
+        {
+            _slots[slot] = index;
+            return;
+        }
+
+        auto& first = _fields[_slots[slot] - 1];
+        if (first.hash == hash && iequals(first.name, name))
+        {
+            _fields[first.last - 1].next = index;
+            first.last = index;
+            return;
+        }
+    }
+}
+
+/// Copies the fields received in the fragment being parsed into the arena, as the head goes on in the next.
+void HttpHeaderIndex::retain() noexcept
+{
+    auto const inArena = [this](std::string_view token) {
+        return token.empty()
+               || (std::less_equal<char const*>()(_arena.data(), token.data())
+                   && std::less<char const*>()(token.data(), _arena.data() + _arenaUsed));
+    };
+
+    for (; _retained < _size; ++_retained)
+    {
+        auto& field = _fields[_retained];
+        if ((!inArena(field.name) && !copy(field.name)) || (!inArena(field.value) && !copy(field.value)))
+        {
+            // an incomplete index is better than one referring to bytes gone
+            _overflowed = true;
+            field.name = {};
+            field.value = {};
+        }
+    }
+}
+
+uint8_t HttpHeaderIndex::lookup(std::string_view name) const noexcept
+{
+    auto const hash = hashBytes(name, 0, true);
+    for (auto slot = hash & (SlotCount - 1);; slot = (slot + 1) & (SlotCount - 1))
+    {
+        auto const index = _slots[slot];
+        if (index == 0)
+            return 0;
+
+        auto const& field = _fields[index - 1];
+        if (field.hash == hash && iequals(field.name, name))
+            return index;
+    }
+}
+
+std::string_view HttpHeaderIndex::find(std::string_view name) const noexcept
+{
+    auto const index = lookup(name);
+    return index ? _fields[index - 1].value : std::string_view();
+}
+
+size_t HttpHeaderIndex::count(std::string_view name) const noexcept
+{
+    auto const values = this->values(name);
+    return static_cast<size_t>(std::distance(values.begin(), values.end()));
+}
+// }}}
+
 HttpParser::HttpParser(HttpParseMode mode, HttpListener* listener) noexcept: _mode(mode), _listener(listener)
 {
     assert(listener != nullptr && "listener must not be null");
 }
 
+bool HttpParser::isSpilled(std::string_view token) const noexcept
+{
+    return !token.empty() && std::less_equal<char const*>()(_spill.data(), token.data())
+           && std::less<char const*>()(token.data(), _spill.data() + _spill.size());
+}
+
+/// Appends @p bytes to the spill buffer, making @p token cover them.
+///
+/// If @p token already lives in the spill buffer, it must be the last one in there and is extended,
+/// otherwise it is moved into the spill buffer first.
+void HttpParser::spill(std::string_view& token, std::string_view bytes)
+{
+    auto const tokens = std::array { &_method, &_entity, &_message, &_name, &_value, &_proxyHeader };
+
+    // appending may reallocate, so remember where the already spilled tokens are
+    std::array<ssize_t, tokens.size()> offsets {};
+    for (size_t k = 0; k < tokens.size(); ++k)
+        offsets[k] = isSpilled(*tokens[k]) ? tokens[k]->data() - _spill.data() : -1;
+
+    auto const extending = isSpilled(token);
+    auto const tokenOffset = extending ? static_cast<size_t>(token.data() - _spill.data()) : _spill.size();
+    auto const tokenSize = extending ? token.size() : 0;
+
+    _spill.append(bytes);
+
+    for (size_t k = 0; k < tokens.size(); ++k)
+        if (offsets[k] >= 0)
+            *tokens[k] = std::string_view(_spill.data() + offsets[k], tokens[k]->size());
+
+    token = std::string_view(_spill.data() + tokenOffset, tokenSize + bytes.size());
+}
+
+void HttpParser::extendToken(std::string_view& token, char const* i, size_t n)
+{
+    if (isSpilled(token))
+        spill(token, std::string_view(i, n));
+    else
+        token = std::string_view(token.data(), token.size() + n);
+}
+
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+void HttpParser::recordMessageHead() noexcept
+{
+    ++_stats.messages;
+    _stats.headers += _headerCount;
+
+    size_t bucket = 0;
+    while (bucket < HttpParserStats::HeadersPerMessageBounds.size()
+           && _headerCount > HttpParserStats::HeadersPerMessageBounds[bucket])
+        ++bucket;
+    ++_stats.headersPerMessage[bucket];
+
+    _headerCount = 0;
+}
+#endif
+
+/// Moves all tokens still in progress out of @p chunk, as the caller may reuse its memory.
+void HttpParser::retainTokens(std::string_view chunk)
+{
+    auto const inChunk = [chunk](std::string_view token) {
+        return !token.empty() && std::less_equal<char const*>()(chunk.data(), token.data())
+               && std::less<char const*>()(token.data(), chunk.data() + chunk.size());
+    };
+
+    for (auto* token: { &_method, &_entity, &_message, &_name, &_value, &_proxyHeader })
+    {
+        if (inChunk(*token))
+        {
+            spill(*token, *token);
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+            ++_stats.splitTokens;
+#endif
+        }
+    }
+}
+
 size_t HttpParser::parseFragment(std::string_view chunk) noexcept
 {
     /*
@@ -285,10 +734,37 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
     size_t result = initialOutOffset;
     size_t* nparsed = &result;
 
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+    // bytes and cycles are attributed to the group of the state consuming them
+    auto group = groupOf(_state);
+    ++_stats.fragments;
+    bool const sampled = _cycleSampling != 0 && _stats.fragments % _cycleSampling == 0;
+    uint64_t since = 0;
+    if (sampled)
+    {
+        ++_stats.sampledFragments;
+        since = cycleCounter();
+    }
+
+    // errors are attributed to the group of the state detecting them, which may be the group of
+    // PROTOCOL_ERROR itself (e.g. PROXY protocol headers)
+    bool errorCounted = _state == HttpParserState::PROTOCOL_ERROR;
+    auto const countError = [&]() {
+        if (!errorCounted && _state == HttpParserState::PROTOCOL_ERROR)
+        {
+            ++_stats.errors[static_cast<size_t>(group)];
+            errorCounted = true;
+        }
+    };
+#endif
+
     auto const nextChar = [&](size_t n = 1) {
         i += n;
         *nparsed += n;
         _bytesReceived += n;
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+        _stats.bytes[static_cast<size_t>(group)] += n;
+#endif
     };
 
 #if 0
@@ -312,10 +788,41 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
 
     while (i != e)
     {
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+        countError();
+        if (auto const current = groupOf(_state); current != group)
+        {
+            if (sampled)
+            {
+                auto const now = cycleCounter();
+                _stats.cycles[static_cast<size_t>(group)] += now - since;
+                since = now;
+            }
+
+            group = current;
+        }
+#endif
         switch (_state)
         {
             case HttpParserState::MESSAGE_BEGIN:
+                if (_proxyHeaderExpected)
+                {
+                    _state = HttpParserState::PROXY_HEADER_BEGIN;
+                    break;
+                }
+                _messageOffset = _bytesReceived;
                 _contentLength = -1;
+                _chunked = false;
+                if (_digestEnabled)
+                    beginDigest();
+                if (_headerIndex)
+                    _headerIndex->clear();
+                _upgradeRequested = false;
+                _connectionUpgrade = false;
+                _connectionClose = false;
+                _connectionKeepAlive = false;
+                _connectionOptions.clear();
+                _expectContinue = false;
                 switch (_mode)
                 {
                     case HttpParseMode::REQUEST:
@@ -339,6 +846,49 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                         break;
                 }
                 break;
+            case HttpParserState::PROXY_HEADER_BEGIN:
+                if (*i == 'P' || *i == CR)
+                {
+                    _state = *i == 'P' ? HttpParserState::PROXY_HEADER_V1 : HttpParserState::PROXY_HEADER_V2;
+                    _proxyHeader = chunk.substr(*nparsed - initialOutOffset, 1);
+                    nextChar();
+                }
+                else
+                {
+                    _listener->onProtocolError();
+                    _state = HttpParserState::PROTOCOL_ERROR;
+                }
+                break;
+            case HttpParserState::PROXY_HEADER_V1:
+                extendToken(_proxyHeader, i);
+                nextChar();
+                if (_proxyHeader.back() == LF ? !parseProxyHeader()
+                                              : _proxyHeader.size() >= MaxProxyHeaderV1Size)
+                {
+                    _listener->onProtocolError();
+                    _state = HttpParserState::PROTOCOL_ERROR;
+                }
+                break;
+            case HttpParserState::PROXY_HEADER_V2: {
+                // fixed-size part first, then whatever its length field announces, taken in bulk
+                auto const expected = _proxyHeader.size() < ProxyHeaderV2Size
+                                          ? ProxyHeaderV2Size
+                                          : ProxyHeaderV2Size + readUInt16(_proxyHeader, 14);
+                auto const n = std::min(expected - _proxyHeader.size(), static_cast<size_t>(e - i));
+                extendToken(_proxyHeader, i, n);
+                nextChar(n);
+
+                auto const signatureSize = std::min(_proxyHeader.size(), ProxyHeaderV2Signature.size());
+                bool const complete = _proxyHeader.size() >= ProxyHeaderV2Size
+                                      && _proxyHeader.size() == ProxyHeaderV2Size + readUInt16(_proxyHeader, 14);
+                if (_proxyHeader.substr(0, signatureSize) != ProxyHeaderV2Signature.substr(0, signatureSize)
+                    || (complete && !parseProxyHeader()))
+                {
+                    _listener->onProtocolError();
+                    _state = HttpParserState::PROTOCOL_ERROR;
+                }
+                break;
+            }
             case HttpParserState::REQUEST_LINE_BEGIN:
                 if (isToken(*i))
                 {
@@ -360,7 +910,7 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                 }
                 else if (isToken(*i))
                 {
-                    _method = std::string_view(_method.data(), _method.size() + 1);
+                    extendToken(_method, i);
                     nextChar();
                 }
                 else
@@ -390,7 +940,7 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                 }
                 else if (std::isprint(*i))
                 {
-                    _entity = std::string_view(_entity.data(), _entity.size() + 1);
+                    extendToken(_entity, i);
                     nextChar();
                 }
                 else if (*i == CR)
@@ -407,9 +957,22 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
             case HttpParserState::REQUEST_0_9_LF:
                 if (*i == LF)
                 {
+                    nextChar();
+                    _state = HttpParserState::MESSAGE_BEGIN;
+                    if (_digestEnabled)
+                    {
+                        digestRequestLine(HttpVersion::VERSION_0_9);
+                        endDigest();
+                    }
                     _listener->onMessageBegin(_method, _entity, HttpVersion::VERSION_0_9);
+                    _method = {};
+                    _entity = {};
+                    _spill.clear();
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+                    recordMessageHead();
+#endif
                     _listener->onMessageHeaderEnd();
-                    _listener->onMessageEnd();
+                    endMessage();
                     goto done;
                 }
                 else
@@ -520,7 +1083,12 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                     if (httpVersion != HttpVersion::UNKNOWN)
                     {
                         _state = HttpParserState::HEADER_NAME_BEGIN;
+                        if (_digestEnabled)
+                            digestRequestLine(httpVersion);
                         _listener->onMessageBegin(_method, _entity, httpVersion);
+                        _method = {};
+                        _entity = {};
+                        _spill.clear();
                     }
                     else
                     {
@@ -676,7 +1244,7 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
             case HttpParserState::STATUS_MESSAGE:
                 if (isText(*i) && *i != CR && *i != LF)
                 {
-                    _message = std::string_view(_message.data(), _message.size() + 1);
+                    extendToken(_message, i);
                     nextChar();
                 }
                 else if (*i == CR)
@@ -700,6 +1268,8 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                     {
                         _state = HttpParserState::HEADER_NAME_BEGIN;
                         _listener->onMessageBegin(httpVersion, static_cast<HttpStatus>(_code), _message);
+                        _message = {};
+                        _spill.clear();
                     }
                     else
                     {
@@ -716,6 +1286,9 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
             case HttpParserState::HEADER_NAME_BEGIN:
                 if (isToken(*i))
                 {
+                    _headerLineOffset = _bytesReceived;
+                    _valueFolded = false;
+                    _valueTrailingWs = 0;
                     _name = chunk.substr(*nparsed - initialOutOffset, 1);
                     _state = HttpParserState::HEADER_NAME;
                     nextChar();
@@ -734,7 +1307,7 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
             case HttpParserState::HEADER_NAME:
                 if (isToken(*i))
                 {
-                    _name = std::string_view(_name.data(), _name.size() + 1);
+                    extendToken(_name, i);
                     nextChar();
                 }
                 else if (*i == ':')
@@ -808,9 +1381,20 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
             case HttpParserState::LWS_SP_HT_BEGIN:
                 if (*i == SP || *i == HT)
                 {
-                    if (!_value.empty())
+                    if (isSpilled(_value))
+                    {
+                        char const fold[3] = { CR, LF, *i };
+                        spill(_value, std::string_view(fold, sizeof(fold)));
+                    }
+                    else if (!_value.empty())
                         _value = std::string_view(_value.data(), _value.size() + 3); // CR LF (SP | HT)
 
+                    if (!_value.empty())
+                    {
+                        _valueFolded = true;
+                        _valueTrailingWs += 3;
+                    }
+
                     _state = HttpParserState::LWS_SP_HT;
                     nextChar();
                 }
@@ -829,7 +1413,10 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                 if (*i == SP || *i == HT)
                 {
                     if (!_value.empty())
-                        _value = std::string_view(_value.data(), _value.size() + 1); // (SP | HT)
+                    {
+                        extendToken(_value, i); // (SP | HT)
+                        ++_valueTrailingWs;
+                    }
 
                     nextChar();
                 }
@@ -864,7 +1451,9 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                 }
                 else if (isText(*i))
                 {
-                    _value = std::string_view(_value.data(), _value.size() + 1);
+                    // trailing OWS is counted as it goes, so that it is cut off without another pass
+                    _valueTrailingWs = *i == SP || *i == HT ? _valueTrailingWs + 1 : 0;
+                    extendToken(_value, i);
                     nextChar();
                 }
                 else
@@ -886,6 +1475,18 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                 }
                 break;
             case HttpParserState::HEADER_VALUE_END: {
+                _value.remove_suffix(_valueTrailingWs);
+                _valueTrailingWs = 0;
+
+                if (_digestEnabled || _headerIndex)
+                {
+                    auto const nameHash = hashBytes(_name, 0, true);
+                    if (_digestEnabled)
+                        digestHeader(nameHash);
+                    if (_headerIndex)
+                        _headerIndex->add(nameHash, _name, _value, isSpilled(_name) || isSpilled(_value));
+                }
+
                 if (iequals(_name, "Content-Length"))
                 {
                     _contentLength = parseInt(_value);
@@ -909,11 +1510,23 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
                 }
                 else
                 {
+                    if (iequals(_name, "Upgrade"))
+                        _upgradeRequested = true;
+                    else if (iequals(_name, "Connection") || iequals(_name, "Proxy-Connection"))
+                        parseConnectionOptions(_value);
+                    else if (iequals(_name, "Expect") && iequals(_value, "100-continue"))
+                        _expectContinue = true;
+
                     _listener->onMessageHeader(_name, _value);
                 }
 
                 _name = {};
                 _value = {};
+                _valueFolded = false;
+                _spill.clear();
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+                ++_headerCount;
+#endif
 
                 // continue with the next header
                 _state = HttpParserState::HEADER_NAME_BEGIN;
@@ -923,6 +1536,9 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
             case HttpParserState::HEADER_END_LF:
                 if (*i == LF)
                 {
+                    if (_mode == HttpParseMode::RESPONSE && _code == 101)
+                        _contentLength = 0; // the connection switches protocols right after the head
+
                     if (isContentExpected())
                         _state = HttpParserState::CONTENT_BEGIN;
                     else
@@ -930,11 +1546,24 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
 
                     nextChar();
 
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+                    recordMessageHead();
+#endif
+                    if (_digestEnabled)
+                        endDigest();
+                    collectHopByHopHeaders();
                     _listener->onMessageHeaderEnd();
 
                     if (!isContentExpected())
                     {
-                        _listener->onMessageEnd();
+                        endMessage();
+                        goto done;
+                    }
+
+                    if (expectsContinue() && !_listener->onExpectContinue())
+                    {
+                        // the client sends no body before the server's go-ahead
+                        _state = HttpParserState::EXPECT_CONTINUE;
                         goto done;
                     }
                 }
@@ -974,7 +1603,7 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
 
                 if (_state == HttpParserState::MESSAGE_BEGIN)
                 {
-                    _listener->onMessageEnd();
+                    endMessage();
                     goto done;
                 }
 
@@ -1091,11 +1720,12 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
 
                     _state = HttpParserState::MESSAGE_BEGIN;
 
-                    _listener->onMessageEnd();
+                    endMessage();
                     goto done;
                 }
                 break;
             case HttpParserState::PROTOCOL_ERROR: goto done;
+            case HttpParserState::EXPECT_CONTINUE: goto done; // until continueMessage()
             default: goto done;
         }
     }
@@ -1112,17 +1742,402 @@ size_t HttpParser::parseFragment(std::string_view chunk) noexcept
             // subsequent calls to process() parse next request(s).
             _state = HttpParserState::MESSAGE_BEGIN;
 
-            _listener->onMessageEnd();
+            endMessage();
             goto done;
         }
     }
 
 done:
+    retainTokens(chunk);
+    if (_headerIndex)
+    {
+        // the head goes on in the next fragment, also when this one ends right after a line end
+        auto const stateGroup = groupOf(_state);
+        if (stateGroup == HttpParserStateGroup::HEADER || stateGroup == HttpParserStateGroup::LWS)
+            _headerIndex->retain();
+    }
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+    countError();
+    if (sampled)
+        _stats.cycles[static_cast<size_t>(group)] += cycleCounter() - since;
+#endif
     return *nparsed - initialOutOffset;
 }
 
+size_t HttpParser::parseFragment(std::span<iovec const> segments) noexcept
+{
+    size_t result = 0;
+    for (auto const& segment: segments)
+    {
+        auto const chunk = std::string_view(static_cast<char const*>(segment.iov_base), segment.iov_len);
+
+        _messageEnded = false;
+        auto const n = parseFragment(chunk);
+        result += n;
+
+        // stops where parseFragment() over the concatenation would
+        if (n < chunk.size() || _messageEnded || _state == HttpParserState::PROTOCOL_ERROR)
+            break;
+    }
+    return result;
+}
+
+/// Prefetches what parseFragment() touches first: the state and token members, and the spill buffer.
+void HttpParser::prefetch() const noexcept
+{
+    prefetchLine(this);
+    prefetchLine(&_name);
+
+    // a token carried over from the previous fragment, which is resumed first
+    if (!_spill.empty())
+        prefetchLine(_spill.data());
+}
+
+void HttpParser::parseFragments(std::span<HttpParseJob> jobs) noexcept
+{
+    for (size_t k = 0; k < std::min(PrefetchDistance, jobs.size()); ++k)
+        jobs[k].parser->prefetch();
+
+    for (size_t k = 0; k < jobs.size(); ++k)
+    {
+        if (k + PrefetchDistance < jobs.size())
+            jobs[k + PrefetchDistance].parser->prefetch();
+
+        if (k + 1 < jobs.size())
+        {
+            auto const& next = jobs[k + 1];
+            prefetchLine(next.parser->_listener);
+            if (!next.chunk.empty())
+                prefetchLine(next.chunk.data());
+        }
+
+        auto& job = jobs[k];
+        auto& parser = *job.parser;
+        job.parsed = 0;
+        while (job.parsed < job.chunk.size())
+        {
+            auto const n = parser.parseFragment(job.chunk.substr(job.parsed));
+            job.parsed += n;
+            if (n == 0 || parser._state == HttpParserState::PROTOCOL_ERROR || parser.isUpgraded())
+                break;
+        }
+    }
+}
+
+/// Parses the complete PROXY protocol header and passes it on, or returns false if it is malformed.
+bool HttpParser::parseProxyHeader()
+{
+    HttpProxyHeader header;
+    std::array<char, INET6_ADDRSTRLEN> source {};
+    std::array<char, INET6_ADDRSTRLEN> destination {};
+
+    if (_state == HttpParserState::PROXY_HEADER_V1)
+    {
+        // "PROXY" SP ( "UNKNOWN" *anything | ( "TCP4" | "TCP6" ) SP src SP dst SP sport SP dport ) CRLF
+        header.version = 1;
+        if (_proxyHeader.size() < 2 || _proxyHeader[_proxyHeader.size() - 2] != CR)
+            return false;
+
+        auto const line = _proxyHeader.substr(0, _proxyHeader.size() - 2);
+        std::array<std::string_view, 6> fields {};
+        size_t count = 0;
+        for (size_t start = 0;;)
+        {
+            auto const end = line.find(SP, start);
+            if (count == fields.size())
+                return false;
+            fields[count++] = line.substr(start, end - start);
+            if (end == std::string_view::npos)
+                break;
+            start = end + 1;
+        }
+
+        if (fields[0] != "PROXY")
+            return false;
+
+        if (fields[1] != "UNKNOWN")
+        {
+            if (count != fields.size() || (fields[1] != "TCP4" && fields[1] != "TCP6"))
+                return false;
+
+            auto const family = fields[1] == "TCP4" ? AF_INET : AF_INET6;
+            header.family = family == AF_INET ? HttpProxyHeader::Family::INET : HttpProxyHeader::Family::INET6;
+
+            // validate the addresses, also making sure they are in the announced family
+            for (auto const& [field, text]:
+                 { std::pair { fields[2], &source }, std::pair { fields[3], &destination } })
+            {
+                std::array<uint8_t, sizeof(in6_addr)> address {};
+                if (field.size() >= text->size())
+                    return false;
+                std::memcpy(text->data(), field.data(), field.size());
+                if (inet_pton(family, text->data(), address.data()) != 1)
+                    return false;
+            }
+            header.sourceAddress = fields[2];
+            header.destinationAddress = fields[3];
+
+            for (auto const& [field, port]: { std::pair { fields[4], &header.sourcePort },
+                                              std::pair { fields[5], &header.destinationPort } })
+            {
+                auto const value = field.size() <= 5 ? parseInt(field) : -1;
+                if (field.empty() || value < 0 || value > 0xFFFF)
+                    return false;
+                *port = static_cast<uint16_t>(value);
+            }
+        }
+    }
+    else
+    {
+        header.version = 2;
+        auto const versionCommand = static_cast<uint8_t>(_proxyHeader[12]);
+        auto const family = static_cast<uint8_t>(_proxyHeader[13]) >> 4;
+        if (versionCommand >> 4 != 2 || (versionCommand & 0x0F) > 1)
+            return false;
+
+        auto const body = _proxyHeader.substr(ProxyHeaderV2Size);
+        size_t addressSize = 0;
+        switch (family)
+        {
+            case 0: addressSize = 0; break;
+            case 1: addressSize = 12; break;
+            case 2: addressSize = 36; break;
+            case 3: addressSize = 216; break;
+            default: return false;
+        }
+        if (body.size() < addressSize)
+            return false;
+
+        // the addresses of a LOCAL command are to be ignored, the real connection's ones apply
+        header.local = (versionCommand & 0x0F) == 0;
+        if (!header.local)
+        {
+            switch (family)
+            {
+                case 1:
+                case 2: {
+                    auto const af = family == 1 ? AF_INET : AF_INET6;
+                    auto const size = family == 1 ? 4u : 16u;
+                    inet_ntop(af, body.data(), source.data(), source.size());
+                    inet_ntop(af, body.data() + size, destination.data(), destination.size());
+                    header.family = family == 1 ? HttpProxyHeader::Family::INET : HttpProxyHeader::Family::INET6;
+                    header.sourceAddress = source.data();
+                    header.destinationAddress = destination.data();
+                    header.sourcePort = readUInt16(body, 2 * size);
+                    header.destinationPort = readUInt16(body, 2 * size + 2);
+                    break;
+                }
+                case 3:
+                    header.family = HttpProxyHeader::Family::UNIX;
+                    header.sourceAddress = body.substr(0, strnlen(body.data(), 108));
+                    header.destinationAddress = body.substr(108, strnlen(body.data() + 108, 108));
+                    break;
+                default: break;
+            }
+        }
+
+        header.tlvs = body.substr(addressSize);
+        for (auto rest = header.tlvs; !rest.empty();)
+        {
+            if (rest.size() < 3 || rest.size() - 3 < readUInt16(rest, 1))
+                return false;
+            rest.remove_prefix(3 + readUInt16(rest, 1));
+        }
+    }
+
+    _listener->onProxyHeader(header);
+
+    _proxyHeaderExpected = false;
+    _proxyHeader = {};
+    _spill.clear();
+    _state = HttpParserState::MESSAGE_BEGIN;
+    return true;
+}
+
+// {{{ request digest
+void HttpParser::enableHeaderIndex()
+{
+    if (!_headerIndex)
+        _headerIndex = std::make_unique<HttpHeaderIndex>();
+}
+
+void HttpParser::setDigestHeaders(std::vector<std::string_view> const& headers)
+{
+    _digestEnabled = true;
+    _digestHeaders.clear();
+    for (auto const name: headers)
+        _digestHeaders.push_back(hashBytes(name, 0, true));
+}
+
+void HttpParser::beginDigest() noexcept
+{
+    _digest = {};
+    _digestSelected = 0;
+    _digestHeaderCount = 0;
+    _digestCookie = false;
+    _digestReferer = false;
+    _digestLanguage.fill('0');
+}
+
+void HttpParser::digestRequestLine(HttpVersion version) noexcept
+{
+    _digest.cacheKey = hashMix(hashBytes(_method, HashSecret1), hashBytes(_entity, HashSecret2));
+
+    auto& buffer = _digest.fingerprintBuffer;
+    buffer[0] = static_cast<char>(std::tolower(_method[0]));
+    buffer[1] = _method.size() > 1 ? static_cast<char>(std::tolower(_method[1])) : '0';
+    switch (version)
+    {
+        case HttpVersion::VERSION_0_9: buffer[2] = '0', buffer[3] = '9'; break;
+        case HttpVersion::VERSION_1_0: buffer[2] = '1', buffer[3] = '0'; break;
+        case HttpVersion::VERSION_2_0: buffer[2] = '2', buffer[3] = '0'; break;
+        default: buffer[2] = '1', buffer[3] = '1'; break;
+    }
+}
+
+void HttpParser::digestHeader(uint64_t nameHash) noexcept
+{
+    for (size_t k = 0; k < _digestHeaders.size(); ++k)
+        if (_digestHeaders[k] == nameHash)
+            _digestSelected += hashBytes(_value, k + 1); // a sum, so that the order does not matter
+
+    if (iequals(_name, "Cookie"))
+        _digestCookie = true;
+    else if (iequals(_name, "Referer"))
+        _digestReferer = true;
+    else
+    {
+        // the first Accept-Language only, e.g. "en-US,en;q=0.9" as "enus"
+        if (_digestLanguage[0] == '0' && iequals(_name, "Accept-Language"))
+        {
+            size_t n = 0;
+            for (auto const c: _value)
+            {
+                if (n == _digestLanguage.size() || c == ',' || c == ';')
+                    break;
+                if (std::isalnum(c))
+                    _digestLanguage[n++] = static_cast<char>(std::tolower(c));
+            }
+        }
+
+        _digest.headerOrder = hashMix(_digest.headerOrder ^ HashSecret1, nameHash ^ HashSecret2);
+        ++_digestHeaderCount;
+    }
+}
+
+void HttpParser::endDigest() noexcept
+{
+    _digest.cacheKey = hashMix(_digest.cacheKey ^ HashSecret0, _digestSelected ^ HashSecret1);
+
+    static constexpr char digits[] = "0123456789abcdef";
+    auto& buffer = _digest.fingerprintBuffer;
+    auto const count = std::min(_digestHeaderCount, 99u);
+    buffer[4] = _digestCookie ? 'c' : 'n';
+    buffer[5] = _digestReferer ? 'r' : 'n';
+    buffer[6] = static_cast<char>('0' + count / 10);
+    buffer[7] = static_cast<char>('0' + count % 10);
+    std::copy(_digestLanguage.begin(), _digestLanguage.end(), buffer.begin() + 8);
+    buffer[12] = '_';
+    for (size_t k = 0; k < 12; ++k)
+        buffer[13 + k] = digits[(_digest.headerOrder >> (60 - 4 * k)) & 0x0F];
+}
+// }}}
+
+// {{{ connection semantics
+void HttpParser::parseConnectionOptions(std::string_view value)
+{
+    forEachToken(value, [this](std::string_view option) {
+        if (iequals(option, "close"))
+            _connectionClose = true;
+        else if (iequals(option, "keep-alive"))
+            _connectionKeepAlive = true;
+        else if (iequals(option, "upgrade"))
+            _connectionUpgrade = true;
+        else if (!isHopByHop(option))
+        {
+            // any other option names a header field meant for this connection only
+            if (!_connectionOptions.empty())
+                _connectionOptions += ',';
+            for (auto const c: option)
+                _connectionOptions += toLowerAscii(c);
+        }
+    });
+}
+
+void HttpParser::collectHopByHopHeaders()
+{
+    // the standard names stay in place from one message to the next
+    if (_hopByHop.empty())
+        _hopByHop.assign(StandardHopByHopHeaders.begin(), StandardHopByHopHeaders.end());
+    _hopByHop.resize(StandardHopByHopHeaders.size());
+
+    forEachToken(_connectionOptions, [this](std::string_view name) { _hopByHop.push_back(name); });
+}
+
+bool HttpParser::isHopByHop(std::string_view name) const noexcept
+{
+    for (auto const standard: StandardHopByHopHeaders)
+        if (iequals(name, standard))
+            return true;
+
+    bool found = false;
+    forEachToken(_connectionOptions, [&](std::string_view option) {
+        if (iequals(name, option))
+            found = true;
+    });
+    return found;
+}
+
+bool HttpParser::shouldKeepAlive() const noexcept
+{
+    if (_connectionClose || isUpgrade())
+        return false;
+
+    switch (_mode)
+    {
+        case HttpParseMode::MESSAGE: return true;
+        case HttpParseMode::RESPONSE:
+            // a body without Content-Length and chunked transfer coding ends with the connection
+            if (_contentLength < 0 && !_chunked)
+                return false;
+            break;
+        case HttpParseMode::REQUEST: break;
+    }
+
+    // persistent by default since HTTP/1.1, on request only before
+    return _versionMajor > 1 || (_versionMajor == 1 && _versionMinor >= 1) || _connectionKeepAlive;
+}
+
+bool HttpParser::isUpgrade() const noexcept
+{
+    switch (_mode)
+    {
+        case HttpParseMode::REQUEST: return _upgradeRequested && _connectionUpgrade;
+        case HttpParseMode::RESPONSE: return _code == 101;
+        case HttpParseMode::MESSAGE: return false;
+    }
+    return false;
+}
+// }}}
+
+void HttpParser::endMessage()
+{
+    // Whatever follows the message belongs to another protocol, so parsing stops for good (or until
+    // reset(), if the upgrade is not accepted).
+    if (isUpgrade())
+        _state = HttpParserState::UPGRADED;
+
+    _messageEnded = true;
+    _listener->onMessageEnd();
+}
+
 void HttpParser::reset() noexcept
 {
     _state = HttpParserState::MESSAGE_BEGIN;
     _bytesReceived = 0;
+    _messageOffset = 0;
+    _headerLineOffset = 0;
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+    _headerCount = 0;
+#endif
 }
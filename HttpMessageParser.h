@@ -2,8 +2,16 @@
 #pragma once
 
 #include <sys/types.h> // ssize_t
-
+#include <sys/uio.h>   // iovec
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 enum class HttpVersion
 {
@@ -11,6 +19,7 @@ enum class HttpVersion
     VERSION_0_9 = 9,
     VERSION_1_0 = 10,
     VERSION_1_1 = 11,
+    VERSION_2_0 = 20, //!< as reported by HpackDecoder
 };
 
 enum class HttpStatus // {{{
@@ -90,11 +99,51 @@ enum class HttpStatus // {{{
 };
 // }}}
 
+/// Connection addresses conveyed by a PROXY protocol header (HAProxy PROXY protocol v1 or v2).
+struct HttpProxyHeader
+{
+    /// TLV types of PROXY protocol v2 headers, as far as they are of general interest.
+    enum TlvType : uint8_t
+    {
+        TLV_ALPN = 0x01,
+        TLV_AUTHORITY = 0x02,
+        TLV_UNIQUE_ID = 0x05,
+        TLV_SSL = 0x20,
+    };
+
+    enum class Family
+    {
+        UNSPEC, //!< no addresses conveyed, e.g. v1 "UNKNOWN" or a v2 LOCAL command
+        INET,
+        INET6,
+        UNIX,
+    };
+
+    int version = 0;                     //!< 1 (text) or 2 (binary)
+    bool local = false;                  //!< v2 LOCAL command, e.g. a health check of the proxy itself
+    Family family = Family::UNSPEC;
+    std::string_view sourceAddress;      //!< textual address (a path for UNIX)
+    std::string_view destinationAddress; //!< textual address (a path for UNIX)
+    uint16_t sourcePort = 0;
+    uint16_t destinationPort = 0;
+    std::string_view tlvs; //!< v2 type-length-value vector following the addresses, as received
+
+    /// @return the value of the first TLV of the given @p type, empty if there is none.
+    std::string_view tlv(uint8_t type) const noexcept;
+};
+
 class HttpListener // {{{
 {
   public:
     virtual ~HttpListener() = default;
 
+    /**
+     * PROXY protocol header, that has been fully parsed (see HttpParser::expectProxyHeader()).
+     *
+     * @param header the conveyed addresses, valid during this call only
+     */
+    virtual void onProxyHeader(HttpProxyHeader const& header) {}
+
     /** HTTP/1.1 Request-Line, that has been fully parsed.
      *
      * @param method the request-method (e.g. GET or POST)
@@ -135,6 +184,22 @@ class HttpListener // {{{
      */
     virtual void onMessageHeaderEnd() {}
 
+    /**
+     * The head of a request carrying "Expect: 100-continue" and a body has
+     * been parsed (invoked right after onMessageHeaderEnd()). The client holds
+     * the body back until it receives an interim 100 (Continue) response, or
+     * until a timeout of its own expires (one second for curl).
+     *
+     * @retval true  go ahead: 100 (Continue) has been sent (or queued) and the
+     *               parser proceeds with the body right away (the default).
+     * @retval false wait: parsing pauses in HttpParserState::EXPECT_CONTINUE
+     *               until HttpParser::continueMessage() is called, so the
+     *               decision can be taken asynchronously. To reject the body,
+     *               send a final response instead and close the connection (or
+     *               continue the message to read the body anyway).
+     */
+    virtual bool onExpectContinue() { return true; }
+
     /**
      * Invoked for every chunk of message content being processed.
      *
@@ -160,6 +225,13 @@ enum class HttpParserState // {{{
     // artificial
     PROTOCOL_ERROR = 1,
     MESSAGE_BEGIN,
+    UPGRADED,        //!< a message switching protocols has been parsed, see HttpParser::isUpgraded()
+    EXPECT_CONTINUE, //!< awaiting the server's decision on a body, see HttpListener::onExpectContinue()
+
+    // PROXY protocol header, see HttpParser::expectProxyHeader()
+    PROXY_HEADER_BEGIN = 50,
+    PROXY_HEADER_V1,
+    PROXY_HEADER_V2,
 
     // Request-Line
     REQUEST_LINE_BEGIN = 100,
@@ -220,6 +292,237 @@ enum class HttpParserState // {{{
     CONTENT_CHUNK_LF3
 }; // }}}
 
+/// Coarse grouping of HttpParserState, as used for instrumentation.
+enum class HttpParserStateGroup
+{
+    MESSAGE,         //!< artificial states
+    REQUEST_LINE,    //!< Request-Line
+    STATUS_LINE,     //!< Status-Line
+    HEADER,          //!< message-headers, except for LWS
+    LWS,             //!< LWS within message-headers, including line ends
+    CONTENT,         //!< message-content
+    CONTENT_FRAMING, //!< chunk sizes and line ends of chunked message-content
+};
+
+constexpr size_t HttpParserStateGroupCount = 7;
+
+constexpr HttpParserStateGroup groupOf(HttpParserState state) noexcept
+{
+    switch (state)
+    {
+        case HttpParserState::CONTENT_BEGIN:
+        case HttpParserState::CONTENT:
+        case HttpParserState::CONTENT_ENDLESS:
+        case HttpParserState::CONTENT_CHUNK_BODY: return HttpParserStateGroup::CONTENT;
+        default: break;
+    }
+
+    auto const value = static_cast<int>(state);
+    if (value >= static_cast<int>(HttpParserState::CONTENT_CHUNK_SIZE_BEGIN))
+        return HttpParserStateGroup::CONTENT_FRAMING;
+    if (value >= static_cast<int>(HttpParserState::LWS_BEGIN))
+        return HttpParserStateGroup::LWS;
+    if (value >= static_cast<int>(HttpParserState::HEADER_NAME_BEGIN))
+        return HttpParserStateGroup::HEADER;
+    if (value >= static_cast<int>(HttpParserState::STATUS_LINE_BEGIN))
+        return HttpParserStateGroup::STATUS_LINE;
+    if (value >= static_cast<int>(HttpParserState::REQUEST_LINE_BEGIN))
+        return HttpParserStateGroup::REQUEST_LINE;
+    return HttpParserStateGroup::MESSAGE;
+}
+
+/// Hot-path counters of an HttpParser, collected if built with HTTP_MESSAGE_PARSER_STATS defined.
+///
+/// Counters indexed by HttpParserStateGroup attribute to the group of the state that consumed the bytes
+/// (respectively that detected the error). The group stands in for the cause of an error: an invalid
+/// method, target or version in the request line, a bad status code in the status line, an invalid
+/// header token, a bad chunk size in the chunk framing, or a malformed PROXY protocol header (MESSAGE).
+struct HttpParserStats
+{
+    using GroupCounters = std::array<uint64_t, HttpParserStateGroupCount>;
+
+    /// upper bounds of the headersPerMessage histogram buckets (the last bucket being unbounded)
+    static constexpr std::array<unsigned, 5> HeadersPerMessageBounds { 4, 8, 16, 32, 64 };
+
+    GroupCounters bytes {};  //!< bytes consumed
+    GroupCounters cycles {}; //!< CPU cycles spent in sampled fragments (nanoseconds on non-x86)
+    GroupCounters errors {}; //!< protocol errors
+
+    uint64_t fragments = 0;        //!< parseFragment() invocations
+    uint64_t sampledFragments = 0; //!< parseFragment() invocations that sampled cycles
+    uint64_t splitTokens = 0;      //!< tokens that straddled two fragments and were carried over
+    uint64_t messages = 0;         //!< message heads fully parsed
+    uint64_t headers = 0;          //!< headers of all fully parsed message heads
+
+    std::array<uint64_t, HeadersPerMessageBounds.size() + 1> headersPerMessage {}; //!< histogram
+
+    /// Accumulates @p other, e.g. to aggregate the parsers of all connections.
+    HttpParserStats& operator+=(HttpParserStats const& other) noexcept;
+
+    /// Renders all counters in the Prometheus text exposition format.
+    std::string toPrometheus(std::string_view prefix = "http_parser") const;
+};
+
+/// Hashes of a request head, computed by HttpParser while parsing it (see HttpParser::setDigestHeaders()).
+struct HttpRequestDigest
+{
+    /// Hash over the method, the request target and the values of the selected headers, e.g. to key a
+    /// response cache by. The order in which the selected headers appear does not matter.
+    uint64_t cacheKey = 0;
+
+    /// Hash over the (case-folded) names of all headers but Cookie and Referer, in their order.
+    uint64_t headerOrder = 0;
+
+    /// JA4H-style fingerprint, e.g. "ge11cr05enus_0123456789ab": method, version, presence of Cookie and
+    /// Referer, header count, Accept-Language prefix and, instead of a SHA-256 prefix, headerOrder.
+    std::array<char, 25> fingerprintBuffer {};
+
+    std::string_view fingerprint() const noexcept { return { fingerprintBuffer.data(), fingerprintBuffer.size() }; }
+};
+
+/// Header field value as scanned by HttpParser: surrounding whitespace trimmed, but line folds (obs-fold,
+/// CR LF followed by SP or HT) kept as received.
+///
+/// Folded values are obsolete and next to never seen, so normalizing them is left until asked for.
+class HttpHeaderValue
+{
+  public:
+    constexpr HttpHeaderValue() noexcept = default;
+
+    /// @param raw    the value as received
+    /// @param folded whether or not @p raw may contain line folds
+    constexpr HttpHeaderValue(std::string_view raw, bool folded) noexcept: _raw(raw), _folded(folded) {}
+
+    /// Wraps a value that did not come from HttpParser::headerValue(), looking for line folds in it.
+    explicit HttpHeaderValue(std::string_view raw) noexcept;
+
+    constexpr std::string_view raw() const noexcept { return _raw; }
+    constexpr bool isFolded() const noexcept { return _folded; }
+
+    /// The value with every line fold, and the whitespace around it, replaced by a single SP.
+    ///
+    /// @param scratch holds the normalized value if folded, and is left untouched otherwise
+    /// @return        raw() unless folded, a view into @p scratch otherwise
+    std::string_view normalized(std::string& scratch) const;
+
+  private:
+    std::string_view _raw;
+    bool _folded = false;
+};
+
+/// Index of the header fields of one message, built by HttpParser while parsing (see
+/// HttpParser::enableHeaderIndex()), so that handlers need no linear scans or maps of their own.
+///
+/// An open-addressing hash table over case-folded names, with the fields of one name (e.g. Set-Cookie or
+/// Via) chained in the order received. Capacity is fixed, so building it takes no allocation: fields are
+/// referred to in place, and copied into an arena of the index only if they would not outlive the
+/// fragment they were received in (heads spanning several fragments).
+class HttpHeaderIndex
+{
+    struct Field
+    {
+        uint64_t hash;
+        std::string_view name;
+        std::string_view value;
+        uint8_t next; //!< next field of the same name, plus 1
+        uint8_t last; //!< last field of the same name, plus 1 (valid for the first one only)
+    };
+
+  public:
+    static constexpr size_t MaxFields = 64;
+    static constexpr size_t ArenaSize = 16 * 1024;
+
+    /// The values of all fields of one name, in the order received.
+    class Values
+    {
+      public:
+        class iterator
+        {
+          public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = std::string_view;
+
+            iterator() noexcept = default;
+            iterator(Field const* fields, uint8_t index) noexcept: _fields(fields), _index(index) {}
+
+            std::string_view operator*() const noexcept { return _fields[_index - 1].value; }
+            iterator& operator++() noexcept
+            {
+                _index = _fields[_index - 1].next;
+                return *this;
+            }
+            iterator operator++(int) noexcept
+            {
+                auto const result = *this;
+                ++*this;
+                return result;
+            }
+            bool operator==(iterator const& other) const noexcept { return _index == other._index; }
+
+          private:
+            Field const* _fields = nullptr;
+            uint8_t _index = 0; //!< field plus 1, 0 past the end
+        };
+
+        Values(Field const* fields, uint8_t first) noexcept: _fields(fields), _first(first) {}
+
+        iterator begin() const noexcept { return iterator(_fields, _first); }
+        iterator end() const noexcept { return iterator(_fields, 0); }
+        bool empty() const noexcept { return _first == 0; }
+
+      private:
+        Field const* _fields;
+        uint8_t _first;
+    };
+
+    /// The value of the first field named @p name (case-insensitive), or an empty view.
+    std::string_view find(std::string_view name) const noexcept;
+
+    /// The values of all fields named @p name (case-insensitive).
+    Values values(std::string_view name) const noexcept { return Values(_fields.data(), lookup(name)); }
+
+    /// Number of fields named @p name (case-insensitive).
+    size_t count(std::string_view name) const noexcept;
+
+    /// Number of fields indexed.
+    size_t size() const noexcept { return _size; }
+
+    /// Whether or not fields have been left out, being more than MaxFields, or too large for the arena.
+    bool overflowed() const noexcept { return _overflowed; }
+
+  private:
+    friend class HttpParser;
+
+    static constexpr size_t SlotCount = 2 * MaxFields; //!< a power of two, at most half full
+
+    void clear() noexcept;
+    void add(uint64_t hash, std::string_view name, std::string_view value, bool copy) noexcept;
+    void retain() noexcept;
+    bool copy(std::string_view& token) noexcept;
+    uint8_t lookup(std::string_view name) const noexcept;
+
+    std::array<uint8_t, SlotCount> _slots {}; //!< first field of a name, plus 1, or 0 if empty
+    std::array<Field, MaxFields> _fields {};
+    size_t _size = 0;
+    size_t _retained = 0; //!< fields known to outlive the current fragment
+    bool _overflowed = false;
+    size_t _arenaUsed = 0;
+    std::array<char, ArenaSize> _arena {};
+};
+
+class HttpParser;
+
+/// A chunk received on one connection, as part of a batch passed to HttpParser::parseFragments().
+struct HttpParseJob
+{
+    HttpParser* parser = nullptr;
+    std::string_view chunk;
+    size_t parsed = 0; //!< number of bytes parsed and processed, set by parseFragments()
+};
+
 enum class HttpParseMode
 {
     /// the message to parse does not contain either an HTTP request-line nor
@@ -256,10 +559,50 @@ class HttpParser
     ///
     /// Processes a message-chunk.
     ///
+    /// Parsing stops right after a message has been fully processed, so that
+    /// pipelined messages are parsed by calling this function again with the
+    /// remaining bytes.
+    ///
+    /// A token (e.g. a header value) that straddles two chunks is carried over
+    /// internally, so the caller may reuse the chunk's memory as soon as this
+    /// call returns.
+    ///
+    /// A request with an Upgrade header and a Connection header listing
+    /// "upgrade", or a 101 (Switching Protocols) response, makes parsing stop
+    /// right after that message (see isUpgraded()). The bytes following it in
+    /// @p chunk, starting at the returned offset, belong to the new protocol.
+    ///
     /// @param chunk the chunk of bytes to process
     /// @return      number of bytes actually parsed and processed
     size_t parseFragment(std::string_view chunk) noexcept;
 
+    ///
+    /// Processes a message-chunk made up of several segments, e.g. the two parts
+    /// of a ring buffer that wraps around, or an iovec array filled by readv().
+    ///
+    /// Behaves as parseFragment() over the concatenation of all segments, but
+    /// without concatenating them: tokens within a segment are passed on as views
+    /// into it, and only those straddling two segments are assembled internally,
+    /// just like tokens straddling two chunks.
+    ///
+    /// @param segments the segments of the chunk, in order
+    /// @return         number of bytes actually parsed and processed, counted
+    ///                 across segments
+    size_t parseFragment(std::span<iovec const> segments) noexcept;
+
+    ///
+    /// Processes the chunks received on many connections at once, e.g. all
+    /// those of one epoll_wait() or io_uring completion batch.
+    ///
+    /// Each chunk is parsed completely, including any number of pipelined
+    /// messages, up to a protocol error or a message switching protocols.
+    /// While one job is being parsed, the parsers, listeners and first bytes
+    /// of the jobs ahead are prefetched, so that their cache misses overlap
+    /// with parsing rather than stall it.
+    ///
+    /// @param jobs the chunks to parse, each with its own parser
+    static void parseFragments(std::span<HttpParseJob> jobs) noexcept;
+
     ssize_t contentLength() const noexcept;
     bool isChunked() const noexcept { return _chunked; }
     void reset() noexcept;
@@ -273,13 +616,116 @@ class HttpParser
 
     size_t bytesReceived() const noexcept { return _bytesReceived; }
 
+    /// Offset of the first byte of the current message within all bytes received, i.e. the value of
+    /// bytesReceived() as of the start of its start-line (or of its first header, in HttpParseMode::MESSAGE).
+    size_t messageOffset() const noexcept { return _messageOffset; }
+
+    /// Indexes the header fields of every message from now on, see HttpHeaderIndex.
+    void enableHeaderIndex();
+
+    /// Index of the header fields of the current message, or nullptr unless enabled. Complete from
+    /// HttpListener::onMessageHeaderEnd() on, and valid until the parseFragment() call it has been
+    /// completed in returns.
+    HttpHeaderIndex const* headerIndex() const noexcept { return _headerIndex.get(); }
+
+    /// The value of the header currently reported by HttpListener::onMessageHeader(), telling whether or
+    /// not it needs to be normalized at no extra cost.
+    HttpHeaderValue headerValue() const noexcept { return HttpHeaderValue(_value, _valueFolded); }
+
+    /// Offset of the first byte of the header line currently reported by HttpListener::onMessageHeader(),
+    /// counted like bytesReceived(). The line, including any continuation lines and its CR LF, ends at
+    /// bytesReceived(), and so does the message head within HttpListener::onMessageHeaderEnd().
+    size_t headerLineOffset() const noexcept { return _headerLineOffset; }
+
+    HttpParserState state() const noexcept { return _state; }
+
+    /// Whether or not parsing has stopped after a message switching protocols.
+    ///
+    /// Once the upgrade has been declined, reset() continues parsing HTTP.
+    bool isUpgraded() const noexcept { return _state == HttpParserState::UPGRADED; }
+
+    /// Whether or not the current request holds its body back until it receives 100 (Continue), that
+    /// is, an HTTP/1.1 request with a body and "Expect: 100-continue". Valid from onMessageHeaderEnd()
+    /// until the body has been parsed.
+    bool expectsContinue() const noexcept;
+
+    /// Resumes with the body of a request paused in HttpParserState::EXPECT_CONTINUE.
+    void continueMessage() noexcept;
+
+    /// Whether or not the connection persists after the current message, judging by its version, its
+    /// Connection (or Proxy-Connection) header and, for responses, how its body is delimited. Valid from
+    /// HttpListener::onMessageHeaderEnd() on, so that servers need no second pass over the headers.
+    bool shouldKeepAlive() const noexcept;
+
+    /// Whether or not the current message switches protocols: a request with an Upgrade header and a
+    /// Connection header listing "upgrade", or a 101 (Switching Protocols) response.
+    bool isUpgrade() const noexcept;
+
+    /// Lower-case names of the headers a proxy must not forward with the current message: the standard
+    /// hop-by-hop headers, followed by those the Connection header lists. Valid from
+    /// HttpListener::onMessageHeaderEnd() until the next message begins.
+    std::span<std::string_view const> hopByHopHeaders() const noexcept { return _hopByHop; }
+
+    /// Tests whether the header @p name (case-insensitive) is hop-by-hop for the current message.
+    bool isHopByHop(std::string_view name) const noexcept;
+
+    /// Requires a PROXY protocol (v1 or v2) header ahead of the next message, as sent by L4 load
+    /// balancers at the start of each connection.
+    ///
+    /// The header is reported via HttpListener::onProxyHeader(), so that the first bytes received
+    /// can be passed to parseFragment() as they are. A missing or malformed header is a protocol error.
+    void expectProxyHeader(bool expected = true) noexcept { _proxyHeaderExpected = expected; }
+
+    /// Computes an HttpRequestDigest of every request head as it is parsed, so that cache lookups and
+    /// bot detection need no second pass over the headers.
+    ///
+    /// @param headers names of the headers (case-insensitive) whose values go into the cache key, e.g.
+    ///                Host and whatever cached responses vary on
+    void setDigestHeaders(std::vector<std::string_view> const& headers);
+
+    /// Digest of the current request head, complete once HttpListener::onMessageHeaderEnd() is invoked.
+    HttpRequestDigest const& digest() const noexcept { return _digest; }
+
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+    HttpParserStats const& stats() const noexcept { return _stats; }
+    void resetStats() noexcept { _stats = {}; }
+
+    /// Samples CPU cycles in every @p n-th call to parseFragment() only, 0 disables sampling.
+    void setCycleSampling(unsigned n) noexcept { _cycleSampling = n; }
+#endif
+
   private:
+    void endMessage();
+    void parseConnectionOptions(std::string_view value);
+    void collectHopByHopHeaders();
+    bool isSpilled(std::string_view token) const noexcept;
+    void spill(std::string_view& token, std::string_view bytes);
+    void extendToken(std::string_view& token, char const* i, size_t n = 1);
+    bool parseProxyHeader();
+    void beginDigest() noexcept;
+    void digestRequestLine(HttpVersion version) noexcept;
+    void digestHeader(uint64_t nameHash) noexcept;
+    void endDigest() noexcept;
+    void retainTokens(std::string_view chunk);
+    void prefetch() const noexcept;
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+    void recordMessageHead() noexcept;
+#endif
+
     HttpParseMode _mode;                                     /// parsing mode (request/response/something)
     HttpListener* _listener;                                 /// HTTP message component listener
     HttpParserState _state = HttpParserState::MESSAGE_BEGIN; /// the current parser/processing state
+    bool _messageEnded = false;                              /// a message has ended in the current call
 
     // stats
     size_t _bytesReceived = 0;
+    size_t _messageOffset = 0;    //!< see messageOffset()
+    size_t _headerLineOffset = 0; //!< see headerLineOffset()
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+    HttpParserStats _stats;
+    unsigned _cycleSampling = 64;
+    unsigned _headerCount = 0; //!< headers of the current message
+#endif
 
     // implicit LWS handling
     HttpParserState _lwsNext; //!< state to apply on successfull LWS
@@ -298,8 +744,39 @@ class HttpParser
     // current parsed header
     std::string_view _name;
     std::string_view _value;
+    bool _valueFolded = false;   //!< whether or not _value has been extended over a line fold
+    size_t _valueTrailingWs = 0; //!< trailing whitespace of _value, including line folds, to be trimmed
+    std::unique_ptr<HttpHeaderIndex> _headerIndex;
+
+    // PROXY protocol header
+    bool _proxyHeaderExpected = false;
+    std::string_view _proxyHeader; //!< the header received so far
+
+    // request digest
+    bool _digestEnabled = false;
+    std::vector<uint64_t> _digestHeaders; //!< hashes of the case-folded names of the cache key headers
+    HttpRequestDigest _digest;
+    uint64_t _digestSelected = 0; //!< cache key contribution of the selected headers seen so far
+    unsigned _digestHeaderCount = 0;
+    bool _digestCookie = false;
+    bool _digestReferer = false;
+    std::array<char, 4> _digestLanguage {};
+
+    // tokens that straddle two fragments are carried over in here
+    std::string _spill;
 
     // body
     bool _chunked = false;       //!< whether or not request content is chunked encoded
     ssize_t _contentLength = -1; //!< content length of whole content or current chunk
+
+    // protocol upgrade
+    bool _upgradeRequested = false;  //!< an Upgrade header has been seen
+    bool _connectionUpgrade = false; //!< the Connection header lists "upgrade"
+    bool _expectContinue = false;    //!< an "Expect: 100-continue" header has been seen
+
+    // connection semantics
+    bool _connectionClose = false;           //!< the Connection header lists "close"
+    bool _connectionKeepAlive = false;       //!< the Connection header lists "keep-alive"
+    std::string _connectionOptions;          //!< other names the Connection header lists, lower-case
+    std::vector<std::string_view> _hopByHop; //!< see hopByHopHeaders()
 };
@@ -332,3 +332,760 @@ TEST_CASE("http_http1_Parser.pipelined1")
 
     REQUIRE(n + m == input.size());
 }
+
+TEST_CASE("http_http1_Parser.pipelined_chunkedThenPlain")
+{
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    constexpr std::string_view input = "POST /foo HTTP/1.1\r\n"
+                                       "Transfer-Encoding: chunked\r\n"
+                                       "\r\n"
+                                       "3\r\nabc\r\n"
+                                       "0\r\n\r\n"
+                                       "GET /bar HTTP/1.1\r\n\r\n";
+    size_t const n = parser.parseFragment(input);
+    REQUIRE("abc" == listener.body);
+    REQUIRE(listener.messageEnd);
+
+    listener.messageEnd = false;
+    size_t const m = parser.parseFragment(input.substr(n));
+
+    REQUIRE(n + m == input.size());
+    REQUIRE("/bar" == listener.entity);
+    REQUIRE(!parser.isChunked());
+    REQUIRE(listener.messageEnd);
+    REQUIRE(HttpParserState::MESSAGE_BEGIN == parser.state());
+}
+
+TEST_CASE("http_http1_Parser.fragmented_tokens")
+{
+    // every token straddles a fragment boundary, and each fragment is gone once parsed
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    std::string_view const input = "GET /foo?bar HTTP/1.1\r\n"
+                                   "Foo: the foo\r\n"
+                                   "X-Folded: the\r\n"
+                                   " folded bar\r\n"
+                                   "Content-Length: 6\r\n"
+                                   "\r\n"
+                                   "123456";
+
+    size_t n = 0;
+    for (char const c: input)
+    {
+        std::string fragment(1, c);
+        n += parser.parseFragment(fragment);
+        fragment = "#";
+    }
+
+    REQUIRE(n == input.size());
+    REQUIRE("GET" == listener.method);
+    REQUIRE("/foo?bar" == listener.entity);
+    REQUIRE(HttpVersion::VERSION_1_1 == listener.version);
+    REQUIRE(3 == listener.headers.size());
+    REQUIRE("Foo" == listener.headers[0].first);
+    REQUIRE("the foo" == listener.headers[0].second);
+    REQUIRE("X-Folded" == listener.headers[1].first);
+    REQUIRE("the\r\n folded bar" == listener.headers[1].second);
+    REQUIRE("123456" == listener.body);
+    REQUIRE(listener.messageEnd);
+}
+
+TEST_CASE("http_http1_Parser.headerValues")
+{
+    struct: MockHttpListener
+    {
+        HttpParser* parser = nullptr;
+        std::vector<HttpHeaderValue> values;
+        std::vector<std::string> normalized;
+        void onMessageHeader(std::string_view name, std::string_view value) override
+        {
+            MockHttpListener::onMessageHeader(name, value);
+            std::string scratch;
+            values.push_back(parser->headerValue());
+            normalized.emplace_back(values.back().normalized(scratch));
+        }
+    } listener;
+
+    std::string_view const input = "GET / HTTP/1.1\r\n"
+                                   "Plain: value \t \r\n"
+                                   "Folded: the \r\n \t folded\r\n\tbar  \r\n"
+                                   "Fold-At-End: end\r\n  \r\n"
+                                   "Empty:   \r\n"
+                                   "\r\n";
+
+    for (size_t const fragmentSize: { 1, 1000 })
+    {
+        listener = {};
+        HttpParser parser(HttpParseMode::REQUEST, &listener);
+        listener.parser = &parser;
+        for (size_t offset = 0; offset < input.size(); offset += fragmentSize)
+            parser.parseFragment(std::string(input.substr(offset, fragmentSize)));
+
+        REQUIRE(4 == listener.headers.size());
+        REQUIRE("value" == listener.headers[0].second);
+        REQUIRE("the \r\n \t folded\r\n\tbar" == listener.headers[1].second);
+        REQUIRE("end" == listener.headers[2].second);
+        REQUIRE(listener.headers[3].second.empty());
+
+        REQUIRE(!listener.values[0].isFolded());
+        REQUIRE(listener.values[1].isFolded());
+        REQUIRE(std::vector<std::string> { "value", "the folded bar", "end", "" } == listener.normalized);
+    }
+
+    // values not coming from the parser
+    std::string scratch;
+    REQUIRE("a b" == HttpHeaderValue("a\r\n b").normalized(scratch));
+    REQUIRE(!HttpHeaderValue("a b").isFolded());
+}
+
+TEST_CASE("http_http1_Parser.headerIndex")
+{
+    struct: MockHttpListener
+    {
+        HttpParser* parser = nullptr;
+        std::vector<std::string> cookies;
+        std::string host;
+        size_t fields = 0;
+        size_t cookieCount = 0;
+        bool overflowed = false;
+        void onMessageHeaderEnd() override
+        {
+            MockHttpListener::onMessageHeaderEnd();
+            auto const* index = parser->headerIndex();
+            REQUIRE(index != nullptr);
+            for (auto const value: index->values("set-cookie"))
+                cookies.emplace_back(value);
+            host = index->find("HOST");
+            fields = index->size();
+            cookieCount = index->count("Set-Cookie");
+            overflowed = index->overflowed();
+            REQUIRE(index->find("Missing").empty());
+            REQUIRE(index->values("Missing").empty());
+        }
+    } listener;
+
+    std::string_view const input = "GET / HTTP/1.1\r\n"
+                                   "Set-Cookie: a=1\r\n"
+                                   "Host: example.com\r\n"
+                                   "set-cookie: b=2\r\n"
+                                   "Content-Length: 0\r\n"
+                                   "SET-COOKIE: c=3\r\n"
+                                   "\r\n";
+
+    // cut at every offset, clobbering each fragment once parsed, as receive buffers get reused
+    auto const feed = [](HttpParser& parser, std::string_view fragment) {
+        std::string buffer(fragment);
+        parser.parseFragment(buffer);
+        std::fill(buffer.begin(), buffer.end(), '#');
+    };
+
+    for (size_t split = 1; split <= input.size(); ++split)
+    {
+        listener = {};
+        HttpParser parser(HttpParseMode::REQUEST, &listener);
+        listener.parser = &parser;
+        parser.enableHeaderIndex();
+        feed(parser, input.substr(0, split));
+        if (split < input.size())
+            feed(parser, input.substr(split));
+
+        INFO("split at " << split);
+        REQUIRE(listener.messageEnd);
+        REQUIRE(std::vector<std::string> { "a=1", "b=2", "c=3" } == listener.cookies);
+        REQUIRE("example.com" == listener.host);
+        REQUIRE(5 == listener.fields);
+        REQUIRE(3 == listener.cookieCount);
+        REQUIRE(!listener.overflowed);
+    }
+
+    // more fields than indexed
+    std::string many = "GET / HTTP/1.1\r\n";
+    for (size_t i = 0; i < HttpHeaderIndex::MaxFields + 2; ++i)
+        many += "X-Field-" + std::to_string(i) + ": " + std::to_string(i) + "\r\n";
+    many += "\r\n";
+
+    listener = {};
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    listener.parser = &parser;
+    parser.enableHeaderIndex();
+    parser.parseFragment(many);
+    REQUIRE(listener.messageEnd);
+    REQUIRE(HttpHeaderIndex::MaxFields == listener.fields);
+    REQUIRE(listener.overflowed);
+
+    MockHttpListener plain;
+    HttpParser unindexed(HttpParseMode::REQUEST, &plain);
+    REQUIRE(unindexed.headerIndex() == nullptr);
+}
+
+TEST_CASE("http_http1_Parser.fragmented_statusLine")
+{
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::RESPONSE, &listener);
+    std::string const input = "HTTP/1.1 404 Not Found\r\n"
+                              "Content-Length: 0\r\n"
+                              "\r\n";
+
+    size_t n = 0;
+    for (size_t split = 10; split < input.size(); split += 10)
+        n += parser.parseFragment(std::string(input.substr(n, split - n)));
+    n += parser.parseFragment(std::string(input.substr(n)));
+
+    REQUIRE(n == input.size());
+    REQUIRE(HttpStatus::NotFound == listener.statusCode);
+    REQUIRE("Not Found" == listener.statusReason);
+    REQUIRE(listener.messageEnd);
+}
+
+TEST_CASE("http_http1_Parser.pipelined_recycledBuffers")
+{
+    // mimics a ring of small receive buffers, each overwritten right after it has been parsed
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    std::string const input = "GET /first HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "\r\n"
+                              "POST /second HTTP/1.1\r\n"
+                              "Content-Length: 5\r\n"
+                              "\r\n"
+                              "hello";
+
+    size_t messages = 0;
+    std::string buffer;
+    for (size_t offset = 0; offset < input.size(); offset += 7)
+    {
+        buffer = input.substr(offset, 7);
+        size_t consumed = 0;
+        while (consumed < buffer.size())
+        {
+            listener.messageEnd = false;
+            consumed += parser.parseFragment(std::string_view(buffer).substr(consumed));
+            REQUIRE(parser.state() != HttpParserState::PROTOCOL_ERROR);
+            if (listener.messageEnd)
+                ++messages;
+        }
+        buffer.assign(buffer.size(), '#');
+    }
+
+    REQUIRE(2 == messages);
+    REQUIRE("POST" == listener.method);
+    REQUIRE("/second" == listener.entity);
+    REQUIRE("localhost" == listener.headers[0].second);
+    REQUIRE("5" == listener.headers[1].second);
+    REQUIRE("hello" == listener.body);
+}
+
+TEST_CASE("http_http1_Parser.segments")
+{
+    // a ring buffer wrapping around: the input in two segments, split anywhere
+    std::string const input = "POST /upload HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "Content-Length: 5\r\n"
+                              "\r\n"
+                              "hello";
+
+    for (size_t split = 0; split <= input.size(); ++split)
+    {
+        std::string first = input.substr(0, split);
+        std::string second = input.substr(split);
+        iovec const segments[] = { { first.data(), first.size() }, { second.data(), second.size() } };
+
+        MockHttpListener listener;
+        HttpParser parser(HttpParseMode::REQUEST, &listener);
+        REQUIRE(input.size() == parser.parseFragment(segments));
+        REQUIRE(listener.messageEnd);
+        REQUIRE("/upload" == listener.entity);
+        REQUIRE("localhost" == listener.headers[0].second);
+        REQUIRE("hello" == listener.body);
+    }
+
+    // tokens within a segment are views into it
+    struct: HttpListener
+    {
+        std::vector<std::string_view> values;
+        void onMessageHeader(std::string_view, std::string_view value) override { values.push_back(value); }
+    } listener;
+
+    std::string first = "GET / HTTP/1.1\r\nHost: loc";
+    std::string second = "alhost\r\nAccept: */*\r\n\r\nGET /next HTTP/1.1\r\n";
+    iovec const segments[] = { { first.data(), first.size() }, { second.data(), second.size() } };
+
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    REQUIRE(first.size() + second.find("GET") == parser.parseFragment(segments)); // stops after a message
+    REQUIRE(2 == listener.values.size());
+    REQUIRE("localhost" == listener.values[0]);
+    REQUIRE("*/*" == listener.values[1]);
+    REQUIRE(second.data() + second.find("*/*") == listener.values[1].data());
+
+    // HTTP/0.9 requests end a message, too
+    std::string simple = "GET /\r\n";
+    std::string next = "GET /x HTTP/1.1\r\nHost: a\r\n\r\n";
+    iovec const simpleSegments[] = { { simple.data(), simple.size() }, { next.data(), next.size() } };
+
+    MockHttpListener simpleListener;
+    HttpParser simpleParser(HttpParseMode::REQUEST, &simpleListener);
+    REQUIRE(simple.size() == simpleParser.parseFragment(simpleSegments));
+    REQUIRE(simpleListener.messageEnd);
+    REQUIRE("/" == simpleListener.entity); // not the one of the next message
+}
+
+TEST_CASE("http_http1_Parser.parseFragments")
+{
+    // one batch per round, each round delivering the next 10 bytes of every connection
+    std::string const input = "GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                              "POST /b HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+                              "GET /c HTTP/1.1\r\n\r\n";
+    std::string const broken = "GET /a HTTP/1.1\r\nBad Header\r\n\r\n" + input;
+
+    std::vector<MockHttpListener> listeners(33);
+    std::vector<std::unique_ptr<HttpParser>> parsers;
+    for (auto& listener: listeners)
+        parsers.push_back(std::make_unique<HttpParser>(HttpParseMode::REQUEST, &listener));
+
+    auto const inputOf = [&](size_t k) -> std::string const& { return k == 7 ? broken : input; };
+
+    std::vector<size_t> offsets(parsers.size());
+    for (size_t round = 0; round * 10 < broken.size(); ++round)
+    {
+        std::vector<HttpParseJob> jobs;
+        for (size_t k = 0; k < parsers.size(); ++k)
+            if (offsets[k] < inputOf(k).size() && parsers[k]->state() != HttpParserState::PROTOCOL_ERROR)
+                jobs.push_back(
+                    HttpParseJob { parsers[k].get(), std::string_view(inputOf(k)).substr(round * 10, 10) });
+
+        HttpParser::parseFragments(jobs);
+        for (size_t k = 0, j = 0; k < parsers.size(); ++k)
+            if (j < jobs.size() && jobs[j].parser == parsers[k].get())
+                offsets[k] += jobs[j++].parsed;
+    }
+
+    for (size_t k = 0; k < parsers.size(); ++k)
+    {
+        if (k == 7)
+        {
+            REQUIRE(HttpStatus::BadRequest == listeners[k].errorCode);
+            REQUIRE(offsets[k] < broken.size());
+            continue;
+        }
+
+        REQUIRE(input.size() == offsets[k]);
+        REQUIRE(listeners[k].messageEnd);
+        REQUIRE("/c" == listeners[k].entity);
+        REQUIRE("hello" == listeners[k].body);
+        REQUIRE(HttpStatus::Undefined == listeners[k].errorCode);
+    }
+}
+
+TEST_CASE("http_http1_Parser.expectContinue")
+{
+    struct: MockHttpListener
+    {
+        int expectations = 0;
+        bool goAhead = true;
+        bool onExpectContinue() override
+        {
+            ++expectations;
+            return goAhead;
+        }
+    } listener;
+
+    std::string const head = "PUT /upload HTTP/1.1\r\n"
+                             "Expect: 100-Continue\r\n"
+                             "Content-Length: 5\r\n"
+                             "\r\n";
+
+    // going ahead right away
+    {
+        HttpParser parser(HttpParseMode::REQUEST, &listener);
+        REQUIRE(head.size() + 5 == parser.parseFragment(head + "hello"));
+        REQUIRE(1 == listener.expectations);
+        REQUIRE("hello" == listener.body);
+        REQUIRE(listener.messageEnd);
+    }
+
+    // deciding later on
+    listener = {};
+    listener.goAhead = false;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    REQUIRE(head.size() == parser.parseFragment(head));
+    REQUIRE(HttpParserState::EXPECT_CONTINUE == parser.state());
+    REQUIRE(parser.expectsContinue());
+    REQUIRE(!parser.isProcessingBody());
+    REQUIRE(0 == parser.parseFragment("hello"));
+
+    parser.continueMessage();
+    REQUIRE(5 == parser.parseFragment("hello"));
+    REQUIRE("hello" == listener.body);
+    REQUIRE(listener.messageEnd);
+    REQUIRE(1 == listener.expectations);
+
+    // no body, or an HTTP/1.0 client: nothing to wait for
+    std::string_view const bodyless = "GET / HTTP/1.1\r\nExpect: 100-continue\r\n\r\n";
+    REQUIRE(bodyless.size() == parser.parseFragment(bodyless));
+    REQUIRE("GET" == listener.method);
+
+    listener.body.clear();
+    std::string_view const http10 = "PUT / HTTP/1.0\r\nExpect: 100-continue\r\nContent-Length: 1\r\n\r\nx";
+    REQUIRE(http10.size() == parser.parseFragment(http10));
+    REQUIRE("PUT" == listener.method);
+    REQUIRE("x" == listener.body);
+    REQUIRE(!parser.expectsContinue());
+    REQUIRE(1 == listener.expectations);
+}
+
+TEST_CASE("http_http1_Parser.connectionSemantics")
+{
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+
+    auto const parse = [&](std::string_view message) {
+        REQUIRE(message.size() == parser.parseFragment(message));
+    };
+
+    parse("GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+    REQUIRE(parser.shouldKeepAlive());
+    REQUIRE(!parser.isUpgrade());
+    REQUIRE(9 == parser.hopByHopHeaders().size());
+
+    parse("GET / HTTP/1.1\r\nConnection: keep-alive, Close\r\n\r\n");
+    REQUIRE(!parser.shouldKeepAlive());
+
+    parse("GET / HTTP/1.0\r\n\r\n");
+    REQUIRE(!parser.shouldKeepAlive());
+
+    parse("GET / HTTP/1.0\r\nProxy-Connection: Keep-Alive\r\n\r\n");
+    REQUIRE(parser.shouldKeepAlive());
+
+    // listed headers are hop-by-hop, too
+    parse("GET / HTTP/1.1\r\nConnection: X-Trace,  Foo ,te\r\nConnection: bar\r\nX-Trace: 1\r\n\r\n");
+    REQUIRE(parser.shouldKeepAlive());
+    auto const headers = parser.hopByHopHeaders();
+    REQUIRE(std::vector<std::string_view>(headers.end() - 3, headers.end())
+            == std::vector<std::string_view> { "x-trace", "foo", "bar" });
+    REQUIRE(parser.isHopByHop("X-TRACE"));
+    REQUIRE(parser.isHopByHop("Transfer-Encoding"));
+    REQUIRE(!parser.isHopByHop("Host"));
+
+    parse("GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+    REQUIRE(!parser.isHopByHop("X-Trace"));
+
+    // responses delimited by closing the connection
+    HttpParser responses(HttpParseMode::RESPONSE, &listener);
+    auto const response = std::string_view("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+    REQUIRE(response.size() == responses.parseFragment(response));
+    REQUIRE(responses.shouldKeepAlive());
+    responses.parseFragment("HTTP/1.1 200 OK\r\n\r\nuntil the end");
+    REQUIRE(!responses.shouldKeepAlive());
+}
+
+TEST_CASE("http_http1_Parser.upgrade")
+{
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+
+    std::string_view const head = "GET /chat HTTP/1.1\r\n"
+                                  "Upgrade: websocket\r\n"
+                                  "Connection: keep-alive, Upgrade\r\n"
+                                  "\r\n";
+    std::string const input = std::string(head) + "\x81\x85" "frame";
+
+    // stops right after the head, even though a new request would be parsed otherwise
+    size_t const n = parser.parseFragment(input);
+    REQUIRE(head.size() == n);
+    REQUIRE(parser.isUpgraded());
+    REQUIRE(listener.messageEnd);
+    REQUIRE(0 == parser.parseFragment(std::string_view(input).substr(n)));
+    REQUIRE(listener.errorCode == HttpStatus::Undefined);
+
+    // upgrade declined, continue with HTTP
+    parser.reset();
+    REQUIRE(!parser.isUpgraded());
+    parser.parseFragment("GET /next HTTP/1.1\r\nUpgrade: websocket\r\n\r\n");
+    REQUIRE("/next" == listener.entity);
+    REQUIRE(!parser.isUpgraded()); // no Connection: upgrade
+}
+
+TEST_CASE("http_http1_Parser.switchingProtocols")
+{
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::RESPONSE, &listener);
+
+    std::string_view const head = "HTTP/1.1 101 Switching Protocols\r\n"
+                                  "Upgrade: websocket\r\n"
+                                  "Connection: Upgrade\r\n"
+                                  "\r\n";
+    std::string const input = std::string(head) + "\x81\x05hello";
+
+    REQUIRE(head.size() == parser.parseFragment(input));
+    REQUIRE(parser.isUpgraded());
+    REQUIRE(listener.messageEnd);
+    REQUIRE(listener.body.empty());
+}
+
+namespace
+{
+
+struct ProxyHeaderListener: public MockHttpListener
+{
+    int proxyHeaders = 0;
+    HttpProxyHeader::Family family = HttpProxyHeader::Family::UNSPEC;
+    int version = 0;
+    bool local = false;
+    std::string source;
+    std::string destination;
+    uint16_t sourcePort = 0;
+    uint16_t destinationPort = 0;
+    std::string authority;
+
+    void onProxyHeader(HttpProxyHeader const& header) override
+    {
+        ++proxyHeaders;
+        family = header.family;
+        version = header.version;
+        local = header.local;
+        source = header.sourceAddress;
+        destination = header.destinationAddress;
+        sourcePort = header.sourcePort;
+        destinationPort = header.destinationPort;
+        authority = header.tlv(HttpProxyHeader::TLV_AUTHORITY);
+    }
+};
+
+/// Parses @p input in fragments of @p fragmentSize bytes, with a PROXY protocol header expected.
+ProxyHeaderListener parseWithProxyHeader(std::string_view input, size_t fragmentSize)
+{
+    ProxyHeaderListener listener;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    parser.expectProxyHeader();
+
+    for (size_t offset = 0; offset < input.size() && parser.state() != HttpParserState::PROTOCOL_ERROR;)
+    {
+        auto fragment = std::string(input.substr(offset, fragmentSize));
+        offset += parser.parseFragment(fragment);
+        fragment.assign(fragment.size(), '#'); // the parser must not refer to it anymore
+    }
+
+    return listener;
+}
+
+std::string const proxyV2Signature("\r\n\r\n\0\r\nQUIT\n", 12);
+
+} // namespace
+
+TEST_CASE("http_http1_Parser.proxyHeaderV1")
+{
+    auto const input = std::string_view("PROXY TCP4 192.0.2.1 198.51.100.7 56324 443\r\n"
+                                        "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+    for (size_t const fragmentSize: { size_t(1), size_t(5), input.size() })
+    {
+        auto const listener = parseWithProxyHeader(input, fragmentSize);
+        REQUIRE(1 == listener.proxyHeaders);
+        REQUIRE(1 == listener.version);
+        REQUIRE(HttpProxyHeader::Family::INET == listener.family);
+        REQUIRE("192.0.2.1" == listener.source);
+        REQUIRE("198.51.100.7" == listener.destination);
+        REQUIRE(56324 == listener.sourcePort);
+        REQUIRE(443 == listener.destinationPort);
+        REQUIRE("GET" == listener.method);
+        REQUIRE(listener.messageEnd);
+        REQUIRE(listener.errorCode == HttpStatus::Undefined);
+    }
+
+    auto const unknown = parseWithProxyHeader("PROXY UNKNOWN\r\nGET / HTTP/1.1\r\n\r\n", 64);
+    REQUIRE(1 == unknown.proxyHeaders);
+    REQUIRE(HttpProxyHeader::Family::UNSPEC == unknown.family);
+    REQUIRE(unknown.messageEnd);
+}
+
+TEST_CASE("http_http1_Parser.proxyHeaderV2")
+{
+    using namespace std::string_literals;
+
+    // PROXY command, TCP over IPv6, followed by an AUTHORITY TLV
+    std::string header = proxyV2Signature + "\x21\x21";
+    std::string body;
+    body += std::string(15, '\0') + "\x01";           // ::1
+    body += "\x20\x01\x0d\xb8" + std::string(11, '\0') + "\x02"; // 2001:db8::2
+    body += "\xc3\x50\x01\xbb";                      // 50000, 443
+    body += "\x02\x00\x0b"s + "example.com";
+    header += static_cast<char>(body.size() >> 8);
+    header += static_cast<char>(body.size() & 0xFF);
+
+    auto const input = header + body + "GET / HTTP/1.1\r\n\r\n";
+    for (size_t const fragmentSize: { size_t(1), size_t(7), input.size() })
+    {
+        auto const listener = parseWithProxyHeader(input, fragmentSize);
+        REQUIRE(1 == listener.proxyHeaders);
+        REQUIRE(2 == listener.version);
+        REQUIRE(!listener.local);
+        REQUIRE(HttpProxyHeader::Family::INET6 == listener.family);
+        REQUIRE("::1" == listener.source);
+        REQUIRE("2001:db8::2" == listener.destination);
+        REQUIRE(50000 == listener.sourcePort);
+        REQUIRE(443 == listener.destinationPort);
+        REQUIRE("example.com" == listener.authority);
+        REQUIRE(listener.messageEnd);
+    }
+
+    // LOCAL command, e.g. a health check by the load balancer
+    auto const local =
+        parseWithProxyHeader(proxyV2Signature + "\x20\x00\x00\x00"s + "GET / HTTP/1.1\r\n\r\n", 64);
+    REQUIRE(1 == local.proxyHeaders);
+    REQUIRE(local.local);
+    REQUIRE(HttpProxyHeader::Family::UNSPEC == local.family);
+    REQUIRE(local.messageEnd);
+}
+
+TEST_CASE("http_http1_Parser.proxyHeader_invalid")
+{
+    using namespace std::string_literals;
+
+    auto const fails = [](std::string_view input) {
+        auto const listener = parseWithProxyHeader(input, input.size());
+        return listener.errorCode == HttpStatus::BadRequest && listener.proxyHeaders == 0 && listener.method.empty();
+    };
+
+    REQUIRE(fails("GET / HTTP/1.1\r\n\r\n"));                                      // missing
+    REQUIRE(fails("PROXY TCP4 192.0.2.1 ::1 1 2\r\nGET / HTTP/1.1\r\n\r\n"));      // family mismatch
+    REQUIRE(fails("PROXY TCP4 192.0.2.1 192.0.2.2 1 65536\r\n"));                  // port out of range
+    REQUIRE(fails("PROXY TCP4 192.0.2.1 192.0.2.2 1\r\n"));                        // missing field
+    REQUIRE(fails("PROXY " + std::string(120, 'X')));                              // too long
+    REQUIRE(fails("\r\n\r\n\0\r\nQUIT!"s));                                        // bad signature
+    REQUIRE(fails(proxyV2Signature + "\x11\x00\x00\x00"s));                        // version 1
+    REQUIRE(fails(proxyV2Signature + "\x21\x11\x00\x04"s + std::string(4, '\0'))); // truncated addresses
+    REQUIRE(fails(proxyV2Signature + "\x20\x00\x00\x02\x01\x00"s));                // truncated TLV
+}
+
+TEST_CASE("http_http1_Parser.digest")
+{
+    auto const digestOf = [](std::string_view request, size_t fragmentSize = 0) {
+        MockHttpListener listener;
+        HttpParser parser(HttpParseMode::REQUEST, &listener);
+        parser.setDigestHeaders({ "Host", "accept-encoding" });
+
+        if (fragmentSize == 0)
+            parser.parseFragment(request);
+        else
+            for (size_t offset = 0; offset < request.size(); offset += fragmentSize)
+                parser.parseFragment(std::string(request.substr(offset, fragmentSize)));
+
+        REQUIRE(listener.headerEnd);
+        return parser.digest();
+    };
+
+    auto const request = digestOf("GET /index.html HTTP/1.1\r\n"
+                                  "Host: example.com\r\n"
+                                  "Accept-Language: en-US,en;q=0.9\r\n"
+                                  "Cookie: session=1\r\n"
+                                  "Accept-Encoding: gzip\r\n"
+                                  "User-Agent: test\r\n"
+                                  "\r\n");
+    REQUIRE("ge11cn04enus_" == request.fingerprint().substr(0, 13));
+
+    // fragmentation does not matter
+    auto const fragmented = digestOf("GET /index.html HTTP/1.1\r\n"
+                                     "Host: example.com\r\n"
+                                     "Accept-Language: en-US,en;q=0.9\r\n"
+                                     "Cookie: session=1\r\n"
+                                     "Accept-Encoding: gzip\r\n"
+                                     "User-Agent: test\r\n"
+                                     "\r\n",
+                                     3);
+    REQUIRE(request.cacheKey == fragmented.cacheKey);
+    REQUIRE(request.fingerprint() == fragmented.fingerprint());
+
+    // the cache key covers the selected headers only, in any order and case
+    auto const reordered = digestOf("GET /index.html HTTP/1.1\r\n"
+                                    "accept-encoding: gzip\r\n"
+                                    "User-Agent: other\r\n"
+                                    "HOST: example.com\r\n"
+                                    "\r\n");
+    REQUIRE(request.cacheKey == reordered.cacheKey);
+    REQUIRE(request.headerOrder != reordered.headerOrder);
+    REQUIRE("ge11nn030000_" == reordered.fingerprint().substr(0, 13));
+
+    REQUIRE(request.cacheKey
+            != digestOf("GET /index.html HTTP/1.1\r\nHost: example.org\r\nAccept-Encoding: gzip\r\n\r\n").cacheKey);
+    REQUIRE(request.cacheKey
+            != digestOf("GET /other.html HTTP/1.1\r\nHost: example.com\r\nAccept-Encoding: gzip\r\n\r\n").cacheKey);
+    REQUIRE(request.cacheKey
+            != digestOf("HEAD /index.html HTTP/1.1\r\nHost: example.com\r\nAccept-Encoding: gzip\r\n\r\n").cacheKey);
+
+    // header names and their order, whatever the values
+    auto const sameOrder = digestOf("POST /form HTTP/1.0\r\n"
+                                    "host: a\r\n"
+                                    "accept-language: de\r\n"
+                                    "Accept-Encoding: br\r\n"
+                                    "user-agent: b\r\n"
+                                    "Referer: c\r\n"
+                                    "Content-Length: 0\r\n"
+                                    "\r\n");
+    REQUIRE("po10nr05de00_" == sameOrder.fingerprint().substr(0, 13));
+    REQUIRE(request.headerOrder != sameOrder.headerOrder); // Content-Length
+
+    auto const otherValues = digestOf("GET / HTTP/1.1\r\n"
+                                      "Host: example.net\r\n"
+                                      "Accept-Language: fr\r\n"
+                                      "Accept-Encoding: br\r\n"
+                                      "User-Agent: other\r\n"
+                                      "\r\n");
+    REQUIRE(request.headerOrder == otherValues.headerOrder);
+    REQUIRE(request.fingerprint().substr(13) == otherValues.fingerprint().substr(13));
+}
+
+#if defined(HTTP_MESSAGE_PARSER_STATS)
+TEST_CASE("http_http1_Parser.stats")
+{
+    MockHttpListener listener;
+    HttpParser parser(HttpParseMode::REQUEST, &listener);
+    parser.setCycleSampling(1);
+
+    std::string_view const input = "GET / HTTP/1.1\r\n"           // 16 bytes
+                                   "Transfer-Encoding: chunked\r\n" // 28 bytes
+                                   "\r\n"
+                                   "3\r\nabc\r\n"
+                                   "0\r\n\r\n";
+    size_t const n = parser.parseFragment(input.substr(0, 20));
+    parser.parseFragment(input.substr(n));
+
+    auto const& stats = parser.stats();
+    REQUIRE(2 == stats.fragments);
+    REQUIRE(2 == stats.sampledFragments);
+    REQUIRE(1 == stats.splitTokens); // "Tran" | "sfer-Encoding"
+    REQUIRE(1 == stats.messages);
+    REQUIRE(1 == stats.headers);
+    REQUIRE(1 == stats.headersPerMessage[0]);
+    REQUIRE(4 == stats.bytes[static_cast<size_t>(HttpParserStateGroup::CONTENT)]); // "abc" CR
+    REQUIRE(16 == stats.bytes[static_cast<size_t>(HttpParserStateGroup::REQUEST_LINE)]);
+
+    uint64_t total = 0;
+    for (auto const bytes: stats.bytes)
+        total += bytes;
+    REQUIRE(input.size() == total);
+
+    parser.parseFragment("GET /\x01 HTTP/1.1\r\n\r\n");
+    REQUIRE(1 == stats.errors[static_cast<size_t>(HttpParserStateGroup::REQUEST_LINE)]);
+    parser.parseFragment("GET / HTTP/1.1\r\n\r\n"); // once failed, not counted again
+    REQUIRE(1 == stats.errors[static_cast<size_t>(HttpParserStateGroup::REQUEST_LINE)]);
+
+    // detected in the same group as PROTOCOL_ERROR, on the last byte of the fragment
+    HttpParser proxied(HttpParseMode::REQUEST, &listener);
+    proxied.expectProxyHeader();
+    proxied.parseFragment("PROXY TCP4 bogus\r\n");
+    REQUIRE(1 == proxied.stats().errors[static_cast<size_t>(HttpParserStateGroup::MESSAGE)]);
+
+    // counted with sampling off, too
+    HttpParser unsampled(HttpParseMode::REQUEST, &listener);
+    unsampled.setCycleSampling(0);
+    unsampled.parseFragment(input);
+    REQUIRE(1 == unsampled.stats().fragments);
+    REQUIRE(0 == unsampled.stats().sampledFragments);
+
+    auto const text = stats.toPrometheus();
+    REQUIRE(text.find("http_parser_bytes_total{group=\"content\"} 4\n") != std::string::npos);
+    REQUIRE(text.find("http_parser_errors_total{group=\"request-line\"} 1\n") != std::string::npos);
+    REQUIRE(text.find("http_parser_headers_per_message_bucket{le=\"+Inf\"} 1\n") != std::string::npos);
+}
+#endif
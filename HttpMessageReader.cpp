@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpMessageReader.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <new>
+
+namespace
+{
+
+struct FreeFrame
+{
+    FreeFrame* next;
+};
+
+constexpr size_t SizeClassCount = HttpCoroutineFramePool::MaxPooledSize / HttpCoroutineFramePool::Granularity;
+
+/// Free lists of this thread, by size class. Frames are heap blocks rounded up to their size class, so
+/// whatever is left over when the thread terminates is returned to the heap.
+struct FreeLists
+{
+    std::array<FreeFrame*, SizeClassCount> heads {};
+
+    ~FreeLists()
+    {
+        for (auto* head: heads)
+            while (head)
+                ::operator delete(std::exchange(head, head->next));
+    }
+};
+
+thread_local FreeLists freeLists;
+
+size_t sizeClassOf(size_t size) noexcept
+{
+    return (size + HttpCoroutineFramePool::Granularity - 1) / HttpCoroutineFramePool::Granularity - 1;
+}
+
+} // namespace
+
+// {{{ HttpCoroutineFramePool
+void* HttpCoroutineFramePool::allocate(size_t size)
+{
+    if (size > MaxPooledSize)
+        return ::operator new(size);
+
+    auto const sizeClass = sizeClassOf(size);
+    if (auto* frame = freeLists.heads[sizeClass])
+    {
+        freeLists.heads[sizeClass] = frame->next;
+        return frame;
+    }
+
+    return ::operator new((sizeClass + 1) * Granularity);
+}
+
+void HttpCoroutineFramePool::deallocate(void* frame, size_t size) noexcept
+{
+    if (size > MaxPooledSize)
+    {
+        ::operator delete(frame);
+        return;
+    }
+
+    auto const sizeClass = sizeClassOf(size);
+    freeLists.heads[sizeClass] = new (frame) FreeFrame { freeLists.heads[sizeClass] };
+}
+// }}}
+
+// {{{ HttpMessageReader
+size_t HttpMessageReader::feed(std::string_view bytes) noexcept
+{
+    auto const size = bytes.size();
+    while (!bytes.empty() && !_finished && !_parser.isUpgraded())
+        bytes.remove_prefix(_parser.parseFragment(bytes));
+    return size - bytes.size();
+}
+
+void HttpMessageReader::finish() noexcept
+{
+    settleAll();
+}
+
+bool HttpMessageReader::settled(Awaiting what) noexcept
+{
+    // The awaited event may be known to never come, without parsing any further.
+    switch (what)
+    {
+        case Awaiting::Request:
+            if (_finished)
+                _requestLine.reset();
+            return _finished;
+        case Awaiting::Header:
+            if (_inMessage && !_inBody)
+                return false;
+            _header.reset();
+            return true;
+        case Awaiting::BodyChunk:
+        case Awaiting::BodyInto:
+            if (_inMessage)
+                return false;
+            _bodyChunk = {};
+            _bodyCopied = 0;
+            return true;
+        case Awaiting::Nothing: break;
+    }
+    return true;
+}
+
+void HttpMessageReader::suspend(Awaiting what, std::coroutine_handle<> handle) noexcept
+{
+    _awaiting = what;
+    _handler = handle;
+}
+
+void HttpMessageReader::deliver(Awaiting what) noexcept
+{
+    if (_awaiting != what || what == Awaiting::Nothing)
+        return;
+
+    // Resume the handler right here, while the parser's views are still valid. It returns control as
+    // soon as it awaits the next event (or terminates).
+    _awaiting = Awaiting::Nothing;
+    std::exchange(_handler, {}).resume();
+}
+
+void HttpMessageReader::settleAll() noexcept
+{
+    _finished = true;
+    _inMessage = false;
+    _inBody = false;
+    _requestLine.reset();
+    _header.reset();
+    _bodyChunk = {};
+    _bodyCopied = 0;
+    deliver(_awaiting);
+}
+
+void HttpMessageReader::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version)
+{
+    _inMessage = true;
+    _inBody = false;
+    _requestLine = HttpRequestLine { method, entity, version };
+    deliver(Awaiting::Request);
+}
+
+void HttpMessageReader::onMessageHeader(std::string_view name, std::string_view value)
+{
+    _header = HttpHeaderField { name, value };
+    deliver(Awaiting::Header);
+}
+
+void HttpMessageReader::onMessageHeaderEnd()
+{
+    _inBody = true;
+    _header.reset();
+    deliver(Awaiting::Header);
+}
+
+void HttpMessageReader::onMessageContent(std::string_view chunk)
+{
+    while (!chunk.empty())
+    {
+        if (_awaiting == Awaiting::BodyChunk)
+        {
+            _bodyChunk = chunk;
+            chunk = {};
+            deliver(Awaiting::BodyChunk);
+        }
+        else if (_awaiting == Awaiting::BodyInto && !_bodyBuffer.empty())
+        {
+            _bodyCopied = std::min(chunk.size(), _bodyBuffer.size());
+            std::memcpy(_bodyBuffer.data(), chunk.data(), _bodyCopied);
+            chunk.remove_prefix(_bodyCopied);
+            deliver(Awaiting::BodyInto);
+        }
+        else
+        {
+            // nobody is interested in (the rest of) this chunk
+            break;
+        }
+    }
+}
+
+void HttpMessageReader::onMessageEnd()
+{
+    _inMessage = false;
+    _inBody = false;
+    _header.reset();
+    _bodyChunk = {};
+    _bodyCopied = 0;
+
+    if (_awaiting != Awaiting::Request)
+        deliver(_awaiting);
+}
+
+void HttpMessageReader::onProtocolError()
+{
+    settleAll();
+}
+// }}}
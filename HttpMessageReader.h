@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "HttpMessageParser.h"
+
+/// Thread-local pool of coroutine frames, recycling freed frames by size class.
+///
+/// Frames of up to MaxPooledSize bytes are never returned to the heap, so a handler coroutine started
+/// per message costs no allocation once the pool is warmed up.
+class HttpCoroutineFramePool
+{
+  public:
+    static constexpr size_t Granularity = 256;
+    static constexpr size_t MaxPooledSize = 8192;
+
+    static void* allocate(size_t size);
+    static void deallocate(void* frame, size_t size) noexcept;
+};
+
+/// Coroutine type for handlers driven by an HttpMessageReader.
+///
+/// Handlers start right away and run until their first co_await on the reader. Their frames are
+/// allocated from the HttpCoroutineFramePool. A task suspended on a reader must not be destroyed before
+/// that reader has seen its last input.
+class HttpTask
+{
+  public:
+    struct promise_type
+    {
+        std::exception_ptr exception;
+
+        HttpTask get_return_object() noexcept
+        {
+            return HttpTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+        static void* operator new(size_t size) { return HttpCoroutineFramePool::allocate(size); }
+        static void operator delete(void* frame, size_t size) noexcept
+        {
+            HttpCoroutineFramePool::deallocate(frame, size);
+        }
+    };
+
+    HttpTask() noexcept = default;
+    HttpTask(HttpTask&& other) noexcept: _handle(std::exchange(other._handle, {})) {}
+    HttpTask& operator=(HttpTask&& other) noexcept
+    {
+        HttpTask(std::move(other)).swap(*this);
+        return *this;
+    }
+    ~HttpTask()
+    {
+        if (_handle)
+            _handle.destroy();
+    }
+
+    void swap(HttpTask& other) noexcept { std::swap(_handle, other._handle); }
+
+    /// Whether or not the handler has run to completion.
+    bool done() const noexcept { return !_handle || _handle.done(); }
+
+    /// Rethrows the exception the handler has terminated with, if any.
+    void rethrow() const
+    {
+        if (_handle && _handle.promise().exception)
+            std::rethrow_exception(_handle.promise().exception);
+    }
+
+  private:
+    explicit HttpTask(std::coroutine_handle<promise_type> handle) noexcept: _handle(handle) {}
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+struct HttpRequestLine
+{
+    std::string_view method;
+    std::string_view entity;
+    HttpVersion version = HttpVersion::UNKNOWN;
+};
+
+struct HttpHeaderField
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+/// Pull-style, awaitable API on top of HttpParser for writing request handlers linearly.
+///
+/// The reader is the parser's listener. Whenever the parser delivers the event a handler awaits, the
+/// handler is resumed inline, right from within parseFragment(), and runs until it awaits the next event.
+/// Hence all string views handed out point into the fragment being parsed and are only valid until the
+/// handler's next co_await on the reader. Events nobody awaits are skipped (e.g. the remaining headers
+/// once a handler awaits the body).
+///
+/// @code
+/// HttpTask handle(HttpMessageReader& reader)
+/// {
+///     while (auto const request = co_await reader.nextRequest())
+///     {
+///         while (auto const header = co_await reader.nextHeader())
+///             inspect(header->name, header->value);
+///         for (auto chunk = co_await reader.nextBodyChunk(); !chunk.empty(); chunk = co_await reader.nextBodyChunk())
+///             consume(chunk);
+///     }
+/// }
+///
+/// HttpMessageReader reader;
+/// auto task = handle(reader);
+/// reader.feed(bytes); // as bytes arrive
+/// reader.finish();    // on EOF
+/// @endcode
+class HttpMessageReader final: private HttpListener
+{
+    enum class Awaiting
+    {
+        Nothing,
+        Request,
+        Header,
+        BodyChunk,
+        BodyInto,
+    };
+
+  public:
+    HttpMessageReader() noexcept: _parser(HttpParseMode::REQUEST, this) {}
+    HttpMessageReader(HttpMessageReader const&) = delete;
+    HttpMessageReader& operator=(HttpMessageReader const&) = delete;
+
+    /// Parses @p bytes, resuming the awaiting handler inline as events arrive.
+    ///
+    /// @return number of bytes consumed, less than @p bytes.size() only on protocol errors, or if a
+    ///         request has switched protocols (see HttpParser::isUpgraded()).
+    size_t feed(std::string_view bytes) noexcept;
+
+    /// Signals end of input, completing any pending await with its end value.
+    void finish() noexcept;
+
+    /// Reads from @p source into @p buffer and feeds it, until the source is exhausted or @p task is done.
+    ///
+    /// @param source callable with the signature size_t(std::span<char>) returning 0 on end of input.
+    template <typename Source>
+    void run(HttpTask const& task, Source&& source, std::span<char> buffer)
+    {
+        while (!task.done() && !_finished && !_parser.isUpgraded())
+        {
+            auto const n = source(buffer);
+            if (n == 0)
+                break;
+            feed(std::string_view(buffer.data(), n));
+        }
+        finish();
+    }
+
+    bool failed() const noexcept { return _parser.state() == HttpParserState::PROTOCOL_ERROR; }
+
+    HttpParser const& parser() const noexcept { return _parser; }
+
+    // {{{ awaitables
+    template <Awaiting What, typename Result>
+    struct Awaiter
+    {
+        HttpMessageReader& reader;
+
+        bool await_ready() noexcept { return reader.settled(What); }
+        void await_suspend(std::coroutine_handle<> handle) noexcept { reader.suspend(What, handle); }
+        Result await_resume() const noexcept
+        {
+            if constexpr (What == Awaiting::Request)
+                return reader._requestLine;
+            else if constexpr (What == Awaiting::Header)
+                return reader._header;
+            else if constexpr (What == Awaiting::BodyChunk)
+                return reader._bodyChunk;
+            else
+                return reader._bodyCopied;
+        }
+    };
+
+    /// Awaits the next request-line, or std::nullopt once the input is exhausted or broken.
+    auto nextRequest() noexcept
+    {
+        return Awaiter<Awaiting::Request, std::optional<HttpRequestLine>> { *this };
+    }
+
+    /// Awaits the next header of the current request, or std::nullopt past the last one.
+    auto nextHeader() noexcept { return Awaiter<Awaiting::Header, std::optional<HttpHeaderField>> { *this }; }
+
+    /// Awaits the next piece of body of the current request, zero-copy. Empty once the body is complete.
+    auto nextBodyChunk() noexcept { return Awaiter<Awaiting::BodyChunk, std::string_view> { *this }; }
+
+    /// Awaits the next piece of body of the current request, copied into @p buffer (which must not be empty).
+    ///
+    /// @return the number of bytes copied, 0 once the body is complete.
+    auto readBody(std::span<char> buffer) noexcept
+    {
+        _bodyBuffer = buffer;
+        return Awaiter<Awaiting::BodyInto, size_t> { *this };
+    }
+    // }}}
+
+  private:
+    bool settled(Awaiting what) noexcept;
+    void suspend(Awaiting what, std::coroutine_handle<> handle) noexcept;
+    void deliver(Awaiting what) noexcept;
+    void settleAll() noexcept;
+
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+    HttpParser _parser;
+
+    Awaiting _awaiting = Awaiting::Nothing;
+    std::coroutine_handle<> _handler;
+
+    // what is being delivered
+    bool _inMessage = false;   //!< a request-line has been delivered and its message has not ended yet
+    bool _inBody = false;      //!< all headers of the current message have been delivered
+    bool _finished = false;    //!< end of input, or protocol error
+    std::optional<HttpRequestLine> _requestLine;
+    std::optional<HttpHeaderField> _header;
+    std::string_view _bodyChunk;
+    std::span<char> _bodyBuffer;
+    size_t _bodyCopied = 0;
+};
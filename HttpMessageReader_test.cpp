@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "HttpMessageReader.h"
+
+namespace
+{
+
+struct Seen
+{
+    std::vector<std::string> events;
+};
+
+HttpTask collectAll(HttpMessageReader& reader, Seen& seen)
+{
+    while (auto const request = co_await reader.nextRequest())
+    {
+        seen.events.emplace_back(std::string(request->method) + " " + std::string(request->entity));
+        while (auto const header = co_await reader.nextHeader())
+            seen.events.emplace_back(std::string(header->name) + ": " + std::string(header->value));
+
+        std::string body;
+        char buffer[3];
+        while (auto const n = co_await reader.readBody(buffer))
+            body.append(buffer, n);
+        seen.events.emplace_back("body=" + body);
+    }
+    seen.events.emplace_back("eof");
+}
+
+HttpTask skipToBody(HttpMessageReader& reader, Seen& seen)
+{
+    while (co_await reader.nextRequest())
+    {
+        // headers are skipped, body chunks handed out as-is
+        for (auto chunk = co_await reader.nextBodyChunk(); !chunk.empty(); chunk = co_await reader.nextBodyChunk())
+            seen.events.emplace_back(std::string(chunk));
+        seen.events.emplace_back("end");
+    }
+}
+
+} // namespace
+
+TEST_CASE("HttpMessageReader.pipelined")
+{
+    HttpMessageReader reader;
+    Seen seen;
+    auto const task = collectAll(reader, seen);
+    REQUIRE(seen.events.empty());
+
+    std::string const input = "GET /foo HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "\r\n"
+                              "POST /bar HTTP/1.1\r\n"
+                              "Transfer-Encoding: chunked\r\n"
+                              "\r\n"
+                              "4\r\nabcd\r\n3\r\nefg\r\n0\r\n\r\n";
+
+    // byte by byte, so that every token straddles fragments
+    for (char const c: input)
+        REQUIRE(1 == reader.feed(std::string_view(&c, 1)));
+    REQUIRE(!task.done());
+
+    reader.finish();
+    REQUIRE(task.done());
+    task.rethrow();
+
+    std::vector<std::string> const expected = {
+        // Transfer-Encoding: chunked is consumed by the parser itself
+        "GET /foo", "Host: localhost", "body=", "POST /bar", "body=abcdefg", "eof",
+    };
+    REQUIRE(expected == seen.events);
+}
+
+TEST_CASE("HttpMessageReader.zeroCopyBody")
+{
+    HttpMessageReader reader;
+    Seen seen;
+    auto const task = skipToBody(reader, seen);
+
+    std::string const input = "PUT / HTTP/1.1\r\n"
+                              "Content-Length: 6\r\n"
+                              "\r\n"
+                              "abcdef"
+                              "PUT / HTTP/1.1\r\n"
+                              "Content-Length: 0\r\n"
+                              "\r\n";
+    REQUIRE(input.size() == reader.feed(input));
+
+    std::vector<std::string> const expected = { "abcdef", "end", "end" };
+    REQUIRE(expected == seen.events);
+    REQUIRE(!task.done());
+    reader.finish();
+    REQUIRE(task.done());
+}
+
+TEST_CASE("HttpMessageReader.protocolError")
+{
+    HttpMessageReader reader;
+    Seen seen;
+    auto const task = collectAll(reader, seen);
+
+    std::string const input = "GET / HTTP/1.1\r\nBad Header\r\n\r\n";
+    auto const chunks = std::vector<std::string_view> { std::string_view(input).substr(0, 10),
+                                                        std::string_view(input).substr(10) };
+    size_t next = 0;
+    char buffer[64];
+    reader.run(
+        task,
+        [&](std::span<char> target) -> size_t {
+            if (next == chunks.size())
+                return 0;
+            auto const chunk = chunks[next++];
+            std::copy(chunk.begin(), chunk.end(), target.begin());
+            return chunk.size();
+        },
+        buffer);
+
+    REQUIRE(reader.failed());
+    REQUIRE(task.done());
+    std::vector<std::string> const expected = { "GET /", "body=", "eof" };
+    REQUIRE(expected == seen.events);
+}
+
+TEST_CASE("HttpCoroutineFramePool.recycles")
+{
+    auto* const first = HttpCoroutineFramePool::allocate(300);
+    HttpCoroutineFramePool::deallocate(first, 300);
+
+    // same size class
+    auto* const second = HttpCoroutineFramePool::allocate(500);
+    REQUIRE(first == second);
+    HttpCoroutineFramePool::deallocate(second, 500);
+
+    auto* const large = HttpCoroutineFramePool::allocate(HttpCoroutineFramePool::MaxPooledSize + 1);
+    HttpCoroutineFramePool::deallocate(large, HttpCoroutineFramePool::MaxPooledSize + 1);
+}
@@ -0,0 +1,576 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpResponseCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "HttpAscii.h"
+#include "ParsedRequest.h"
+
+namespace
+{
+
+std::string_view trim(std::string_view value) noexcept
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        value.remove_suffix(1);
+    return value;
+}
+
+/// Invokes @p f with every trimmed, non-empty element of the comma separated @p list.
+template <typename F>
+void forEachElement(std::string_view list, F&& f)
+{
+    while (!list.empty())
+    {
+        auto const comma = list.find(',');
+        if (auto const item = trim(list.substr(0, comma)); !item.empty())
+            f(item);
+        if (comma == std::string_view::npos)
+            break;
+        list.remove_prefix(comma + 1);
+    }
+}
+
+/// delta-seconds (RFC 9111, 1.2.2), -1 if invalid.
+int64_t parseSeconds(std::string_view value) noexcept
+{
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+        value = value.substr(1, value.size() - 2);
+    if (value.empty())
+        return -1;
+
+    int64_t result = 0;
+    for (auto const c: value)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(c)))
+            return -1;
+        result = std::min<int64_t>(result * 10 + (c - '0'), int64_t(1) << 31);
+    }
+    return result;
+}
+
+/// Days since 1970-01-01 of a proleptic Gregorian date.
+constexpr int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) noexcept
+{
+    year -= month <= 2;
+    auto const era = (year >= 0 ? year : year - 399) / 400;
+    auto const yearOfEra = static_cast<unsigned>(year - era * 400);
+    auto const dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    auto const dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+/// IMF-fixdate (e.g. "Sun, 06 Nov 1994 08:49:37 GMT") as seconds since the epoch, -1 if invalid.
+///
+/// The obsolete RFC 850 and asctime() formats are not accepted, which makes such an Expires header
+/// count as "already expired", as it should for invalid dates.
+int64_t parseHttpDate(std::string_view value) noexcept
+{
+    static constexpr std::string_view months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    if (value.size() != 29 || value[3] != ',' || value.substr(25) != " GMT")
+        return -1;
+
+    auto const number = [&](size_t offset, size_t length) -> int {
+        int result = 0;
+        for (auto const c: value.substr(offset, length))
+        {
+            if (!std::isdigit(static_cast<unsigned char>(c)))
+                return -1;
+            result = result * 10 + (c - '0');
+        }
+        return result;
+    };
+
+    auto const day = number(5, 2);
+    auto const monthIndex = months.find(value.substr(8, 3));
+    auto const year = number(12, 4);
+    auto const hour = number(17, 2);
+    auto const minute = number(20, 2);
+    auto const second = number(23, 2);
+    if (day < 1 || day > 31 || monthIndex == std::string_view::npos || monthIndex % 3 || year < 0 || hour < 0
+        || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60)
+        return -1;
+
+    auto const days = daysFromCivil(year, static_cast<unsigned>(monthIndex / 3 + 1), static_cast<unsigned>(day));
+    return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+/// Status codes heuristically cacheable by default (RFC 9110, 15.1), the ones we store with an
+/// explicit lifetime.
+constexpr bool isCacheableStatus(int code) noexcept
+{
+    switch (code)
+    {
+        case 200:
+        case 203:
+        case 204:
+        case 300:
+        case 301:
+        case 308:
+        case 404:
+        case 405:
+        case 410:
+        case 414:
+        case 501: return true;
+        default: return false;
+    }
+}
+
+/// Hashes the request's values of the @p vary headers (a comma separated list of names).
+uint64_t varyHash(std::string_view vary, HttpResponseCache::HeaderLookup const& requestHeader)
+{
+    // FNV-1a, with a separator between values, so that moving bytes across them changes the hash
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto const add = [&](std::string_view bytes) {
+        for (auto const c: bytes)
+            hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    };
+
+    forEachElement(vary, [&](std::string_view name) {
+        add(requestHeader ? requestHeader(name) : std::string_view());
+        add(std::string_view("\0", 1));
+    });
+    return hash;
+}
+
+} // namespace
+
+// {{{ internals
+class HttpResponseCache::SlabPool
+{
+  public:
+    explicit SlabPool(size_t capacity): _capacity(capacity) {}
+
+    /// @return a segment of SegmentSize bytes, or nullptr if the budget is exhausted.
+    char* allocate()
+    {
+        std::lock_guard lock(_mutex);
+        if (_free.empty())
+        {
+            if (_allocated == _capacity)
+                return nullptr;
+
+            // slabs are allocated as needed, but never returned
+            auto const count = std::min(SegmentsPerSlab, _capacity - _allocated);
+            _slabs.push_back(std::make_unique<char[]>(count * SegmentSize));
+            for (size_t k = count; k-- > 0;)
+                _free.push_back(_slabs.back().get() + k * SegmentSize);
+            _allocated += count;
+        }
+
+        auto* const segment = _free.back();
+        _free.pop_back();
+        ++_inUse;
+        return segment;
+    }
+
+    void release(char* segment)
+    {
+        std::lock_guard lock(_mutex);
+        _free.push_back(segment);
+        --_inUse;
+    }
+
+    size_t inUse() const noexcept { return _inUse.load(std::memory_order_relaxed); }
+
+  private:
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<char[]>> _slabs;
+    std::vector<char*> _free;
+    size_t _capacity;      //!< segments
+    size_t _allocated = 0; //!< segments
+    std::atomic<size_t> _inUse = 0;
+};
+
+struct HttpResponseCache::Entry
+{
+    Entry(std::shared_ptr<SlabPool> pool, uint64_t key): pool(std::move(pool)), key(key) {}
+
+    ~Entry()
+    {
+        for (auto* segment: segments)
+            pool->release(segment);
+    }
+
+    std::shared_ptr<SlabPool> pool;
+    uint64_t key;
+    std::string vary;  //!< comma separated, lowercased names of the headers the response varies on
+    uint64_t varyHash = 0;
+    Clock::time_point expires;
+    std::vector<char*> segments;
+    std::vector<iovec> iov;
+    size_t size = 0;
+    mutable std::atomic<bool> referenced = false; //!< CLOCK reference bit
+};
+
+struct alignas(64) HttpResponseCache::Shard
+{
+    mutable std::shared_mutex mutex;
+    std::unordered_multimap<uint64_t, std::shared_ptr<Entry>> index;
+    std::vector<std::shared_ptr<Entry>> ring; //!< all entries, in CLOCK order
+    size_t hand = 0;
+};
+// }}}
+
+// {{{ Response
+std::span<iovec const> HttpResponseCache::Response::iovecs() const noexcept
+{
+    return _entry ? std::span<iovec const>(_entry->iov) : std::span<iovec const>();
+}
+
+size_t HttpResponseCache::Response::size() const noexcept
+{
+    return _entry ? _entry->size : 0;
+}
+
+HttpResponseCache::Clock::duration HttpResponseCache::Response::timeToLive(Clock::time_point now) const noexcept
+{
+    return _entry ? std::max(_entry->expires - now, Clock::duration::zero()) : Clock::duration::zero();
+}
+// }}}
+
+// {{{ HttpResponseCache
+HttpResponseCache::HttpResponseCache(size_t memoryBudget, size_t shardCount):
+    _pool(std::make_shared<SlabPool>(memoryBudget / SegmentSize)),
+    _maxEntrySize(memoryBudget / 8) // so that a single response never flushes most of the cache
+{
+    _shards.reserve(std::max<size_t>(shardCount, 1));
+    for (size_t k = 0; k < std::max<size_t>(shardCount, 1); ++k)
+        _shards.push_back(std::make_unique<Shard>());
+}
+
+HttpResponseCache::~HttpResponseCache() = default;
+
+HttpResponseCache::Shard& HttpResponseCache::shardOf(uint64_t key) const noexcept
+{
+    return *_shards[((key * 0x9e3779b97f4a7c15ull) >> 32) % _shards.size()];
+}
+
+HttpResponseCache::Response HttpResponseCache::lookup(uint64_t key,
+                                                      HeaderLookup const& requestHeader,
+                                                      Clock::time_point now)
+{
+    auto& shard = shardOf(key);
+    std::shared_lock lock(shard.mutex);
+
+    auto const [first, last] = shard.index.equal_range(key);
+    for (auto i = first; i != last; ++i)
+    {
+        auto const& entry = i->second;
+        if (entry->expires <= now)
+            continue;
+        if (!entry->vary.empty() && entry->varyHash != varyHash(entry->vary, requestHeader))
+            continue;
+
+        entry->referenced.store(true, std::memory_order_relaxed);
+        return Response(entry);
+    }
+
+    return Response();
+}
+
+HttpResponseCache::Response HttpResponseCache::lookup(uint64_t key,
+                                                      ParsedRequest const& request,
+                                                      Clock::time_point now)
+{
+    return lookup(
+        key, [&request](std::string_view name) { return request.header(name); }, now);
+}
+
+void HttpResponseCache::remove(Shard& shard, size_t ringIndex)
+{
+    auto const entry = std::move(shard.ring[ringIndex]);
+    shard.ring[ringIndex] = std::move(shard.ring.back());
+    shard.ring.pop_back();
+    if (shard.hand >= shard.ring.size())
+        shard.hand = 0;
+
+    auto const [first, last] = shard.index.equal_range(entry->key);
+    for (auto i = first; i != last; ++i)
+    {
+        if (i->second == entry)
+        {
+            shard.index.erase(i);
+            break;
+        }
+    }
+}
+
+/// Evicts the first entry the CLOCK hand finds stale or unreferenced since it last passed by.
+bool HttpResponseCache::evictOne(Shard& shard, Clock::time_point now)
+{
+    while (!shard.ring.empty())
+    {
+        auto const& entry = shard.ring[shard.hand];
+        if (entry->expires > now && entry->referenced.exchange(false, std::memory_order_relaxed))
+        {
+            shard.hand = (shard.hand + 1) % shard.ring.size();
+            continue;
+        }
+
+        // the newest entry takes the evicted one's place: move on, so that it gets a full turn too
+        remove(shard, shard.hand);
+        if (!shard.ring.empty())
+            shard.hand = (shard.hand + 1) % shard.ring.size();
+        return true;
+    }
+
+    return false;
+}
+
+char* HttpResponseCache::allocateSegment(uint64_t key, Clock::time_point now)
+{
+    // evict from the shard the response goes to first, then from the others in turn
+    auto const first = static_cast<size_t>(&shardOf(key) - _shards.front().get());
+    for (size_t k = 0; k < _shards.size();)
+    {
+        if (auto* const segment = _pool->allocate())
+            return segment;
+
+        auto& shard = *_shards[(first + k) % _shards.size()];
+        std::unique_lock lock(shard.mutex);
+        if (!evictOne(shard, now))
+            ++k;
+    }
+
+    return _pool->allocate(); // evicted responses may still be held by readers
+}
+
+void HttpResponseCache::insert(std::shared_ptr<Entry> entry)
+{
+    auto& shard = shardOf(entry->key);
+    std::unique_lock lock(shard.mutex);
+
+    // replaces the response for the same request
+    for (size_t k = 0; k < shard.ring.size();)
+    {
+        auto const& other = shard.ring[k];
+        if (other->key == entry->key && other->vary == entry->vary && other->varyHash == entry->varyHash)
+            remove(shard, k);
+        else
+            ++k;
+    }
+
+    shard.index.emplace(entry->key, entry);
+    shard.ring.push_back(std::move(entry));
+}
+
+void HttpResponseCache::erase(uint64_t key)
+{
+    auto& shard = shardOf(key);
+    std::unique_lock lock(shard.mutex);
+
+    for (size_t k = 0; k < shard.ring.size();)
+    {
+        if (shard.ring[k]->key == key)
+            remove(shard, k);
+        else
+            ++k;
+    }
+}
+
+size_t HttpResponseCache::count() const
+{
+    size_t result = 0;
+    for (auto const& shard: _shards)
+    {
+        std::shared_lock lock(shard->mutex);
+        result += shard->ring.size();
+    }
+    return result;
+}
+
+size_t HttpResponseCache::memoryUsed() const noexcept
+{
+    return _pool->inUse() * SegmentSize;
+}
+// }}}
+
+// {{{ Recorder
+HttpResponseCache::Recorder::Recorder(HttpResponseCache& cache,
+                                      uint64_t key,
+                                      HeaderLookup requestHeader,
+                                      HttpListener* next):
+    _cache(cache),
+    _requestHeader(std::move(requestHeader)),
+    _next(next),
+    _parser(HttpParseMode::RESPONSE, this),
+    _entry(std::make_shared<Entry>(cache._pool, key))
+{
+}
+
+HttpResponseCache::Recorder::~Recorder() = default;
+
+void HttpResponseCache::Recorder::abort() noexcept
+{
+    _entry.reset(); // returns its segments
+}
+
+bool HttpResponseCache::Recorder::append(std::string_view bytes)
+{
+    while (!bytes.empty())
+    {
+        auto const used = _entry->size % SegmentSize;
+        if (used == 0)
+        {
+            if (_entry->size + SegmentSize > _cache._maxEntrySize)
+                return false;
+
+            auto* const segment = _cache.allocateSegment(_entry->key, _now);
+            if (!segment)
+                return false;
+            _entry->segments.push_back(segment);
+        }
+
+        auto const n = std::min(SegmentSize - used, bytes.size());
+        std::memcpy(_entry->segments.back() + used, bytes.data(), n);
+        _entry->size += n;
+        bytes.remove_prefix(n);
+    }
+
+    return true;
+}
+
+size_t HttpResponseCache::Recorder::parseFragment(std::string_view chunk, Clock::time_point now)
+{
+    _now = now;
+    auto const n = _parser.parseFragment(chunk);
+
+    if (_entry && !append(chunk.substr(0, n)))
+        abort();
+
+    if (_entry && _complete)
+    {
+        for (size_t k = 0; k < _entry->segments.size(); ++k)
+        {
+            auto const length = std::min(SegmentSize, _entry->size - k * SegmentSize);
+            _entry->iov.push_back(iovec { _entry->segments[k], length });
+        }
+
+        _cache.insert(std::move(_entry));
+        _stored = true;
+    }
+
+    return n;
+}
+
+void HttpResponseCache::Recorder::onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text)
+{
+    _cacheable = isCacheableStatus(static_cast<int>(code));
+
+    if (_next)
+        _next->onMessageBegin(version, code, text);
+}
+
+void HttpResponseCache::Recorder::onMessageHeader(std::string_view name, std::string_view value)
+{
+    if (iequals(name, "Cache-Control"))
+    {
+        forEachElement(value, [&](std::string_view directive) {
+            auto const equals = directive.find('=');
+            auto const directiveName = trim(directive.substr(0, equals));
+            auto const argument = equals != std::string_view::npos ? trim(directive.substr(equals + 1)) : "";
+
+            if (iequals(directiveName, "no-store") || iequals(directiveName, "no-cache")
+                || iequals(directiveName, "private"))
+                _cacheable = false;
+            else if (iequals(directiveName, "s-maxage"))
+            {
+                _maxAge = parseSeconds(argument); // takes precedence in a shared cache
+                _sharedWithAuthorization = true;
+            }
+            else if (iequals(directiveName, "public") || iequals(directiveName, "must-revalidate"))
+                _sharedWithAuthorization = true;
+            else if (iequals(directiveName, "max-age") && _maxAge < 0)
+                _maxAge = parseSeconds(argument);
+        });
+    }
+    else if (iequals(name, "Expires"))
+        _expires = std::max<int64_t>(parseHttpDate(trim(value)), 0);
+    else if (iequals(name, "Date"))
+        _date = parseHttpDate(trim(value));
+    else if (iequals(name, "Age"))
+        _age = std::max<int64_t>(parseSeconds(trim(value)), 0);
+    else if (iequals(name, "Vary"))
+    {
+        forEachElement(value, [&](std::string_view header) {
+            if (header == "*")
+                _cacheable = false;
+
+            if (!_vary.empty())
+                _vary += ',';
+            std::transform(header.begin(), header.end(), std::back_inserter(_vary), toLowerAscii);
+        });
+    }
+
+    if (_next)
+        _next->onMessageHeader(name, value);
+}
+
+void HttpResponseCache::Recorder::onMessageHeaderEnd()
+{
+    // freshness lifetime (RFC 9111, 4.2.1), without heuristics
+    int64_t lifetime = -1;
+    if (_maxAge >= 0)
+        lifetime = _maxAge;
+    else if (_expires > 0)
+    {
+        auto const date = _date >= 0 ? _date
+                                     : static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                                                std::chrono::system_clock::now().time_since_epoch())
+                                                                .count());
+        lifetime = _expires - date;
+    }
+    else if (_expires == 0)
+        lifetime = 0; // invalid Expires: already expired
+
+    if (_entry && (!_cacheable || lifetime - _age <= 0))
+        abort();
+
+    // responses to authorized requests are not for other users (RFC 9111, 3.5)
+    if (_entry && !_sharedWithAuthorization && _requestHeader && !_requestHeader("authorization").empty())
+        abort();
+
+    if (_entry)
+    {
+        _entry->expires = _now + std::chrono::seconds(lifetime - _age);
+        _entry->vary = _vary;
+        if (!_vary.empty())
+            _entry->varyHash = varyHash(_vary, _requestHeader);
+    }
+
+    if (_next)
+        _next->onMessageHeaderEnd();
+}
+
+void HttpResponseCache::Recorder::onMessageContent(std::string_view chunk)
+{
+    if (_next)
+        _next->onMessageContent(chunk);
+}
+
+void HttpResponseCache::Recorder::onMessageEnd()
+{
+    _complete = true;
+
+    if (_next)
+        _next->onMessageEnd();
+}
+
+void HttpResponseCache::Recorder::onProtocolError()
+{
+    abort();
+
+    if (_next)
+        _next->onProtocolError();
+}
+// }}}
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <sys/uio.h> // iovec
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HttpMessageParser.h"
+
+struct ParsedRequest;
+
+/// In-memory shared cache of upstream responses, stored and served as the bytes received.
+///
+/// Responses are recorded while being parsed (see Recorder) into fixed-size segments carved out of
+/// slabs, within a memory budget. Hits are served as iovecs over those segments, with no
+/// re-serialization. Entries are keyed by a request hash (e.g. HttpRequestDigest::cacheKey) plus the
+/// request's values of the headers the response Varies on, and spread over shards: lookups of a shard
+/// share its lock and only flip an atomic reference bit, which CLOCK eviction consults.
+class HttpResponseCache
+{
+    struct Entry;
+
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Returns the value of the request header named @p name (case insensitive), empty if absent.
+    using HeaderLookup = std::function<std::string_view(std::string_view name)>;
+
+    static constexpr size_t SegmentSize = 16 * 1024;
+    static constexpr size_t SegmentsPerSlab = 64;
+
+    class Recorder;
+
+    /// A cache hit, keeping the stored bytes alive (even beyond eviction) for as long as it is held.
+    class Response
+    {
+      public:
+        Response() noexcept = default;
+
+        explicit operator bool() const noexcept { return _entry != nullptr; }
+
+        /// The complete response as received (head and body), for writev() or sendmsg().
+        std::span<iovec const> iovecs() const noexcept;
+
+        /// Total number of bytes.
+        size_t size() const noexcept;
+
+        /// Time left until the response turns stale.
+        Clock::duration timeToLive(Clock::time_point now = Clock::now()) const noexcept;
+
+      private:
+        friend class HttpResponseCache;
+
+        explicit Response(std::shared_ptr<Entry const> entry) noexcept: _entry(std::move(entry)) {}
+
+        std::shared_ptr<Entry const> _entry;
+    };
+
+    /// @param memoryBudget bytes available for storing responses, in segments of SegmentSize
+    /// @param shardCount   number of independently locked shards
+    explicit HttpResponseCache(size_t memoryBudget, size_t shardCount = 16);
+    ~HttpResponseCache();
+
+    HttpResponseCache(HttpResponseCache const&) = delete;
+    HttpResponseCache& operator=(HttpResponseCache const&) = delete;
+
+    /// @return a fresh response stored for @p key, whose Vary headers match @p requestHeader's values.
+    Response lookup(uint64_t key, HeaderLookup const& requestHeader, Clock::time_point now = Clock::now());
+    Response lookup(uint64_t key, ParsedRequest const& request, Clock::time_point now = Clock::now());
+
+    /// Drops all responses stored for @p key, e.g. after an unsafe request to the same target.
+    void erase(uint64_t key);
+
+    /// Number of responses stored.
+    size_t count() const;
+
+    /// Bytes taken by segments in use, including those of evicted responses still being served.
+    size_t memoryUsed() const noexcept;
+
+  private:
+    struct Shard;
+    class SlabPool;
+
+    Shard& shardOf(uint64_t key) const noexcept;
+    char* allocateSegment(uint64_t key, Clock::time_point now);
+    void insert(std::shared_ptr<Entry> entry);
+    static bool evictOne(Shard& shard, Clock::time_point now);
+    static void remove(Shard& shard, size_t ringIndex);
+
+    std::shared_ptr<SlabPool> _pool; //!< shared with the entries, so responses may outlive the cache
+    std::vector<std::unique_ptr<Shard>> _shards;
+    size_t _maxEntrySize;
+};
+
+/// Parses an upstream response (in HttpParseMode::RESPONSE) while storing its bytes into the cache.
+///
+/// Events are passed on to an optional next listener, so the recorder can sit right in the proxy path.
+/// The response is stored once complete, provided that it is cacheable: a cacheable status code, an
+/// explicit freshness lifetime (s-maxage, max-age or Expires), and neither no-store, no-cache, private
+/// nor "Vary: *". Responses to requests with Authorization are stored only if marked public, s-maxage or
+/// must-revalidate. Otherwise, or if the memory budget does not allow for it, recording stops silently.
+class HttpResponseCache::Recorder: private HttpListener
+{
+  public:
+    /// @param cache         the cache to store into
+    /// @param key           the request's hash, e.g. HttpRequestDigest::cacheKey
+    /// @param requestHeader the request's headers, consulted for Vary once the response head is parsed
+    /// @param next          receives all events of the response
+    Recorder(HttpResponseCache& cache, uint64_t key, HeaderLookup requestHeader, HttpListener* next = nullptr);
+    ~Recorder() override;
+
+    /// Processes a fragment of the response, see HttpParser::parseFragment().
+    size_t parseFragment(std::string_view chunk, Clock::time_point now = Clock::now());
+
+    /// Whether or not the response has been stored into the cache.
+    bool stored() const noexcept { return _stored; }
+
+    HttpParser const& parser() const noexcept { return _parser; }
+
+  private:
+    void onMessageBegin(HttpVersion version, HttpStatus code, std::string_view text) override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+    bool append(std::string_view bytes);
+    void abort() noexcept;
+
+    HttpResponseCache& _cache;
+    HeaderLookup _requestHeader;
+    HttpListener* _next;
+    HttpParser _parser;
+    std::shared_ptr<Entry> _entry; //!< response being recorded, null once recording stopped
+    Clock::time_point _now;
+    bool _complete = false;
+    bool _stored = false;
+
+    // freshness information of the response head
+    bool _cacheable = false;
+    int64_t _maxAge = -1;  //!< s-maxage, else max-age, in seconds
+    int64_t _expires = -1; //!< Expires as seconds since the epoch, 0 if invalid
+    int64_t _date = -1;    //!< Date as seconds since the epoch
+    int64_t _age = 0;
+    std::string _vary;     //!< comma separated, lowercased names
+
+    bool _sharedWithAuthorization = false; //!< public, s-maxage or must-revalidate (RFC 9111, 3.5)
+};
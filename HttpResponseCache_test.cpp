@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+
+#include "HttpResponseCache.h"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+auto const t0 = HttpResponseCache::Clock::time_point() + 1000h;
+
+HttpResponseCache::HeaderLookup const noHeaders;
+
+std::string response(std::string_view headers, std::string_view body = "hello")
+{
+    return "HTTP/1.1 200 OK\r\n" + std::string(headers) + "Content-Length: " + std::to_string(body.size())
+           + "\r\n\r\n" + std::string(body);
+}
+
+/// Records @p input in fragments of @p fragmentSize bytes, returning whether it has been stored.
+bool record(HttpResponseCache& cache,
+            uint64_t key,
+            std::string_view input,
+            HttpResponseCache::HeaderLookup requestHeader = {},
+            size_t fragmentSize = 1000,
+            HttpListener* next = nullptr)
+{
+    HttpResponseCache::Recorder recorder(cache, key, std::move(requestHeader), next);
+    for (size_t offset = 0; offset < input.size();)
+    {
+        auto const n = recorder.parseFragment(std::string(input.substr(offset, fragmentSize)), t0);
+        if (n == 0)
+            break;
+        offset += n;
+    }
+    return recorder.stored();
+}
+
+std::string bytesOf(HttpResponseCache::Response const& hit)
+{
+    std::string result;
+    for (auto const& iov: hit.iovecs())
+        result.append(static_cast<char const*>(iov.iov_base), iov.iov_len);
+    return result;
+}
+
+std::string pattern(size_t size)
+{
+    std::string result(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        result[i] = static_cast<char>('a' + i % 26);
+    return result;
+}
+
+HttpResponseCache::HeaderLookup acceptEncoding(std::string value)
+{
+    return [value = std::move(value)](std::string_view name) {
+        return name == "accept-encoding" ? std::string_view(value) : std::string_view();
+    };
+}
+
+} // namespace
+
+TEST_CASE("HttpResponseCache.storeAndServe")
+{
+    HttpResponseCache cache(1024 * 1024);
+
+    struct: HttpListener
+    {
+        int headers = 0;
+        std::string body;
+        bool end = false;
+        void onMessageHeader(std::string_view, std::string_view) override { ++headers; }
+        void onMessageContent(std::string_view chunk) override { body += chunk; }
+        void onMessageEnd() override { end = true; }
+    } next;
+
+    auto const input = response("Cache-Control: public, max-age=60\r\n", pattern(40000)); // three segments
+    REQUIRE(record(cache, 1, input, {}, 777, &next));
+    REQUIRE(next.end);
+    REQUIRE(pattern(40000) == next.body);
+    REQUIRE(2 == next.headers);
+
+    auto const hit = cache.lookup(1, noHeaders, t0 + 10s);
+    REQUIRE(hit);
+    REQUIRE(3 == hit.iovecs().size());
+    REQUIRE(input.size() == hit.size());
+    REQUIRE(input == bytesOf(hit));
+    REQUIRE(50s == hit.timeToLive(t0 + 10s));
+
+    REQUIRE(!cache.lookup(2, noHeaders, t0));       // other key
+    REQUIRE(!cache.lookup(1, noHeaders, t0 + 60s)); // stale
+
+    // a newer response replaces the stored one
+    REQUIRE(record(cache, 1, response("Cache-Control: max-age=60\r\n", "newer")));
+    REQUIRE(1 == cache.count());
+    REQUIRE(bytesOf(cache.lookup(1, noHeaders, t0)).ends_with("newer"));
+}
+
+TEST_CASE("HttpResponseCache.freshness")
+{
+    HttpResponseCache cache(1024 * 1024);
+
+    REQUIRE(!record(cache, 1, response("Cache-Control: no-store, max-age=60\r\n")));
+    REQUIRE(!record(cache, 1, response("Cache-Control: private, max-age=60\r\n")));
+    REQUIRE(!record(cache, 1, response("Cache-Control: no-cache\r\n")));
+    REQUIRE(!record(cache, 1, response("Last-Modified: Sun, 06 Nov 1994 08:49:37 GMT\r\n"))); // no heuristics
+    REQUIRE(!record(cache, 1, response("Cache-Control: max-age=60\r\nVary: *\r\n")));
+    REQUIRE(!record(cache, 1, "HTTP/1.1 500 Oops\r\nCache-Control: max-age=60\r\nContent-Length: 0\r\n\r\n"));
+    REQUIRE(!record(cache, 1, response("Expires: 0\r\n")));
+    REQUIRE(!record(cache, 1, response("Cache-Control: max-age=60\r\nAge: 60\r\n")));
+    REQUIRE(!record(cache, 1, response("Cache-Control: max-age=6\xB2\r\n"))); // superscript two, a negative char
+    REQUIRE(0 == cache.count());
+    REQUIRE(0 == cache.memoryUsed());
+
+    // Expires relative to Date, minus Age; s-maxage over max-age
+    REQUIRE(record(cache,
+                   1,
+                   response("Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+                            "Expires: Sun, 06 Nov 1994 08:50:37 GMT\r\n"
+                            "Age: 10\r\n")));
+    REQUIRE(50s == cache.lookup(1, noHeaders, t0).timeToLive(t0));
+
+    REQUIRE(record(cache, 2, response("Cache-Control: max-age=10, s-maxage=100\r\n")));
+    REQUIRE(100s == cache.lookup(2, noHeaders, t0).timeToLive(t0));
+}
+
+TEST_CASE("HttpResponseCache.vary")
+{
+    HttpResponseCache cache(1024 * 1024);
+
+    REQUIRE(record(cache,
+                   1,
+                   response("Cache-Control: max-age=60\r\nVary: Accept-Encoding\r\n", "gzipped"),
+                   acceptEncoding("gzip")));
+    REQUIRE(record(cache,
+                   1,
+                   response("Cache-Control: max-age=60\r\nVary: Accept-Encoding\r\n", "plain"),
+                   acceptEncoding("identity")));
+    REQUIRE(2 == cache.count());
+
+    REQUIRE(bytesOf(cache.lookup(1, acceptEncoding("gzip"), t0)).ends_with("gzipped"));
+    REQUIRE(bytesOf(cache.lookup(1, acceptEncoding("identity"), t0)).ends_with("plain"));
+    REQUIRE(!cache.lookup(1, acceptEncoding("br"), t0));
+    REQUIRE(!cache.lookup(1, noHeaders, t0));
+
+    cache.erase(1);
+    REQUIRE(0 == cache.count());
+}
+
+TEST_CASE("HttpResponseCache.authorization")
+{
+    HttpResponseCache cache(1024 * 1024);
+
+    auto const authorized = [](std::string_view name) {
+        return name == "authorization" ? std::string_view("Bearer secret") : std::string_view();
+    };
+
+    REQUIRE(!record(cache, 1, response("Cache-Control: max-age=60\r\n"), authorized));
+    REQUIRE(0 == cache.count());
+
+    REQUIRE(record(cache, 1, response("Cache-Control: public, max-age=60\r\n"), authorized));
+    REQUIRE(record(cache, 2, response("Cache-Control: s-maxage=60\r\n"), authorized));
+    REQUIRE(record(cache, 3, response("Cache-Control: max-age=60, must-revalidate\r\n"), authorized));
+    REQUIRE(3 == cache.count());
+}
+
+TEST_CASE("HttpResponseCache.eviction")
+{
+    // 8 segments, responses of one segment each, all in one shard
+    HttpResponseCache cache(8 * HttpResponseCache::SegmentSize, 1);
+    auto const body = pattern(HttpResponseCache::SegmentSize / 2);
+
+    REQUIRE(record(cache, 0, response("Cache-Control: max-age=60\r\n", body)));
+    auto held = cache.lookup(0, noHeaders, t0);
+
+    for (uint64_t key = 1; key <= 32; ++key)
+    {
+        REQUIRE(record(cache, key, response("Cache-Control: max-age=60\r\n", body)));
+        REQUIRE(cache.memoryUsed() <= 8 * HttpResponseCache::SegmentSize);
+
+        // key 1 stays hot, so CLOCK keeps it
+        if (key > 1)
+            REQUIRE(cache.lookup(1, noHeaders, t0));
+    }
+
+    REQUIRE(7 == cache.count()); // the held response's segment is not available
+    REQUIRE(cache.lookup(32, noHeaders, t0));
+
+    // an evicted response still being served keeps its bytes
+    REQUIRE(!cache.lookup(0, noHeaders, t0));
+    REQUIRE(bytesOf(held).ends_with(body));
+
+    // responses larger than an eighth of the budget are not stored
+    auto const large = pattern(2 * HttpResponseCache::SegmentSize);
+    REQUIRE(!record(cache, 99, response("Cache-Control: max-age=60\r\n", large)));
+    REQUIRE(!cache.lookup(99, noHeaders, t0));
+}
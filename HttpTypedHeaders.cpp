@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "HttpTypedHeaders.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "HttpAscii.h"
+
+namespace
+{
+
+constexpr bool isWhitespace(char c) noexcept
+{
+    // CR and LF only occur within obsolete line folds
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+constexpr auto TokenChars = [] {
+    std::array<bool, 256> table {};
+    for (unsigned c = '0'; c <= '9'; ++c)
+        table[c] = true;
+    for (unsigned c = 'A'; c <= 'Z'; ++c)
+        table[c] = table[c + 'a' - 'A'] = true;
+    for (auto const c: std::string_view("!#$%&'*+-.^_`|~"))
+        table[static_cast<unsigned char>(c)] = true;
+    return table;
+}();
+
+/// Maps lower-case hex digits to their value, anything else to a value with bit 4 set.
+constexpr auto HexDigits = [] {
+    std::array<uint8_t, 256> table {};
+    table.fill(0x10);
+    for (unsigned c = '0'; c <= '9'; ++c)
+        table[c] = static_cast<uint8_t>(c - '0');
+    for (unsigned c = 'a'; c <= 'f'; ++c)
+        table[c] = static_cast<uint8_t>(c - 'a' + 10);
+    return table;
+}();
+
+void skipWhitespace(std::string_view& input) noexcept
+{
+    while (!input.empty() && isWhitespace(input.front()))
+        input.remove_prefix(1);
+}
+
+std::string_view takeToken(std::string_view& input) noexcept
+{
+    size_t n = 0;
+    while (n < input.size() && TokenChars[static_cast<unsigned char>(input[n])])
+        ++n;
+
+    auto const token = input.substr(0, n);
+    input.remove_prefix(n);
+    return token;
+}
+
+bool takeNumber(std::string_view& input, uint64_t& number) noexcept
+{
+    if (input.empty() || !std::isdigit(static_cast<unsigned char>(input.front())))
+        return false;
+
+    number = 0;
+    while (!input.empty() && std::isdigit(static_cast<unsigned char>(input.front())))
+    {
+        auto const digit = static_cast<uint64_t>(input.front() - '0');
+        if (number > (UINT64_MAX - 1 - digit) / 10) // UINT64_MAX is HttpByteRanges::Open
+            return false;
+        number = number * 10 + digit;
+        input.remove_prefix(1);
+    }
+    return true;
+}
+
+/// Parses the parameters following a media type or list element, up to the end of @p input or the next
+/// comma, passing each to @p handle.
+template <typename Handler>
+bool parseParameters(std::string_view& input, Handler&& handle) noexcept
+{
+    for (;;)
+    {
+        skipWhitespace(input);
+        if (input.empty() || input.front() == ',')
+            return true;
+        if (input.front() != ';')
+            return false;
+        input.remove_prefix(1);
+
+        skipWhitespace(input);
+        if (input.empty() || input.front() == ';' || input.front() == ',')
+            continue; // empty parameter
+
+        auto const name = takeToken(input);
+        if (name.empty() || input.empty() || input.front() != '=')
+            return false;
+        input.remove_prefix(1);
+
+        std::string_view value;
+        if (!input.empty() && input.front() == '"')
+        {
+            size_t i = 1;
+            while (i < input.size() && input[i] != '"')
+                i += input[i] == '\\' ? 2 : 1;
+            if (i >= input.size())
+                return false;
+            value = input.substr(1, i - 1);
+            input.remove_prefix(i + 1);
+        }
+        else if ((value = takeToken(input)).empty())
+            return false;
+
+        if (!handle(name, value))
+            return false;
+    }
+}
+
+/// Parses a qvalue into thousandths.
+bool parseQuality(std::string_view value, uint16_t& quality) noexcept
+{
+    if (value.empty() || (value.front() != '0' && value.front() != '1'))
+        return false;
+
+    auto const one = value.front() == '1';
+    value.remove_prefix(1);
+    if (value.empty())
+    {
+        quality = one ? 1000 : 0;
+        return true;
+    }
+    if (value.front() != '.' || value.size() > 4)
+        return false;
+    value.remove_prefix(1);
+
+    uint16_t fraction = 0;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        auto const digit = i < value.size() ? value[i] : '0';
+        if (!std::isdigit(static_cast<unsigned char>(digit)) || (one && digit != '0'))
+            return false;
+        fraction = static_cast<uint16_t>(fraction * 10 + (digit - '0'));
+    }
+    quality = static_cast<uint16_t>((one ? 1000 : 0) + fraction);
+    return true;
+}
+
+std::optional<HttpAcceptEncoding::Coding> codingOf(std::string_view name) noexcept
+{
+    using Coding = HttpAcceptEncoding::Coding;
+
+    if (iequals(name, "gzip") || iequals(name, "x-gzip"))
+        return Coding::Gzip;
+    if (iequals(name, "br"))
+        return Coding::Brotli;
+    if (iequals(name, "zstd"))
+        return Coding::Zstd;
+    if (iequals(name, "deflate"))
+        return Coding::Deflate;
+    if (iequals(name, "identity"))
+        return Coding::Identity;
+    if (name == "*")
+        return Coding::Any;
+    return std::nullopt;
+}
+
+/// Decodes @p input, two hex digits per byte, all of which must be valid.
+template <size_t N>
+bool decodeHex(std::string_view input, std::array<uint8_t, N>& output) noexcept
+{
+    // free of branches, so that fixed-width ids compile to vector code
+    uint8_t invalid = 0;
+    for (size_t i = 0; i < N; ++i)
+    {
+        auto const high = HexDigits[static_cast<unsigned char>(input[2 * i])];
+        auto const low = HexDigits[static_cast<unsigned char>(input[2 * i + 1])];
+        invalid |= high | low;
+        output[i] = static_cast<uint8_t>(high << 4 | (low & 0x0F));
+    }
+    return !(invalid & 0x10);
+}
+
+template <size_t N>
+bool isZero(std::array<uint8_t, N> const& bytes) noexcept
+{
+    return std::all_of(bytes.begin(), bytes.end(), [](uint8_t b) { return b == 0; });
+}
+
+} // namespace
+
+// {{{ HttpMediaType
+bool HttpMediaType::is(std::string_view type, std::string_view subtype) const noexcept
+{
+    return iequals(this->type, type) && iequals(this->subtype, subtype);
+}
+
+bool HttpMediaType::parse(std::string_view value, HttpMediaType& result) noexcept
+{
+    result = {};
+    skipWhitespace(value);
+    result.type = takeToken(value);
+    if (result.type.empty() || value.empty() || value.front() != '/')
+        return false;
+    value.remove_prefix(1);
+    result.subtype = takeToken(value);
+    if (result.subtype.empty())
+        return false;
+
+    auto const parameter = [&](std::string_view name, std::string_view parameterValue) {
+        if (iequals(name, "charset"))
+            result.charset = parameterValue;
+        else if (iequals(name, "boundary"))
+            result.boundary = parameterValue;
+        return true;
+    };
+    return parseParameters(value, parameter) && value.empty();
+}
+// }}}
+
+// {{{ HttpAcceptEncoding
+uint16_t HttpAcceptEncoding::quality(Coding coding) const noexcept
+{
+    auto const quality = qualities[static_cast<size_t>(coding)];
+    if (quality != Unspecified)
+        return quality;
+
+    auto const any = qualities[static_cast<size_t>(Coding::Any)];
+    if (coding == Coding::Any)
+        return any == Unspecified ? 0 : any;
+    if (any != Unspecified)
+        return any;
+    return coding == Coding::Identity ? 1000 : 0;
+}
+
+std::optional<HttpAcceptEncoding::Coding> HttpAcceptEncoding::select(
+    std::initializer_list<Coding> supported) const noexcept
+{
+    std::optional<Coding> best;
+    uint16_t bestQuality = 0;
+    for (auto const coding: supported)
+    {
+        auto const q = quality(coding);
+        if (q > bestQuality)
+        {
+            best = coding;
+            bestQuality = q;
+        }
+    }
+    return best;
+}
+
+bool HttpAcceptEncoding::parse(std::string_view value, HttpAcceptEncoding& result) noexcept
+{
+    result.qualities.fill(Unspecified);
+
+    for (;;)
+    {
+        skipWhitespace(value);
+        if (value.empty())
+            return true;
+        if (value.front() == ',')
+        {
+            value.remove_prefix(1); // empty list element
+            continue;
+        }
+
+        auto const name = takeToken(value);
+        if (name.empty())
+            return false;
+
+        uint16_t quality = 1000;
+        auto const parameter = [&](std::string_view parameterName, std::string_view parameterValue) {
+            return !iequals(parameterName, "q") || parseQuality(parameterValue, quality);
+        };
+        if (!parseParameters(value, parameter))
+            return false;
+
+        if (auto const coding = codingOf(name))
+            result.qualities[static_cast<size_t>(*coding)] = quality;
+    }
+}
+// }}}
+
+// {{{ HttpByteRanges
+size_t HttpByteRanges::resolve(uint64_t length, std::array<Range, MaxRanges>& resolved) const noexcept
+{
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const& range = ranges[i];
+        if (range.first == Open)
+        {
+            if (range.last == 0 || length == 0)
+                continue;
+            resolved[n++] = { length - std::min(range.last, length), length - 1 };
+        }
+        else if (range.first < length)
+            resolved[n++] = { range.first, std::min(range.last, length - 1) };
+    }
+    return n;
+}
+
+bool HttpByteRanges::parse(std::string_view value, HttpByteRanges& result) noexcept
+{
+    result.count = 0;
+
+    constexpr std::string_view Unit = "bytes=";
+    if (!iequals(value.substr(0, Unit.size()), Unit))
+        return false;
+    value.remove_prefix(Unit.size());
+
+    for (;;)
+    {
+        skipWhitespace(value);
+        if (value.empty())
+            return result.count != 0;
+        if (value.front() == ',')
+        {
+            value.remove_prefix(1); // empty list element
+            continue;
+        }
+        if (result.count == MaxRanges)
+            return false;
+
+        Range range { Open, Open };
+        if (value.front() == '-')
+        {
+            value.remove_prefix(1);
+            if (!takeNumber(value, range.last))
+                return false;
+        }
+        else
+        {
+            if (!takeNumber(value, range.first) || value.empty() || value.front() != '-')
+                return false;
+            value.remove_prefix(1);
+            if (!value.empty() && std::isdigit(static_cast<unsigned char>(value.front()))
+                && (!takeNumber(value, range.last) || range.last < range.first))
+                return false;
+        }
+        result.ranges[result.count++] = range;
+
+        skipWhitespace(value);
+        if (!value.empty() && value.front() != ',')
+            return false;
+    }
+}
+// }}}
+
+// {{{ HttpTraceParent
+bool HttpTraceParent::parse(std::string_view value, HttpTraceParent& result) noexcept
+{
+    // version "-" trace-id "-" parent-id "-" trace-flags
+    constexpr size_t Size = 55;
+    if (value.size() < Size || value[2] != '-' || value[35] != '-' || value[52] != '-')
+        return false;
+
+    std::array<uint8_t, 1> version;
+    std::array<uint8_t, 1> flags;
+    if (!decodeHex(value.substr(0, 2), version) || !decodeHex(value.substr(3, 32), result.traceId)
+        || !decodeHex(value.substr(36, 16), result.parentId) || !decodeHex(value.substr(53, 2), flags))
+        return false;
+
+    result.version = version[0];
+    result.flags = flags[0];
+
+    // later versions may append fields
+    if (result.version == 0xFF || (result.version == 0 && value.size() != Size)
+        || (value.size() > Size && value[Size] != '-'))
+        return false;
+
+    return !isZero(result.traceId) && !isZero(result.parentId);
+}
+// }}}
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Parsers for the values of the header fields inspected on every request, beyond those framing the
+// message. Each takes a value as handed to HttpListener::onMessageHeader() and fills a fixed-size result
+// without allocating; views in results point into the value. Obsolete line folds count as whitespace, so
+// values need not be normalized first (see HttpHeaderValue).
+
+/// Content-Type (RFC 9110, 8.3): media type and the parameters of interest.
+struct HttpMediaType
+{
+    std::string_view type;
+    std::string_view subtype;
+    std::string_view charset;  //!< charset parameter, if any
+    std::string_view boundary; //!< boundary parameter, if any
+
+    /// Whether or not this is @p type / @p subtype (case-insensitive).
+    bool is(std::string_view type, std::string_view subtype) const noexcept;
+
+    /// Parses a Content-Type value. Quoted parameter values come without their quotes, but with any
+    /// backslash escapes as received.
+    ///
+    /// @return false if @p value is malformed.
+    static bool parse(std::string_view value, HttpMediaType& result) noexcept;
+};
+
+/// Accept-Encoding (RFC 9110, 12.5.3): the qualities of the content codings a server may choose from.
+struct HttpAcceptEncoding
+{
+    enum class Coding : uint8_t
+    {
+        Identity,
+        Gzip, //!< also x-gzip
+        Deflate,
+        Brotli, //!< br
+        Zstd,
+        Any, //!< the "*" wildcard
+    };
+    static constexpr size_t CodingCount = 6;
+    static constexpr uint16_t Unspecified = 0xFFFF;
+
+    std::array<uint16_t, CodingCount> qualities; //!< in thousandths, or Unspecified if not listed
+
+    /// Quality of @p coding (in thousandths), resorting to the wildcard for codings not listed. Identity
+    /// is acceptable unless excluded explicitly.
+    uint16_t quality(Coding coding) const noexcept;
+
+    /// Selects the coding of highest quality among those the server supports, the first of them in the
+    /// server's order of preference on ties.
+    ///
+    /// @return nullopt if none is acceptable, i.e. 406 (Not Acceptable).
+    std::optional<Coding> select(std::initializer_list<Coding> supported) const noexcept;
+
+    /// Parses an Accept-Encoding value, ignoring codings not listed in Coding.
+    ///
+    /// @return false if @p value is malformed.
+    static bool parse(std::string_view value, HttpAcceptEncoding& result) noexcept;
+};
+
+/// Range (RFC 9110, 14.2) in bytes.
+struct HttpByteRanges
+{
+    static constexpr size_t MaxRanges = 8;
+    static constexpr uint64_t Open = UINT64_MAX; //!< last of a range up to the end
+
+    /// A range as requested: first to last, first to Open, or a suffix of length last if first is Open.
+    struct Range
+    {
+        uint64_t first;
+        uint64_t last;
+    };
+
+    std::array<Range, MaxRanges> ranges;
+    size_t count;
+
+    /// Resolves the requested ranges against a representation of @p length bytes, into inclusive ranges
+    /// of existing bytes, dropping the unsatisfiable ones.
+    ///
+    /// @return number of ranges written to @p resolved, 0 meaning 416 (Range Not Satisfiable).
+    size_t resolve(uint64_t length, std::array<Range, MaxRanges>& resolved) const noexcept;
+
+    /// Parses a Range value.
+    ///
+    /// @return false if @p value is malformed, not in bytes or with more than MaxRanges ranges, all of
+    ///         which a server answers by ignoring the field.
+    static bool parse(std::string_view value, HttpByteRanges& result) noexcept;
+};
+
+/// traceparent of W3C Trace Context.
+struct HttpTraceParent
+{
+    uint8_t version;
+    std::array<uint8_t, 16> traceId;
+    std::array<uint8_t, 8> parentId;
+    uint8_t flags;
+
+    bool sampled() const noexcept { return flags & 0x01; }
+
+    /// Parses a traceparent value, decoding its fixed-width fields all at once.
+    ///
+    /// @return false if @p value is malformed, or has an all-zero trace or parent id.
+    static bool parse(std::string_view value, HttpTraceParent& result) noexcept;
+};
+
+/// Parses the values of one header field by T::parse(), skipping the parse when a value repeats the
+/// previous one, as the Accept-Encoding or Content-Type of the requests on a connection typically do.
+///
+/// Meant to be kept per connection. The last value is copied into a buffer reused for the next, results
+/// point into that buffer and stay valid until the next parse() with a different value.
+template <typename T>
+class HttpMemoizedHeader
+{
+  public:
+    HttpMemoizedHeader() = default;
+    HttpMemoizedHeader(HttpMemoizedHeader const&) = delete;
+    HttpMemoizedHeader& operator=(HttpMemoizedHeader const&) = delete;
+
+    /// @return the result for @p value, or nullptr if it is malformed.
+    T const* parse(std::string_view value)
+    {
+        if (!_parsed || value != _value)
+        {
+            _value.assign(value);
+            _parsed = true;
+            _valid = T::parse(_value, _result);
+            ++_misses;
+        }
+        return _valid ? &_result : nullptr;
+    }
+
+    /// Number of values that have actually been parsed.
+    size_t misses() const noexcept { return _misses; }
+
+    void clear() noexcept
+    {
+        _value.clear();
+        _parsed = false;
+    }
+
+  private:
+    std::string _value; //!< the value last parsed
+    T _result {};
+    bool _parsed = false;
+    bool _valid = false;
+    size_t _misses = 0;
+};
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+
+#include "HttpTypedHeaders.h"
+
+TEST_CASE("HttpTypedHeaders.contentType")
+{
+    HttpMediaType mediaType;
+    REQUIRE(HttpMediaType::parse("text/html; charset=UTF-8", mediaType));
+    REQUIRE(mediaType.is("TEXT", "Html"));
+    REQUIRE("UTF-8" == mediaType.charset);
+    REQUIRE(mediaType.boundary.empty());
+
+    auto const folded = "multipart/form-data;;Boundary=\"a b\\\"c\" ;\r\n charset=utf-8";
+    REQUIRE(HttpMediaType::parse(folded, mediaType));
+    REQUIRE(mediaType.is("multipart", "form-data"));
+    REQUIRE("a b\\\"c" == mediaType.boundary);
+    REQUIRE("utf-8" == mediaType.charset);
+
+    REQUIRE(!HttpMediaType::parse("text", mediaType));
+    REQUIRE(!HttpMediaType::parse("text/", mediaType));
+    REQUIRE(!HttpMediaType::parse("text/plain; charset", mediaType));
+    REQUIRE(!HttpMediaType::parse("text/plain; charset=\"open", mediaType));
+    REQUIRE(!HttpMediaType::parse("text/plain, text/html", mediaType));
+}
+
+TEST_CASE("HttpTypedHeaders.acceptEncoding")
+{
+    using Coding = HttpAcceptEncoding::Coding;
+
+    HttpAcceptEncoding accepted;
+    REQUIRE(HttpAcceptEncoding::parse("gzip, deflate;q=0.5, BR;Q=0.9, , unknown;q=1", accepted));
+    REQUIRE(1000 == accepted.quality(Coding::Gzip));
+    REQUIRE(500 == accepted.quality(Coding::Deflate));
+    REQUIRE(900 == accepted.quality(Coding::Brotli));
+    REQUIRE(0 == accepted.quality(Coding::Zstd));
+    REQUIRE(1000 == accepted.quality(Coding::Identity));
+    REQUIRE(Coding::Gzip == accepted.select({ Coding::Brotli, Coding::Gzip }));
+    REQUIRE(Coding::Brotli == accepted.select({ Coding::Zstd, Coding::Brotli }));
+
+    REQUIRE(HttpAcceptEncoding::parse("*;q=0.1, identity;q=0, x-gzip;q=0", accepted));
+    REQUIRE(100 == accepted.quality(Coding::Zstd));
+    REQUIRE(0 == accepted.quality(Coding::Gzip));
+    REQUIRE(!accepted.select({ Coding::Identity, Coding::Gzip }));
+
+    REQUIRE(HttpAcceptEncoding::parse("", accepted)); // identity only
+    REQUIRE(Coding::Identity == accepted.select({ Coding::Gzip, Coding::Identity }));
+
+    REQUIRE(!HttpAcceptEncoding::parse("gzip;q=1.5", accepted));
+    REQUIRE(!HttpAcceptEncoding::parse("gzip;q=0.1234", accepted));
+    REQUIRE(!HttpAcceptEncoding::parse("gzip deflate", accepted));
+}
+
+TEST_CASE("HttpTypedHeaders.range")
+{
+    HttpByteRanges ranges;
+    std::array<HttpByteRanges::Range, HttpByteRanges::MaxRanges> resolved;
+
+    REQUIRE(HttpByteRanges::parse("bytes=0-499, 500-, -200,9000-9999", ranges));
+    REQUIRE(4 == ranges.count);
+    REQUIRE(3 == ranges.resolve(1000, resolved));
+    REQUIRE((0 == resolved[0].first && 499 == resolved[0].last));
+    REQUIRE((500 == resolved[1].first && 999 == resolved[1].last));
+    REQUIRE((800 == resolved[2].first && 999 == resolved[2].last));
+
+    REQUIRE(HttpByteRanges::parse("Bytes=-5000", ranges));
+    REQUIRE(1 == ranges.resolve(1000, resolved));
+    REQUIRE((0 == resolved[0].first && 999 == resolved[0].last));
+    REQUIRE(0 == ranges.resolve(0, resolved));
+
+    REQUIRE(!HttpByteRanges::parse("bytes=", ranges));
+    REQUIRE(!HttpByteRanges::parse("items=0-1", ranges));
+    REQUIRE(!HttpByteRanges::parse("bytes=5-1", ranges));
+    REQUIRE(!HttpByteRanges::parse("bytes=1-2-3", ranges));
+    REQUIRE(!HttpByteRanges::parse("bytes=0-99999999999999999999", ranges));
+    REQUIRE(!HttpByteRanges::parse("bytes=0-,1-,2-,3-,4-,5-,6-,7-,8-", ranges));
+}
+
+TEST_CASE("HttpTypedHeaders.traceParent")
+{
+    HttpTraceParent traceParent;
+    REQUIRE(HttpTraceParent::parse("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01", traceParent));
+    REQUIRE(0 == traceParent.version);
+    REQUIRE(0x4b == traceParent.traceId[0]);
+    REQUIRE(0x36 == traceParent.traceId[15]);
+    REQUIRE(0xb7 == traceParent.parentId[7]);
+    REQUIRE(traceParent.sampled());
+
+    // later versions may append fields
+    REQUIRE(HttpTraceParent::parse("01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00-x", traceParent));
+    REQUIRE(!traceParent.sampled());
+
+    REQUIRE(
+        !HttpTraceParent::parse("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-x", traceParent));
+    REQUIRE(!HttpTraceParent::parse("ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01", traceParent));
+    REQUIRE(!HttpTraceParent::parse("00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01", traceParent));
+    REQUIRE(!HttpTraceParent::parse("00-00000000000000000000000000000000-00f067aa0ba902b7-01", traceParent));
+    REQUIRE(!HttpTraceParent::parse("00-4bf92f3577b34da6a3ce929d0e0e4736-0000000000000000-01", traceParent));
+    REQUIRE(!HttpTraceParent::parse("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7", traceParent));
+}
+
+TEST_CASE("HttpTypedHeaders.memoized")
+{
+    HttpMemoizedHeader<HttpAcceptEncoding> acceptEncoding;
+    HttpMemoizedHeader<HttpMediaType> contentType;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        auto const* accepted = acceptEncoding.parse(std::string("gzip, br;q=0.8"));
+        REQUIRE(accepted != nullptr);
+        REQUIRE(800 == accepted->quality(HttpAcceptEncoding::Coding::Brotli));
+
+        // views point into the memoized copy, not into the temporary value
+        auto const* mediaType = contentType.parse(std::string("application/json; charset=utf-8"));
+        REQUIRE(mediaType != nullptr);
+        REQUIRE(mediaType->is("application", "json"));
+        REQUIRE("utf-8" == mediaType->charset);
+    }
+    REQUIRE(1 == acceptEncoding.misses());
+    REQUIRE(1 == contentType.misses());
+
+    REQUIRE(acceptEncoding.parse("gzip;q=2") == nullptr);
+    REQUIRE(acceptEncoding.parse("gzip;q=2") == nullptr);
+    REQUIRE(2 == acceptEncoding.misses());
+    REQUIRE(acceptEncoding.parse("deflate") != nullptr);
+    REQUIRE(3 == acceptEncoding.misses());
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "MappedFile.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+
+/// @return the mapping, or nullptr with errno set
+char const* map(int fd, size_t size) noexcept
+{
+    auto* const mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+
+    ::madvise(mapping, size, MADV_WILLNEED);
+    return static_cast<char const*>(mapping);
+}
+
+} // namespace
+
+MappedFile::MappedFile(std::string const& path)
+{
+    auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), path);
+
+    struct stat st {};
+    if (::fstat(fd, &st) < 0)
+    {
+        auto const error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+
+    auto const size = static_cast<size_t>(st.st_size);
+    if (size == 0)
+    {
+        ::close(fd);
+        return; // nothing to map
+    }
+
+    auto const* const mapping = map(fd, size);
+    auto const error = errno;
+    ::close(fd);
+    if (!mapping)
+        throw std::system_error(error, std::generic_category(), path);
+
+    _bytes = std::string_view(mapping, size);
+}
+
+MappedFile::MappedFile(int fd, size_t size)
+{
+    if (size == 0)
+        return; // nothing to map
+
+    auto const* const mapping = map(fd, size);
+    if (!mapping)
+        throw std::system_error(errno, std::generic_category(), "mmap");
+
+    _bytes = std::string_view(mapping, size);
+}
+
+MappedFile::~MappedFile()
+{
+    if (!_bytes.empty())
+        ::munmap(const_cast<char*>(_bytes.data()), _bytes.size());
+}
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/// Read-only memory mapping of a whole file, for parsing or replaying it in place.
+class MappedFile
+{
+  public:
+    MappedFile() noexcept = default;
+
+    /// Maps the file at @p path, hinting the kernel at reading all of it soon.
+    ///
+    /// @throw std::system_error if the file cannot be opened or mapped.
+    explicit MappedFile(std::string const& path);
+
+    /// Maps the first @p size bytes of the open file @p fd, which the caller may close right after.
+    ///
+    /// @throw std::system_error if the file cannot be mapped.
+    MappedFile(int fd, size_t size);
+
+    MappedFile(MappedFile&& other) noexcept: _bytes(std::exchange(other._bytes, {})) {}
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        MappedFile(std::move(other)).swap(*this);
+        return *this;
+    }
+    ~MappedFile();
+
+    void swap(MappedFile& other) noexcept { std::swap(_bytes, other._bytes); }
+
+    std::string_view bytes() const noexcept { return _bytes; }
+
+  private:
+    std::string_view _bytes;
+};
@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "MultipartParser.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+
+#include "HttpAscii.h"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr char CR = '\r';
+constexpr char LF = '\n';
+
+bool isValidBoundary(std::string_view boundary) noexcept
+{
+    // RFC 2046, 5.1.1: bchars only, not ending with a space
+    if (boundary.empty() || boundary.size() > MultipartParser::MaxBoundaryLength || boundary.back() == ' ')
+        return false;
+
+    return std::all_of(boundary.begin(), boundary.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || (c != '\0' && std::strchr("'()+_,-./:=? ", c));
+    });
+}
+
+} // namespace
+
+MultipartParser::MultipartParser(std::string_view boundary, MultipartListener* listener):
+    _listener(listener), _partParser(HttpParseMode::MESSAGE, this)
+{
+    if (!isValidBoundary(boundary))
+    {
+        _state = State::Error;
+        return;
+    }
+
+    _delimiter.reserve(4 + boundary.size());
+    _delimiter += "\r\n--";
+    _delimiter += boundary;
+
+    auto const m = _delimiter.size();
+    _skip.fill(static_cast<unsigned char>(m));
+    for (size_t j = 0; j + 1 < m; ++j)
+        _skip[static_cast<unsigned char>(_delimiter[j])] = static_cast<unsigned char>(m - 1 - j);
+
+    // The first delimiter may come without a preceding CRLF, right at the start of the body.
+    _matched = 2;
+}
+
+std::string_view MultipartParser::boundaryOf(std::string_view contentType) noexcept
+{
+    while (!contentType.empty())
+    {
+        auto const semicolon = contentType.find(';');
+        if (semicolon == std::string_view::npos)
+            return {};
+        contentType.remove_prefix(semicolon + 1);
+
+        while (!contentType.empty() && (contentType.front() == ' ' || contentType.front() == '\t'))
+            contentType.remove_prefix(1);
+
+        auto const equals = contentType.find('=');
+        if (equals == std::string_view::npos)
+            return {};
+
+        auto name = contentType.substr(0, equals);
+        while (!name.empty() && (name.back() == ' ' || name.back() == '\t'))
+            name.remove_suffix(1);
+
+        auto value = contentType.substr(equals + 1);
+        if (!value.empty() && value.front() == '"')
+        {
+            value.remove_prefix(1);
+            value = value.substr(0, value.find('"'));
+        }
+        else
+        {
+            value = value.substr(0, value.find(';'));
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+                value.remove_suffix(1);
+        }
+
+        if (iequals(name, "boundary"))
+            return value;
+    }
+
+    return {};
+}
+
+void MultipartParser::parse(std::string_view chunk)
+{
+    while (!chunk.empty())
+    {
+        switch (_state)
+        {
+            case State::Preamble:
+            case State::PartContent: chunk.remove_prefix(scanContent(chunk)); break;
+            case State::AfterBoundary:
+                if (chunk.front() == '-')
+                    _state = State::CloseDash;
+                else if (chunk.front() == CR)
+                    _state = State::BoundaryLF;
+                else if (chunk.front() != ' ' && chunk.front() != '\t')
+                {
+                    fail();
+                    return;
+                }
+                chunk.remove_prefix(1);
+                break;
+            case State::CloseDash:
+                if (chunk.front() != '-')
+                {
+                    fail();
+                    return;
+                }
+                chunk.remove_prefix(1);
+                _state = State::Epilogue;
+                _listener->onMultipartEnd();
+                break;
+            case State::BoundaryLF:
+                if (chunk.front() != LF)
+                {
+                    fail();
+                    return;
+                }
+                chunk.remove_prefix(1);
+                _state = State::PartHeaders;
+                _inPartHeaders = true;
+                _partHeaderEnd = 0;
+                _partParser.reset();
+                break;
+            case State::PartHeaders: {
+                auto const before = _partParser.bytesReceived();
+
+                // The part parser takes everything following the headers for content (there is no
+                // Content-Length to go by), which is ignored: we continue right after the headers instead.
+                _partParser.parseFragment(chunk);
+                if (_state == State::Error)
+                    return;
+
+                if (!_inPartHeaders)
+                {
+                    chunk.remove_prefix(_partHeaderEnd - before);
+                    _state = State::PartContent;
+                }
+                else if (_partParser.bytesReceived() > MaxPartHeaderSize)
+                {
+                    fail();
+                    return;
+                }
+                else
+                    chunk = {};
+                break;
+            }
+            case State::Epilogue: return;
+            case State::Error: return;
+        }
+    }
+}
+
+void MultipartParser::finish()
+{
+    if (_state != State::Epilogue && _state != State::Error)
+        fail();
+}
+
+size_t MultipartParser::scanContent(std::string_view chunk)
+{
+    std::string_view const delimiter = _delimiter;
+
+    if (_matched)
+    {
+        // continue matching the delimiter begun at the end of the previous piece
+        auto const rest = delimiter.substr(_matched);
+        auto const n = std::min(rest.size(), chunk.size());
+        if (chunk.substr(0, n) == rest.substr(0, n))
+        {
+            if (n < rest.size())
+            {
+                _matched += n;
+                return n;
+            }
+
+            _matched = 0;
+            if (_state == State::PartContent)
+                _listener->onPartEnd();
+            _state = State::AfterBoundary;
+            return n;
+        }
+
+        // The bytes held back were content after all. As they equal the delimiter's prefix, they are
+        // passed on from there. The delimiter cannot start within them, as it contains no other CR.
+        emitContent(delimiter.substr(0, _matched));
+        _matched = 0;
+    }
+
+    if (auto const pos = find(chunk); pos != std::string_view::npos)
+    {
+        emitContent(chunk.substr(0, pos));
+        if (_state == State::PartContent)
+            _listener->onPartEnd();
+        _state = State::AfterBoundary;
+        return pos + delimiter.size();
+    }
+
+    // hold back what may turn out to be the beginning of a delimiter
+    _matched = partialMatchAtEnd(chunk);
+    emitContent(chunk.substr(0, chunk.size() - _matched));
+    return chunk.size();
+}
+
+size_t MultipartParser::find(std::string_view text) const noexcept
+{
+    std::string_view const delimiter = _delimiter;
+    auto const m = delimiter.size();
+    if (text.size() < m)
+        return std::string_view::npos;
+
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Compare the first and last delimiter byte against 16 candidate positions at once, verifying
+    // the (rare) positions where both match.
+    auto const first = _mm_set1_epi8(delimiter.front());
+    auto const last = _mm_set1_epi8(delimiter.back());
+    for (; i + m - 1 + 16 <= text.size(); i += 16)
+    {
+        auto const blockFirst = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text.data() + i));
+        auto const blockLast = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text.data() + i + m - 1));
+        auto mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+
+        while (mask)
+        {
+            auto const offset = i + static_cast<size_t>(std::countr_zero(mask));
+            if (std::memcmp(text.data() + offset + 1, delimiter.data() + 1, m - 2) == 0)
+                return offset;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // Horspool for whatever is left
+    while (i + m <= text.size())
+    {
+        auto const c = text[i + m - 1];
+        if (c == delimiter.back() && std::memcmp(text.data() + i, delimiter.data(), m - 1) == 0)
+            return i;
+        i += _skip[static_cast<unsigned char>(c)];
+    }
+
+    return std::string_view::npos;
+}
+
+size_t MultipartParser::partialMatchAtEnd(std::string_view text) const noexcept
+{
+    // As CR only occurs at the start of the delimiter, only the last CR can begin a partial match.
+    auto const window = std::min(text.size(), _delimiter.size() - 1);
+    auto const tail = text.substr(text.size() - window);
+    auto const cr = tail.rfind(CR);
+    if (cr == std::string_view::npos)
+        return 0;
+
+    auto const candidate = tail.substr(cr);
+    return std::string_view(_delimiter).starts_with(candidate) ? candidate.size() : 0;
+}
+
+void MultipartParser::emitContent(std::string_view content)
+{
+    if (_state == State::PartContent && !content.empty())
+        _listener->onPartContent(content);
+}
+
+void MultipartParser::fail()
+{
+    _state = State::Error;
+    _inPartHeaders = false;
+    _listener->onMultipartError();
+}
+
+void MultipartParser::onMessageBegin()
+{
+    if (_inPartHeaders)
+        _listener->onPartBegin();
+}
+
+void MultipartParser::onMessageHeader(std::string_view name, std::string_view value)
+{
+    if (_inPartHeaders)
+        _listener->onPartHeader(name, value);
+}
+
+void MultipartParser::onMessageHeaderEnd()
+{
+    if (!_inPartHeaders)
+        return;
+
+    _inPartHeaders = false;
+    _partHeaderEnd = _partParser.bytesReceived();
+    _listener->onPartHeaderEnd();
+}
+
+void MultipartParser::onProtocolError()
+{
+    // errors within part content (e.g. due to a bogus Transfer-Encoding part header) are none of ours
+    if (_inPartHeaders)
+        fail();
+}
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "HttpMessageParser.h"
+
+/// Receives the parts of a multipart body (e.g. multipart/form-data) from a MultipartParser.
+class MultipartListener // {{{
+{
+  public:
+    virtual ~MultipartListener() = default;
+
+    /// A new body part begins, its headers follow.
+    virtual void onPartBegin() {}
+
+    /// Single header of the current part.
+    virtual void onPartHeader(std::string_view name, std::string_view value) {}
+
+    /// All headers of the current part have been parsed, its content follows.
+    virtual void onPartHeaderEnd() {}
+
+    /// Invoked for every piece of content of the current part, pointing into the input where possible.
+    virtual void onPartContent(std::string_view chunk) {}
+
+    /// The current part is complete.
+    virtual void onPartEnd() {}
+
+    /// The close-delimiter has been reached, the rest of the body is to be ignored.
+    virtual void onMultipartEnd() {}
+
+    /// Malformed or truncated multipart body; the parser stops.
+    virtual void onMultipartError() {}
+}; // }}}
+
+/// Incremental parser splitting a multipart body (RFC 2046) into its parts.
+///
+/// It is fed the body piece by piece as received, typically from HttpListener::onMessageContent(), and
+/// keeps no more than the part headers currently being parsed, so memory use does not depend on the size
+/// of the body. Part headers are parsed by an HttpParser in HttpParseMode::MESSAGE. Part content is
+/// handed on as slices of the input; a delimiter straddling two pieces is matched across them.
+class MultipartParser final: private HttpListener
+{
+  public:
+    static constexpr size_t MaxBoundaryLength = 70;
+    static constexpr size_t MaxPartHeaderSize = 16 * 1024;
+
+    /// @param boundary the boundary parameter of the Content-Type, see boundaryOf()
+    /// @param listener receives the parts
+    MultipartParser(std::string_view boundary, MultipartListener* listener);
+
+    MultipartParser(MultipartParser const&) = delete;
+    MultipartParser& operator=(MultipartParser const&) = delete;
+
+    /// Extracts the boundary parameter from a multipart Content-Type header value.
+    ///
+    /// @return the boundary, without quotes, or an empty view if there is none.
+    static std::string_view boundaryOf(std::string_view contentType) noexcept;
+
+    /// Processes the next piece of the body.
+    void parse(std::string_view chunk);
+
+    /// Signals the end of the body, reporting an error if it has not been properly closed.
+    void finish();
+
+    bool finished() const noexcept { return _state == State::Epilogue; }
+    bool failed() const noexcept { return _state == State::Error; }
+
+  private:
+    enum class State
+    {
+        Preamble,      //!< before the first delimiter, discarded
+        AfterBoundary, //!< transport padding, then CRLF or "--"
+        CloseDash,     //!< second dash of a close-delimiter
+        BoundaryLF,
+        PartHeaders,
+        PartContent,
+        Epilogue,      //!< after the close-delimiter, discarded
+        Error,
+    };
+
+    size_t scanContent(std::string_view chunk);
+    size_t find(std::string_view text) const noexcept;
+    size_t partialMatchAtEnd(std::string_view text) const noexcept;
+    void emitContent(std::string_view content);
+    void fail();
+
+    void onMessageBegin() override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageHeaderEnd() override;
+    void onProtocolError() override;
+
+    MultipartListener* _listener;
+    std::string _delimiter;             //!< CRLF "--" boundary
+    std::array<unsigned char, 256> _skip {}; //!< Horspool bad character shifts
+    State _state = State::Preamble;
+    size_t _matched = 0; //!< length of the delimiter prefix matched at the end of the previous piece
+
+    HttpParser _partParser;
+    bool _inPartHeaders = false;
+    size_t _partHeaderEnd = 0; //!< bytes of part headers, once their end has been seen
+};
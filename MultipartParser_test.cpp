@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "MultipartParser.h"
+
+namespace
+{
+
+struct Part
+{
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string content;
+    bool complete = false;
+};
+
+struct PartCollector: public MultipartListener
+{
+    std::vector<Part> parts;
+    std::vector<std::string_view> slices;
+    bool ended = false;
+    int errors = 0;
+
+    void onPartBegin() override { parts.emplace_back(); }
+    void onPartHeader(std::string_view name, std::string_view value) override
+    {
+        parts.back().headers.emplace_back(name, value);
+    }
+    void onPartContent(std::string_view chunk) override
+    {
+        parts.back().content += chunk;
+        slices.push_back(chunk);
+    }
+    void onPartEnd() override { parts.back().complete = true; }
+    void onMultipartEnd() override { ended = true; }
+    void onMultipartError() override { ++errors; }
+};
+
+using namespace std::string_literals;
+
+// near-misses of the delimiter, none of which may end the part
+std::string const fileContent = "binary\r\n-\r\n--\r\n--XyZ\0\r\n--AaB03\0y"s + std::string(300, 'x');
+
+std::string const body = "preamble, to be ignored\r\n"
+                         "--AaB03x\r\n"
+                         "Content-Disposition: form-data; name=\"field\"\r\n"
+                         "\r\n"
+                         "value\r\n"
+                         "--AaB03x  \r\n"
+                         "Content-Disposition: form-data; name=\"file\"; filename=\"a.bin\"\r\n"
+                         "Content-Type: application/octet-stream\r\n"
+                         "\r\n"
+                         + fileContent
+                         + "\r\n"
+                           "--AaB03x\r\n"
+                           "\r\n"
+                           "\r\n"
+                           "--AaB03x--\r\n"
+                           "epilogue";
+
+} // namespace
+
+TEST_CASE("MultipartParser.boundaryOf")
+{
+    REQUIRE("AaB03x" == MultipartParser::boundaryOf("multipart/form-data; boundary=AaB03x"));
+    REQUIRE("a b" == MultipartParser::boundaryOf("multipart/mixed;charset=utf-8; BOUNDARY=\"a b\""));
+    REQUIRE("x" == MultipartParser::boundaryOf("multipart/form-data; boundary=x ; foo=bar"));
+    REQUIRE(MultipartParser::boundaryOf("multipart/form-data").empty());
+}
+
+TEST_CASE("MultipartParser.fragmented")
+{
+    // every fragment size, so that delimiters and part headers straddle fragments at every position
+    for (size_t fragmentSize = 1; fragmentSize <= body.size(); ++fragmentSize)
+    {
+        PartCollector collector;
+        MultipartParser parser("AaB03x", &collector);
+
+        for (size_t offset = 0; offset < body.size(); offset += fragmentSize)
+            parser.parse(std::string_view(body).substr(offset, fragmentSize));
+        parser.finish();
+
+        INFO("fragment size " << fragmentSize);
+        REQUIRE(0 == collector.errors);
+        REQUIRE(collector.ended);
+        REQUIRE(3 == collector.parts.size());
+
+        REQUIRE(1 == collector.parts[0].headers.size());
+        REQUIRE("Content-Disposition" == collector.parts[0].headers[0].first);
+        REQUIRE("form-data; name=\"field\"" == collector.parts[0].headers[0].second);
+        REQUIRE("value" == collector.parts[0].content);
+
+        REQUIRE(2 == collector.parts[1].headers.size());
+        REQUIRE("application/octet-stream" == collector.parts[1].headers[1].second);
+        REQUIRE(fileContent == collector.parts[1].content);
+
+        REQUIRE(collector.parts[2].headers.empty());
+        REQUIRE(collector.parts[2].content.empty());
+        REQUIRE(collector.parts[2].complete);
+    }
+}
+
+TEST_CASE("MultipartParser.zeroCopy")
+{
+    PartCollector collector;
+    MultipartParser parser("AaB03x", &collector);
+    parser.parse(body);
+
+    REQUIRE(parser.finished());
+    REQUIRE(2 == collector.slices.size());
+    for (auto const slice: collector.slices)
+        REQUIRE((slice.data() >= body.data() && slice.data() + slice.size() <= body.data() + body.size()));
+}
+
+TEST_CASE("MultipartParser.malformed")
+{
+    SECTION("truncated")
+    {
+        PartCollector collector;
+        MultipartParser parser("AaB03x", &collector);
+        parser.parse(body.substr(0, body.size() / 2));
+        parser.finish();
+        REQUIRE(1 == collector.errors);
+        REQUIRE(!collector.parts.back().complete);
+    }
+
+    SECTION("bad part header")
+    {
+        PartCollector collector;
+        MultipartParser parser("AaB03x", &collector);
+        parser.parse("--AaB03x\r\nno colon here\r\n\r\n");
+        REQUIRE(parser.failed());
+        REQUIRE(1 == collector.errors);
+    }
+
+    SECTION("garbage after boundary")
+    {
+        PartCollector collector;
+        MultipartParser parser("AaB03x", &collector);
+        parser.parse("--AaB03xyz\r\n\r\n");
+        REQUIRE(parser.failed());
+    }
+
+    SECTION("invalid boundary")
+    {
+        PartCollector collector;
+        MultipartParser parser(std::string(71, 'a'), &collector);
+        REQUIRE(parser.failed());
+    }
+}
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "ParsedRequest.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "HttpAscii.h"
+
+std::string_view ParsedRequest::header(std::string_view name) const noexcept
+{
+    for (size_t i = 0; i < headerCount; ++i)
+        if (iequals(headerName(i), name))
+            return headerValue(i);
+
+    return {};
+}
+
+ParsedRequestBuilder::ParsedRequestBuilder(Sink sink, std::function<void()> error):
+    _sink(std::move(sink)), _error(std::move(error))
+{
+}
+
+void ParsedRequestBuilder::onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version)
+{
+    _request = {};
+    _request.buffer = _buffer;
+    _request.version = version;
+    _linearized = false;
+    _failed = false;
+
+    _request.method = record(method);
+    _request.entity = record(entity);
+}
+
+void ParsedRequestBuilder::onMessageHeader(std::string_view name, std::string_view value)
+{
+    if (_failed)
+        return;
+
+    if (_request.headerCount == ParsedRequest::MaxHeaders)
+    {
+        _failed = true;
+        if (_error)
+            _error();
+        return;
+    }
+
+    auto& header = _request.headers[_request.headerCount++];
+    header.name = record(name);
+    header.value = record(value);
+}
+
+void ParsedRequestBuilder::onMessageContent(std::string_view chunk)
+{
+    if (_failed || chunk.empty())
+        return;
+
+    auto& body = _request.body;
+    if (body.length == 0)
+    {
+        body = record(chunk);
+        return;
+    }
+
+    auto const& buffer = *_request.buffer;
+    char const* const bodyEnd = buffer.data() + body.offset + body.length;
+
+    if (!_linearized && buffer.contains(chunk) && chunk.data() == bodyEnd)
+    {
+        body.length += static_cast<uint32_t>(chunk.size()); // contiguous within the same buffer
+        return;
+    }
+
+    if (!_linearized || bodyEnd != buffer.data() + buffer.size()
+        || buffer.size() + chunk.size() > buffer.capacity())
+        linearize(chunk.size());
+
+    auto& target = *_request.buffer;
+    std::memcpy(target.data() + target.size(), chunk.data(), chunk.size());
+    target.resize(target.size() + chunk.size());
+    body.length += static_cast<uint32_t>(chunk.size());
+}
+
+void ParsedRequestBuilder::onMessageEnd()
+{
+    if (!_failed)
+        _sink(std::move(_request));
+
+    _request = {};
+    _linearized = false;
+    _failed = false;
+}
+
+void ParsedRequestBuilder::onProtocolError()
+{
+    _request = {};
+    _linearized = false;
+    _failed = true;
+
+    if (_error)
+        _error();
+}
+
+/// Records @p bytes, in place if possible, and copied into the request's private buffer otherwise.
+HttpSlice ParsedRequestBuilder::record(std::string_view bytes)
+{
+    if (bytes.empty())
+        return {};
+
+    if (!_linearized && _request.buffer && _request.buffer->contains(bytes))
+        return HttpSlice { static_cast<uint32_t>(bytes.data() - _request.buffer->data()),
+                           static_cast<uint32_t>(bytes.size()) };
+
+    if (!_linearized || _request.buffer->size() + bytes.size() > _request.buffer->capacity())
+        linearize(bytes.size());
+
+    auto& buffer = *_request.buffer;
+    auto const slice = HttpSlice { static_cast<uint32_t>(buffer.size()), static_cast<uint32_t>(bytes.size()) };
+    std::memcpy(buffer.data() + buffer.size(), bytes.data(), bytes.size());
+    buffer.resize(buffer.size() + bytes.size());
+    return slice;
+}
+
+/// Moves everything recorded so far into a private buffer with room for at least @p extra more bytes.
+///
+/// The body is copied last, so that further content can be appended to it.
+void ParsedRequestBuilder::linearize(size_t extra)
+{
+    auto slices = std::array<HttpSlice*, 2 + 2 * ParsedRequest::MaxHeaders + 1> {};
+    size_t count = 0;
+    slices[count++] = &_request.method;
+    slices[count++] = &_request.entity;
+    for (size_t i = 0; i < _request.headerCount; ++i)
+    {
+        slices[count++] = &_request.headers[i].name;
+        slices[count++] = &_request.headers[i].value;
+    }
+    slices[count++] = &_request.body;
+
+    size_t used = extra;
+    for (size_t i = 0; i < count; ++i)
+        used += slices[i]->length;
+
+    auto target = HttpBuffer::create(std::max<size_t>(2 * used, 1024));
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto& slice = *slices[i];
+        if (slice.length == 0)
+            continue;
+
+        std::memcpy(target->data() + target->size(), _request.buffer->data() + slice.offset, slice.length);
+        slice.offset = static_cast<uint32_t>(target->size());
+        target->resize(target->size() + slice.length);
+    }
+
+    _request.buffer = std::move(target);
+    _linearized = true;
+}
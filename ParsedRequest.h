@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "HttpMessageParser.h"
+
+class HttpBufferRef;
+
+/// Reference counted byte buffer, retaining received bytes beyond the parseFragment() call that saw them.
+class HttpBuffer
+{
+  public:
+    static HttpBufferRef create(size_t capacity);
+
+    char* data() noexcept { return _data.get(); }
+    char const* data() const noexcept { return _data.get(); }
+    size_t size() const noexcept { return _size; }
+    size_t capacity() const noexcept { return _capacity; }
+
+    /// Sets the number of valid bytes, e.g. after having received into data().
+    void resize(size_t size) noexcept { _size = size <= _capacity ? size : _capacity; }
+
+    std::string_view view() const noexcept { return std::string_view(data(), _size); }
+
+    /// Tests whether or not @p bytes lie entirely within the valid bytes of this buffer.
+    bool contains(std::string_view bytes) const noexcept
+    {
+        return std::less_equal<char const*>()(data(), bytes.data())
+               && std::less_equal<char const*>()(bytes.data() + bytes.size(), data() + _size);
+    }
+
+  private:
+    explicit HttpBuffer(size_t capacity): _capacity(capacity), _data(std::make_unique<char[]>(capacity)) {}
+
+    friend class HttpBufferRef;
+
+    std::atomic<uint32_t> _refCount { 0 };
+    size_t _size = 0;
+    size_t _capacity;
+    std::unique_ptr<char[]> _data;
+};
+
+/// Intrusive, thread-safe reference to an HttpBuffer.
+class HttpBufferRef
+{
+  public:
+    HttpBufferRef() noexcept = default;
+    HttpBufferRef(HttpBufferRef const& other) noexcept: _buffer(other._buffer) { retain(); }
+    HttpBufferRef(HttpBufferRef&& other) noexcept: _buffer(std::exchange(other._buffer, nullptr)) {}
+    ~HttpBufferRef() { release(); }
+
+    HttpBufferRef& operator=(HttpBufferRef const& other) noexcept
+    {
+        HttpBufferRef(other).swap(*this);
+        return *this;
+    }
+
+    HttpBufferRef& operator=(HttpBufferRef&& other) noexcept
+    {
+        HttpBufferRef(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(HttpBufferRef& other) noexcept { std::swap(_buffer, other._buffer); }
+
+    HttpBuffer* get() const noexcept { return _buffer; }
+    HttpBuffer* operator->() const noexcept { return _buffer; }
+    HttpBuffer& operator*() const noexcept { return *_buffer; }
+    explicit operator bool() const noexcept { return _buffer != nullptr; }
+
+    /// Whether or not this is the only reference, i.e. the buffer may be reused for receiving.
+    bool unique() const noexcept { return _buffer && _buffer->_refCount.load(std::memory_order_acquire) == 1; }
+
+  private:
+    explicit HttpBufferRef(HttpBuffer* buffer) noexcept: _buffer(buffer) { retain(); }
+
+    friend class HttpBuffer;
+
+    void retain() noexcept
+    {
+        if (_buffer)
+            _buffer->_refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept
+    {
+        if (_buffer && _buffer->_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete _buffer;
+        _buffer = nullptr;
+    }
+
+    HttpBuffer* _buffer = nullptr;
+};
+
+inline HttpBufferRef HttpBuffer::create(size_t capacity)
+{
+    return HttpBufferRef(new HttpBuffer(capacity));
+}
+
+/// Byte range within the buffer of a ParsedRequest.
+struct HttpSlice
+{
+    uint32_t offset = 0;
+    uint32_t length = 0;
+};
+
+/// Compact descriptor of a fully parsed request.
+///
+/// All tokens are stored as offsets into one retained buffer, so the descriptor can be handed over to
+/// another thread without copying any of them. It is self-contained and costs no allocation, except for
+/// the rare case of a request spanning more than one receive buffer (see ParsedRequestBuilder).
+struct ParsedRequest
+{
+    static constexpr size_t MaxHeaders = 32;
+
+    struct Header
+    {
+        HttpSlice name;
+        HttpSlice value;
+    };
+
+    HttpBufferRef buffer; //!< holds the bytes all slices refer to
+    HttpSlice method;
+    HttpSlice entity;
+    HttpVersion version = HttpVersion::UNKNOWN;
+    uint16_t headerCount = 0;
+    std::array<Header, MaxHeaders> headers {};
+    HttpSlice body;
+
+    std::string_view resolve(HttpSlice slice) const noexcept
+    {
+        return std::string_view(buffer->data() + slice.offset, slice.length);
+    }
+
+    std::string_view methodName() const noexcept { return resolve(method); }
+    std::string_view path() const noexcept { return resolve(entity); }
+    std::string_view headerName(size_t index) const noexcept { return resolve(headers[index].name); }
+    std::string_view headerValue(size_t index) const noexcept { return resolve(headers[index].value); }
+    std::string_view content() const noexcept { return resolve(body); }
+
+    /// @return the value of the first header named @p name (case insensitive), or an empty view.
+    std::string_view header(std::string_view name) const noexcept;
+};
+
+/// HttpListener building one ParsedRequest per request, passing each on as soon as it is complete.
+///
+/// Before every parseFragment() call the driver announces the buffer it parses from by setBuffer().
+/// Tokens lying within that buffer are recorded as offsets only. Should a request not be contained in a
+/// single buffer (a token straddling buffers, or a request spanning receive calls), its bytes seen so far
+/// are linearized into a buffer of its own and everything else of that request is copied in there.
+class ParsedRequestBuilder: public HttpListener
+{
+  public:
+    using Sink = std::function<void(ParsedRequest&&)>;
+
+    /// @param sink   receives every completed request
+    /// @param error  invoked on protocol errors, including requests with more than MaxHeaders headers
+    ParsedRequestBuilder(Sink sink, std::function<void()> error = {});
+
+    /// Announces the buffer the upcoming parseFragment() call(s) parse from.
+    ///
+    /// The builder holds on to it until the next call, so pass an empty reference once done parsing it.
+    void setBuffer(HttpBufferRef buffer) noexcept { _buffer = std::move(buffer); }
+
+    void onMessageBegin(std::string_view method, std::string_view entity, HttpVersion version) override;
+    void onMessageHeader(std::string_view name, std::string_view value) override;
+    void onMessageContent(std::string_view chunk) override;
+    void onMessageEnd() override;
+    void onProtocolError() override;
+
+  private:
+    HttpSlice record(std::string_view bytes);
+    void linearize(size_t extra);
+
+    Sink _sink;
+    std::function<void()> _error;
+    HttpBufferRef _buffer;     //!< buffer currently parsed from
+    ParsedRequest _request;    //!< request currently being built
+    bool _linearized = false;  //!< whether _request.buffer is a private copy
+    bool _failed = false;      //!< request rejected, skipping until the parser reports its end
+};
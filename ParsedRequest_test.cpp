@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ParsedRequest.h"
+#include "SpscQueue.h"
+
+namespace
+{
+
+HttpBufferRef makeBuffer(std::string_view bytes)
+{
+    auto buffer = HttpBuffer::create(bytes.size());
+    std::memcpy(buffer->data(), bytes.data(), bytes.size());
+    buffer->resize(bytes.size());
+    return buffer;
+}
+
+/// Parses every buffer in turn, just like an I/O thread would do with its receive buffers.
+void parseAll(HttpParser& parser, ParsedRequestBuilder& builder, std::vector<HttpBufferRef> const& buffers)
+{
+    for (auto const& buffer: buffers)
+    {
+        builder.setBuffer(buffer);
+        auto bytes = buffer->view();
+        while (!bytes.empty() && parser.state() != HttpParserState::PROTOCOL_ERROR)
+            bytes.remove_prefix(parser.parseFragment(bytes));
+    }
+    builder.setBuffer({});
+}
+
+} // namespace
+
+TEST_CASE("ParsedRequest.inPlace")
+{
+    std::vector<ParsedRequest> requests;
+    ParsedRequestBuilder builder([&](ParsedRequest&& request) { requests.emplace_back(std::move(request)); });
+    HttpParser parser(HttpParseMode::REQUEST, &builder);
+
+    auto const buffer = makeBuffer("GET /foo HTTP/1.1\r\n"
+                                   "Host: localhost\r\n"
+                                   "Accept: */*\r\n"
+                                   "\r\n"
+                                   "POST /bar HTTP/1.1\r\n"
+                                   "Content-Length: 3\r\n"
+                                   "\r\n"
+                                   "abc");
+    parseAll(parser, builder, { buffer });
+
+    REQUIRE(2 == requests.size());
+    REQUIRE(requests[0].buffer.get() == buffer.get()); // no copy
+    REQUIRE("GET" == requests[0].methodName());
+    REQUIRE("/foo" == requests[0].path());
+    REQUIRE(HttpVersion::VERSION_1_1 == requests[0].version);
+    REQUIRE(2 == requests[0].headerCount);
+    REQUIRE("localhost" == requests[0].header("host"));
+    REQUIRE("*/*" == requests[0].header("Accept"));
+    REQUIRE(requests[0].header("Content-Length").empty());
+
+    REQUIRE(requests[1].buffer.get() == buffer.get());
+    REQUIRE("POST" == requests[1].methodName());
+    REQUIRE("abc" == requests[1].content());
+}
+
+TEST_CASE("ParsedRequest.spanningBuffers")
+{
+    std::vector<ParsedRequest> requests;
+    ParsedRequestBuilder builder([&](ParsedRequest&& request) { requests.emplace_back(std::move(request)); });
+    HttpParser parser(HttpParseMode::REQUEST, &builder);
+
+    auto const first = makeBuffer("PUT /foo HTTP/1.1\r\nX-Sp");
+    auto const second = makeBuffer("lit: value\r\nContent-Length: 6\r\n\r\nabc");
+    auto const third = makeBuffer("def");
+    parseAll(parser, builder, { first, second, third });
+
+    // the bytes are retained beyond the receive buffers being reused
+    std::memset(first->data(), '#', first->size());
+    std::memset(second->data(), '#', second->size());
+    std::memset(third->data(), '#', third->size());
+
+    REQUIRE(1 == requests.size());
+    REQUIRE(requests[0].buffer.get() != first.get());
+    REQUIRE("PUT" == requests[0].methodName());
+    REQUIRE("/foo" == requests[0].path());
+    REQUIRE("value" == requests[0].header("X-Split"));
+    REQUIRE("6" == requests[0].header("Content-Length"));
+    REQUIRE("abcdef" == requests[0].content());
+}
+
+TEST_CASE("ParsedRequest.tooManyHeaders")
+{
+    std::vector<ParsedRequest> requests;
+    int errors = 0;
+    ParsedRequestBuilder builder([&](ParsedRequest&& request) { requests.emplace_back(std::move(request)); },
+                                 [&]() { ++errors; });
+    HttpParser parser(HttpParseMode::REQUEST, &builder);
+
+    std::string input = "GET / HTTP/1.1\r\n";
+    for (size_t i = 0; i <= ParsedRequest::MaxHeaders; ++i)
+        input += "X-Header: " + std::to_string(i) + "\r\n";
+    input += "\r\n";
+    parseAll(parser, builder, { makeBuffer(input) });
+
+    REQUIRE(1 == errors);
+    REQUIRE(requests.empty());
+}
+
+TEST_CASE("SpscQueue.handoff")
+{
+    constexpr size_t RequestCount = 10000;
+
+    SpscQueue<ParsedRequest, 64> queue;
+    std::string const input = "GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    size_t mismatches = 0;
+    std::thread worker([&]() {
+        size_t received = 0;
+        ParsedRequest request;
+        while (received < RequestCount)
+        {
+            if (!queue.tryPop(request))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if (request.path() != "/index.html" || request.header("Host") != "localhost")
+                ++mismatches;
+            ++received;
+        }
+    });
+
+    ParsedRequestBuilder builder([&](ParsedRequest&& request) {
+        while (!queue.tryPush(std::move(request)))
+            std::this_thread::yield();
+    });
+    HttpParser parser(HttpParseMode::REQUEST, &builder);
+
+    HttpBufferRef buffer;
+    for (size_t i = 0; i < RequestCount; ++i)
+    {
+        // receive into a fresh buffer only if the previous one is still retained by a worker
+        if (!buffer.unique())
+            buffer = HttpBuffer::create(4096);
+        std::memcpy(buffer->data(), input.data(), input.size());
+        buffer->resize(input.size());
+        parseAll(parser, builder, { buffer });
+    }
+
+    worker.join();
+    REQUIRE(0 == mismatches);
+    REQUIRE(queue.empty());
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+///
+/// Elements are moved into preallocated slots, so neither side ever allocates. Producer and consumer
+/// indices live on separate cache lines and each side caches the other side's index, touching the shared
+/// one only when the queue appears full (respectively empty).
+///
+/// @tparam T        element type, must be default constructible and move assignable
+/// @tparam Capacity number of slots, must be a power of two
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  public:
+    /// Producer side: moves @p value into the queue.
+    ///
+    /// @retval true  @p value has been enqueued
+    /// @retval false the queue is full, @p value has not been touched
+    bool tryPush(T&& value) noexcept
+    {
+        auto const tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _headCache == Capacity)
+        {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (tail - _headCache == Capacity)
+                return false;
+        }
+
+        _slots[tail & Mask] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side: moves the oldest element out of the queue into @p value.
+    ///
+    /// @retval true  @p value has been assigned
+    /// @retval false the queue is empty
+    bool tryPop(T& value) noexcept
+    {
+        auto const head = _head.load(std::memory_order_relaxed);
+        if (head == _tailCache)
+        {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (head == _tailCache)
+                return false;
+        }
+
+        value = std::move(_slots[head & Mask]);
+        _slots[head & Mask] = T {}; // release whatever the element holds on to right away
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Approximation of the number of queued elements, exact only if both sides are idle.
+    size_t size() const noexcept
+    {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    static constexpr size_t capacity() noexcept { return Capacity; }
+
+  private:
+    static constexpr size_t Mask = Capacity - 1;
+    static constexpr size_t CacheLineSize = 64;
+
+    // consumer owned
+    alignas(CacheLineSize) std::atomic<size_t> _head { 0 };
+    size_t _tailCache = 0;
+
+    // producer owned
+    alignas(CacheLineSize) std::atomic<size_t> _tail { 0 };
+    size_t _headCache = 0;
+
+    alignas(CacheLineSize) std::array<T, Capacity> _slots {};
+};
@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: Apache-2.0
+#include "WebSocketFrameParser.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+#endif
+
+namespace
+{
+
+/// Masks the bytes [i, size) of @p data, with @p i being a multiple of 4. Returns size.
+size_t maskScalar(char* data, size_t i, size_t size, uint8_t const* key) noexcept
+{
+    uint8_t pattern[8];
+    std::memcpy(pattern, key, 4);
+    std::memcpy(pattern + 4, key, 4);
+    uint64_t word;
+    std::memcpy(&word, pattern, 8);
+
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t value;
+        std::memcpy(&value, data + i, 8);
+        value ^= word;
+        std::memcpy(data + i, &value, 8);
+    }
+
+    for (; i < size; ++i)
+        data[i] = static_cast<char>(data[i] ^ key[i % 4]);
+
+    return size;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+/// SSE2 is part of x86-64, so this is the baseline there.
+size_t maskSse2(char* data, size_t size, uint8_t const* key) noexcept
+{
+    int32_t pattern;
+    std::memcpy(&pattern, key, 4);
+    auto const mask = _mm_set1_epi32(pattern);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        auto* const p = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), mask));
+    }
+    return maskScalar(data, i, size, key);
+}
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define WEBSOCKET_MASK_AVX2 1
+
+__attribute__((target("avx2"))) size_t maskAvx2(char* data, size_t size, uint8_t const* key) noexcept
+{
+    int32_t pattern;
+    std::memcpy(&pattern, key, 4);
+    auto const mask = _mm256_set1_epi32(pattern);
+
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        auto* const p = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask));
+        _mm256_storeu_si256(p + 1, _mm256_xor_si256(_mm256_loadu_si256(p + 1), mask));
+    }
+    for (; i + 32 <= size; i += 32)
+    {
+        auto* const p = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask));
+    }
+    return maskScalar(data, i, size, key);
+}
+
+bool hasAvx2() noexcept
+{
+    static bool const supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+} // namespace
+
+std::string_view as_string(WebSocketOpcode opcode) noexcept
+{
+    switch (opcode)
+    {
+        case WebSocketOpcode::Continuation: return "continuation";
+        case WebSocketOpcode::Text: return "text";
+        case WebSocketOpcode::Binary: return "binary";
+        case WebSocketOpcode::Close: return "close";
+        case WebSocketOpcode::Ping: return "ping";
+        case WebSocketOpcode::Pong: return "pong";
+    }
+    return "unknown";
+}
+
+void applyWebSocketMask(std::span<char> payload, WebSocketMaskKey key, uint64_t offset) noexcept
+{
+    // rotate the key so that it starts with the byte applying to payload[0]
+    uint8_t rotated[4];
+    for (size_t j = 0; j < 4; ++j)
+        rotated[j] = key[(offset + j) % 4];
+
+    // short payloads (typical for control frames and chat messages) are not worth any dispatching
+    if (payload.size() < 32)
+    {
+        maskScalar(payload.data(), 0, payload.size(), rotated);
+        return;
+    }
+
+#if defined(WEBSOCKET_MASK_AVX2)
+    if (hasAvx2())
+    {
+        maskAvx2(payload.data(), payload.size(), rotated);
+        return;
+    }
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+    maskSse2(payload.data(), payload.size(), rotated);
+#else
+    maskScalar(payload.data(), 0, payload.size(), rotated);
+#endif
+}
+
+// {{{ WebSocketFrameParser
+void WebSocketFrameParser::reset() noexcept
+{
+    _state = State::Header;
+    _headerSize = 0;
+    _remaining = 0;
+    _offset = 0;
+    _inMessage = false;
+}
+
+void WebSocketFrameParser::fail() noexcept
+{
+    _state = State::Error;
+    _listener->onProtocolError();
+}
+
+bool WebSocketFrameParser::parseHeader() noexcept
+{
+    bool const fin = _header[0] & 0x80;
+    auto const opcode = static_cast<WebSocketOpcode>(_header[0] & 0x0F);
+    bool const masked = _header[1] & 0x80;
+    auto const length7 = _header[1] & 0x7F;
+
+    // no extensions are negotiated, so the reserved bits must not be set
+    if ((_header[0] & 0x70) || masked != _masked)
+        return false;
+
+    size_t position = 2;
+    uint64_t length = length7;
+    if (length7 == 126)
+    {
+        length = (uint64_t(_header[2]) << 8) | _header[3];
+        position = 4;
+    }
+    else if (length7 == 127)
+    {
+        length = 0;
+        for (size_t j = 2; j < 10; ++j)
+            length = (length << 8) | _header[j];
+        if (length >> 63)
+            return false;
+        position = 10;
+    }
+
+    switch (opcode)
+    {
+        case WebSocketOpcode::Continuation:
+            if (!_inMessage)
+                return false;
+            _inMessage = !fin;
+            break;
+        case WebSocketOpcode::Text:
+        case WebSocketOpcode::Binary:
+            if (_inMessage)
+                return false;
+            _inMessage = !fin;
+            break;
+        case WebSocketOpcode::Close:
+        case WebSocketOpcode::Ping:
+        case WebSocketOpcode::Pong:
+            // control frames may be interleaved with fragments, but not be fragmented themselves
+            if (!fin || length > 125)
+                return false;
+            break;
+        default: return false;
+    }
+
+    if (masked)
+        std::copy_n(_header.begin() + position, 4, _key.begin());
+
+    _remaining = length;
+    _offset = 0;
+    _listener->onFrameBegin(opcode, fin, length);
+    return true;
+}
+
+size_t WebSocketFrameParser::parseFragment(std::span<char> chunk) noexcept
+{
+    size_t consumed = 0;
+
+    while (consumed < chunk.size())
+    {
+        switch (_state)
+        {
+            case State::Header: {
+                _header[_headerSize++] = static_cast<uint8_t>(chunk[consumed++]);
+                if (_headerSize < 2)
+                    break;
+
+                auto const length7 = _header[1] & 0x7F;
+                auto const extended = length7 == 126 ? 2 : length7 == 127 ? 8 : 0;
+                auto const keySize = (_header[1] & 0x80) ? 4 : 0;
+                if (_headerSize < size_t(2 + extended + keySize))
+                    break;
+
+                _headerSize = 0;
+                if (!parseHeader())
+                {
+                    fail();
+                    return consumed;
+                }
+
+                if (_remaining == 0)
+                    _listener->onFrameEnd();
+                else
+                    _state = State::Payload;
+                break;
+            }
+            case State::Payload: {
+                auto const n = static_cast<size_t>(std::min<uint64_t>(_remaining, chunk.size() - consumed));
+                auto const payload = chunk.subspan(consumed, n);
+                if (_masked)
+                    applyWebSocketMask(payload, _key, _offset);
+
+                consumed += n;
+                _offset += n;
+                _remaining -= n;
+                _listener->onFramePayload(std::string_view(payload.data(), payload.size()));
+
+                if (_remaining == 0)
+                {
+                    _state = State::Header;
+                    _listener->onFrameEnd();
+                }
+                break;
+            }
+            case State::Error: return consumed;
+        }
+    }
+
+    return consumed;
+}
+// }}}
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+enum class WebSocketOpcode : uint8_t
+{
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xA,
+};
+
+std::string_view as_string(WebSocketOpcode opcode) noexcept;
+
+using WebSocketMaskKey = std::array<uint8_t, 4>;
+
+/// XORs @p payload with @p key in place, i.e. masks or unmasks it (RFC 6455, 5.3).
+///
+/// @param offset position of @p payload within the frame's payload, for continuing across fragments
+void applyWebSocketMask(std::span<char> payload, WebSocketMaskKey key, uint64_t offset = 0) noexcept;
+
+class WebSocketListener // {{{
+{
+  public:
+    virtual ~WebSocketListener() = default;
+
+    /// A frame header has been fully parsed.
+    ///
+    /// @param opcode the frame's opcode
+    /// @param fin    whether or not this is the final fragment of a message
+    /// @param length payload length of this frame
+    virtual void onFrameBegin(WebSocketOpcode opcode, bool fin, uint64_t length) {}
+
+    /// Invoked for every (unmasked) piece of frame payload.
+    virtual void onFramePayload(std::string_view chunk) {}
+
+    /// The current frame is complete.
+    virtual void onFrameEnd() {}
+
+    /// Malformed frame, e.g. reserved bits set or an unmasked frame from a client. The parser stops.
+    virtual void onProtocolError() {}
+}; // }}}
+
+/// Fragment-driven WebSocket (RFC 6455) frame parser.
+///
+/// This is the counterpart of HttpParser for connections that have switched protocols (see
+/// HttpParser::isUpgraded()): it is fed whatever is received after the upgrade request, in pieces of any
+/// size. Payload is unmasked in place and handed to the listener as views into the fed bytes.
+class WebSocketFrameParser
+{
+  public:
+    /// @param listener receives the frames
+    /// @param masked   whether frames are to be masked, i.e. are sent by a client
+    explicit WebSocketFrameParser(WebSocketListener* listener, bool masked = true) noexcept:
+        _listener(listener), _masked(masked)
+    {
+    }
+
+    /// Processes a fragment of received bytes, unmasking payload in place.
+    ///
+    /// @return number of bytes processed, less than @p chunk.size() only on protocol errors.
+    size_t parseFragment(std::span<char> chunk) noexcept;
+
+    void reset() noexcept;
+
+    bool failed() const noexcept { return _state == State::Error; }
+
+  private:
+    enum class State
+    {
+        Header,
+        Payload,
+        Error,
+    };
+
+    bool parseHeader() noexcept;
+    void fail() noexcept;
+
+    WebSocketListener* _listener;
+    bool _masked;
+
+    State _state = State::Header;
+    std::array<uint8_t, 14> _header {}; //!< frame header received so far
+    size_t _headerSize = 0;
+    uint64_t _remaining = 0;            //!< payload bytes of the current frame still to come
+    uint64_t _offset = 0;               //!< payload bytes of the current frame seen so far
+    WebSocketMaskKey _key {};
+    bool _inMessage = false;            //!< a fragmented data message awaits continuation frames
+};
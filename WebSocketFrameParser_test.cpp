@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <catch2/catch_all.hpp>
+
+#include <string>
+#include <vector>
+
+#include "HttpMessageParser.h"
+#include "WebSocketFrameParser.h"
+
+namespace
+{
+
+struct Frame
+{
+    WebSocketOpcode opcode;
+    bool fin;
+    uint64_t length;
+    std::string payload;
+    bool complete = false;
+};
+
+struct FrameCollector: public WebSocketListener
+{
+    std::vector<Frame> frames;
+    int errors = 0;
+
+    void onFrameBegin(WebSocketOpcode opcode, bool fin, uint64_t length) override
+    {
+        frames.push_back(Frame { opcode, fin, length, {} });
+    }
+    void onFramePayload(std::string_view chunk) override { frames.back().payload += chunk; }
+    void onFrameEnd() override { frames.back().complete = true; }
+    void onProtocolError() override { ++errors; }
+};
+
+WebSocketMaskKey const key = { 0x37, 0xfa, 0x21, 0x3d };
+
+std::string frame(WebSocketOpcode opcode, std::string_view payload, bool fin = true, bool masked = true)
+{
+    std::string result;
+    result += static_cast<char>((fin ? 0x80 : 0) | static_cast<int>(opcode));
+
+    auto const maskBit = masked ? 0x80 : 0;
+    if (payload.size() < 126)
+        result += static_cast<char>(maskBit | payload.size());
+    else if (payload.size() <= 0xFFFF)
+    {
+        result += static_cast<char>(maskBit | 126);
+        result += static_cast<char>(payload.size() >> 8);
+        result += static_cast<char>(payload.size() & 0xFF);
+    }
+    else
+    {
+        result += static_cast<char>(maskBit | 127);
+        for (int shift = 56; shift >= 0; shift -= 8)
+            result += static_cast<char>((uint64_t(payload.size()) >> shift) & 0xFF);
+    }
+
+    if (!masked)
+        return result + std::string(payload);
+
+    result.append(reinterpret_cast<char const*>(key.data()), key.size());
+    std::string body(payload);
+    for (size_t i = 0; i < body.size(); ++i)
+        body[i] = static_cast<char>(body[i] ^ key[i % 4]);
+    return result + body;
+}
+
+std::string pattern(size_t size)
+{
+    std::string result(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        result[i] = static_cast<char>('a' + i % 26);
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("WebSocketFrameParser.mask")
+{
+    // every length and offset, covering the vectorized paths and their tails
+    for (size_t size = 0; size < 200; ++size)
+    {
+        for (uint64_t offset = 0; offset < 4; ++offset)
+        {
+            auto data = pattern(size);
+            applyWebSocketMask(data, key, offset);
+
+            size_t mismatches = 0;
+            for (size_t i = 0; i < size; ++i)
+                if (static_cast<char>(data[i] ^ key[(offset + i) % 4]) != static_cast<char>('a' + i % 26))
+                    ++mismatches;
+            REQUIRE(0 == mismatches);
+        }
+    }
+}
+
+TEST_CASE("WebSocketFrameParser.frames")
+{
+    auto const large = pattern(70000);
+    auto const input = frame(WebSocketOpcode::Text, "Hello, ", false) + frame(WebSocketOpcode::Ping, "")
+                       + frame(WebSocketOpcode::Continuation, "World!") + frame(WebSocketOpcode::Binary, pattern(300))
+                       + frame(WebSocketOpcode::Binary, large) + frame(WebSocketOpcode::Close, "\x03\xe8");
+
+    for (size_t const fragmentSize: { size_t(1), size_t(3), size_t(7), size_t(64), size_t(1000), input.size() })
+    {
+        auto buffer = input;
+        FrameCollector collector;
+        WebSocketFrameParser parser(&collector);
+
+        for (size_t offset = 0; offset < buffer.size(); offset += fragmentSize)
+        {
+            auto const n = std::min(fragmentSize, buffer.size() - offset);
+            REQUIRE(n == parser.parseFragment(std::span<char>(buffer.data() + offset, n)));
+        }
+
+        INFO("fragment size " << fragmentSize);
+        REQUIRE(0 == collector.errors);
+        REQUIRE(6 == collector.frames.size());
+        REQUIRE(WebSocketOpcode::Text == collector.frames[0].opcode);
+        REQUIRE(!collector.frames[0].fin);
+        REQUIRE("Hello, " == collector.frames[0].payload);
+        REQUIRE(WebSocketOpcode::Ping == collector.frames[1].opcode);
+        REQUIRE(collector.frames[1].complete);
+        REQUIRE(WebSocketOpcode::Continuation == collector.frames[2].opcode);
+        REQUIRE("World!" == collector.frames[2].payload);
+        REQUIRE(300 == collector.frames[3].length);
+        REQUIRE(pattern(300) == collector.frames[3].payload);
+        REQUIRE(70000 == collector.frames[4].length);
+        REQUIRE(large == collector.frames[4].payload);
+        REQUIRE(WebSocketOpcode::Close == collector.frames[5].opcode);
+        REQUIRE(collector.frames[5].complete);
+    }
+}
+
+TEST_CASE("WebSocketFrameParser.afterUpgrade")
+{
+    struct: HttpListener
+    {
+    } httpListener;
+    HttpParser httpParser(HttpParseMode::REQUEST, &httpListener);
+
+    auto input = std::string("GET /chat HTTP/1.1\r\n"
+                             "Upgrade: websocket\r\n"
+                             "Connection: Upgrade\r\n"
+                             "\r\n")
+                 + frame(WebSocketOpcode::Text, "hi");
+
+    auto const n = httpParser.parseFragment(input);
+    REQUIRE(httpParser.isUpgraded());
+
+    FrameCollector collector;
+    WebSocketFrameParser parser(&collector);
+    parser.parseFragment(std::span<char>(input).subspan(n));
+
+    REQUIRE(1 == collector.frames.size());
+    REQUIRE("hi" == collector.frames[0].payload);
+    REQUIRE("hi" == std::string_view(input).substr(input.size() - 2)); // unmasked in place
+}
+
+TEST_CASE("WebSocketFrameParser.protocolErrors")
+{
+    auto const fails = [](std::string input, bool masked = true) {
+        FrameCollector collector;
+        WebSocketFrameParser parser(&collector, masked);
+        parser.parseFragment(input);
+        return parser.failed() && collector.errors == 1;
+    };
+
+    REQUIRE(fails(frame(WebSocketOpcode::Text, "unmasked", true, false)));
+    REQUIRE(fails(frame(WebSocketOpcode::Text, "masked by a server"), false));
+    REQUIRE(fails(frame(WebSocketOpcode::Continuation, "nothing to continue")));
+    REQUIRE(fails(frame(WebSocketOpcode::Text, "a", false) + frame(WebSocketOpcode::Text, "b")));
+    REQUIRE(fails(frame(WebSocketOpcode::Ping, pattern(126))));
+    REQUIRE(fails(frame(WebSocketOpcode::Ping, "", false)));
+    REQUIRE(fails("\xC1\x80" + std::string(4, '\0'))); // RSV1 without extensions
+    REQUIRE(fails("\x83\x80" + std::string(4, '\0'))); // reserved opcode
+
+    REQUIRE(!fails(frame(WebSocketOpcode::Text, "from the server", true, false), false));
+}
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: Apache-2.0
+//
+// Parses a file of concatenated raw HTTP/1 messages (a capture or a replay log) on all cores, using
+// HttpCaptureParser, and reports message counts and throughput.
+//
+// By default every worker thread counts the messages it replays on its own. With --ordered, all events
+// are delivered to a single listener in file order instead.
+//
+// Usage: example-capture-parse [--ordered] [--responses] [--threads N] [--chunk-size BYTES] FILE
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "HttpCaptureParser.h"
+
+namespace
+{
+
+struct alignas(64) Counter final: public HttpListener
+{
+    size_t messages = 0;
+    size_t headers = 0;
+    size_t contentBytes = 0;
+    size_t errors = 0;
+
+    void onMessageHeader(std::string_view, std::string_view) override { ++headers; }
+    void onMessageContent(std::string_view chunk) override { contentBytes += chunk.size(); }
+    void onMessageEnd() override { ++messages; }
+    void onProtocolError() override { ++errors; }
+
+    Counter& operator+=(Counter const& other) noexcept
+    {
+        messages += other.messages;
+        headers += other.headers;
+        contentBytes += other.contentBytes;
+        errors += other.errors;
+        return *this;
+    }
+};
+
+void usage(char const* program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [--ordered] [--responses] [--threads N] [--chunk-size BYTES] FILE\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    auto ordered = false;
+    auto mode = HttpParseMode::REQUEST;
+    unsigned threads = 0;
+    size_t chunkSize = HttpCaptureParser::DefaultChunkSize;
+    char const* path = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto const arg = std::string_view(argv[i]);
+        if (arg == "--ordered")
+            ordered = true;
+        else if (arg == "--responses")
+            mode = HttpParseMode::RESPONSE;
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--chunk-size" && i + 1 < argc)
+            chunkSize = std::strtoull(argv[++i], nullptr, 10);
+        else if (!path && !arg.starts_with("-"))
+            path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!path)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        auto const capture = HttpCaptureParser::open(path, mode);
+        capture->setChunkSize(chunkSize);
+        capture->setThreadCount(threads);
+
+        auto const start = std::chrono::steady_clock::now();
+
+        Counter total;
+        HttpCaptureResult result;
+        if (ordered)
+            result = capture->parse(total);
+        else
+        {
+            std::vector<Counter> counters(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u));
+            result = capture->parseUnordered([&](unsigned thread) -> HttpListener& { return counters[thread]; });
+            for (auto const& counter: counters)
+                total += counter;
+        }
+
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("%zu messages, %zu headers, %zu content bytes\n", total.messages, total.headers, total.contentBytes);
+        std::printf("%zu of %zu bytes parsed in %.3f s (%.1f MB/s), %zu chunks, %zu re-synchronized\n",
+                    result.bytesParsed,
+                    capture->bytes().size(),
+                    seconds,
+                    seconds > 0 ? static_cast<double>(result.bytesParsed) / seconds / 1e6 : 0.0,
+                    result.chunks,
+                    result.resynchronized);
+
+        if (result.failed)
+        {
+            std::fprintf(stderr, "protocol error at offset %zu\n", result.bytesParsed);
+            return EXIT_FAILURE;
+        }
+    }
+    catch (std::system_error const& error)
+    {
+        std::fprintf(stderr, "%s\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: Apache-2.0
+//
+// Reference HTTP/1 server, driving HttpParser straight from recv() buffers.
+//
+// Every worker thread is pinned to one core and owns its own listener socket (bound with SO_REUSEPORT,
+// so the kernel load-balances incoming connections), its own epoll loop and its own pool of
+// connections. Nothing is shared between workers.
+//
+// Every request is answered with the same canned response. Responses to pipelined requests are
+// collected and flushed with a single send() per receive batch.
+//
+// Usage: example-epoll-server [ADDRESS [PORT [WORKERS]]]
+//
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+#include "ServerCommon.h"
+
+namespace
+{
+
+constexpr size_t ReceiveBufferSize = 64 * 1024;
+constexpr int MaxEvents = 256;
+
+class Connection final: public example::CannedResponder
+{
+  public:
+    void open(int fd) noexcept
+    {
+        _fd = fd;
+        _outputOffset = 0;
+        reset();
+    }
+
+    int fd() const noexcept { return _fd; }
+    bool hasPendingOutput() const noexcept { return _outputOffset < _output.size(); }
+
+    /// Writes as much pending output as the socket takes without blocking.
+    void flush() noexcept
+    {
+        while (hasPendingOutput())
+        {
+            auto const rv =
+                ::send(_fd, _output.data() + _outputOffset, _output.size() - _outputOffset, MSG_NOSIGNAL);
+            if (rv < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    _closing = true;
+                    _outputOffset = _output.size(); // nothing more can be written
+                }
+                return;
+            }
+            _outputOffset += static_cast<size_t>(rv);
+        }
+        _output.clear();
+        _outputOffset = 0;
+    }
+
+  private:
+    int _fd = -1;
+    size_t _outputOffset = 0;
+};
+
+class Worker
+{
+  public:
+    Worker(sockaddr_in address, unsigned cpu): _address(address), _cpu(cpu) {}
+    ~Worker();
+
+    bool open();
+    void run();
+
+  private:
+    void acceptAll();
+    void handle(Connection* connection, uint32_t events);
+    void close(Connection* connection);
+
+    sockaddr_in _address;
+    unsigned _cpu;
+    int _listenFd = -1;
+    int _epollFd = -1;
+
+    std::vector<std::unique_ptr<Connection>> _connections; // owns every connection ever created
+    std::vector<Connection*> _freeConnections;              // pool of closed connections to reuse
+    std::vector<char> _receiveBuffer = std::vector<char>(ReceiveBufferSize);
+};
+
+Worker::~Worker()
+{
+    for (auto& connection: _connections)
+        if (connection->fd() >= 0)
+            ::close(connection->fd());
+    if (_epollFd >= 0)
+        ::close(_epollFd);
+    if (_listenFd >= 0)
+        ::close(_listenFd);
+}
+
+bool Worker::open()
+{
+    _listenFd = example::openListener(_address, SOCK_NONBLOCK);
+    if (_listenFd < 0)
+        return false;
+
+    _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (_epollFd < 0)
+        return false;
+
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr; // the listener is the only entry without a connection
+    return ::epoll_ctl(_epollFd, EPOLL_CTL_ADD, _listenFd, &event) == 0;
+}
+
+void Worker::run()
+{
+    example::pinToCpu(_cpu);
+
+    epoll_event events[MaxEvents];
+    for (;;)
+    {
+        int const count = ::epoll_wait(_epollFd, events, MaxEvents, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::perror("epoll_wait");
+            return;
+        }
+
+        for (int k = 0; k < count; ++k)
+        {
+            if (events[k].data.ptr == nullptr)
+                acceptAll();
+            else
+                handle(static_cast<Connection*>(events[k].data.ptr), events[k].events);
+        }
+    }
+}
+
+void Worker::acceptAll()
+{
+    for (;;)
+    {
+        int const fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return; // EAGAIN, or the peer is already gone
+
+        int const on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        Connection* connection = nullptr;
+        if (!_freeConnections.empty())
+        {
+            connection = _freeConnections.back();
+            _freeConnections.pop_back();
+        }
+        else
+            connection = _connections.emplace_back(std::make_unique<Connection>()).get();
+
+        connection->open(fd);
+
+        epoll_event event {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = connection;
+        if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+            close(connection);
+    }
+}
+
+void Worker::handle(Connection* connection, uint32_t events)
+{
+    if (events & (EPOLLERR | EPOLLHUP))
+    {
+        close(connection);
+        return;
+    }
+
+    // Edge triggered: drain the socket, parsing every batch right out of the shared receive buffer.
+    // The parser carries over partial tokens itself, so the buffer can be reused on the next recv().
+    if (events & (EPOLLIN | EPOLLRDHUP))
+    {
+        for (;;)
+        {
+            auto const n = ::recv(connection->fd(), _receiveBuffer.data(), _receiveBuffer.size(), 0);
+            if (n > 0)
+            {
+                connection->process(std::string_view(_receiveBuffer.data(), static_cast<size_t>(n)));
+                connection->flush();
+                if (connection->closing())
+                    break;
+            }
+            else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            else
+            {
+                close(connection); // EOF or error
+                return;
+            }
+        }
+    }
+    else if (events & EPOLLOUT)
+        connection->flush();
+
+    if (connection->closing() && !connection->hasPendingOutput())
+        close(connection);
+}
+
+void Worker::close(Connection* connection)
+{
+    ::close(connection->fd()); // also removes it from the epoll set
+    connection->open(-1);
+    _freeConnections.push_back(connection);
+}
+
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    auto const options = example::parseCommandLine(argc, argv);
+    if (!options)
+        return EXIT_FAILURE;
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned cpu = 0; cpu < options->workerCount; ++cpu)
+    {
+        auto& worker = workers.emplace_back(std::make_unique<Worker>(options->address, cpu));
+        if (!worker->open())
+        {
+            std::perror("listen");
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::thread> threads;
+    for (auto& worker: workers)
+        threads.emplace_back([&worker]() { worker->run(); });
+
+    for (auto& thread: threads)
+        thread.join();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: Apache-2.0
+//
+// Bits shared by the example servers.
+//
+#pragma once
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "HttpMessageParser.h"
+
+namespace example
+{
+
+constexpr std::string_view CannedResponse = "HTTP/1.1 200 OK\r\n"
+                                            "Server: http-message-parser\r\n"
+                                            "Content-Type: text/plain\r\n"
+                                            "Content-Length: 13\r\n"
+                                            "\r\n"
+                                            "Hello, World!";
+
+constexpr std::string_view ContinueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
+
+constexpr std::string_view BadRequestResponse = "HTTP/1.1 400 Bad Request\r\n"
+                                                "Connection: close\r\n"
+                                                "Content-Length: 0\r\n"
+                                                "\r\n";
+
+/// Parses requests and answers every one of them with the canned response.
+///
+/// Responses to pipelined requests are appended to output(), so that they can be written all at once.
+class CannedResponder: public HttpListener
+{
+  public:
+    CannedResponder(): _parser(HttpParseMode::REQUEST, this) {}
+
+    void reset() noexcept
+    {
+        _parser.reset();
+        _output.clear();
+        _closing = false;
+    }
+
+    /// Feeds received bytes into the parser, which may contain any number of pipelined requests.
+    ///
+    /// @return number of bytes consumed, which is less than @p data.size() only on protocol errors.
+    size_t process(std::string_view data) noexcept
+    {
+        size_t consumed = 0;
+        while (consumed < data.size() && !_closing)
+        {
+            consumed += _parser.parseFragment(data.substr(consumed));
+            if (_parser.state() == HttpParserState::PROTOCOL_ERROR)
+                break;
+            if (_parser.isUpgraded())
+                _parser.reset(); // upgrades are declined by answering with the canned response
+        }
+        return consumed;
+    }
+
+    /// Whether or not the connection is to be closed once output() has been written.
+    bool closing() const noexcept { return _closing; }
+
+    std::string& output() noexcept { return _output; }
+
+    bool onExpectContinue() override
+    {
+        _output += ContinueResponse; // written along with whatever is answered in this batch
+        return true;
+    }
+
+    void onMessageEnd() override
+    {
+        _output += CannedResponse;
+        if (!_parser.shouldKeepAlive())
+            _closing = true;
+    }
+
+    void onProtocolError() override
+    {
+        _output += BadRequestResponse;
+        _closing = true;
+    }
+
+  protected:
+    HttpParser _parser;
+    std::string _output;
+    bool _closing = false;
+};
+
+struct ServerOptions
+{
+    sockaddr_in address {};
+    unsigned workerCount = 1;
+};
+
+/// Parses the common command line: [ADDRESS [PORT [WORKERS]]]
+inline std::optional<ServerOptions> parseCommandLine(int argc, char const* argv[])
+{
+    char const* const host = argc > 1 ? argv[1] : "127.0.0.1";
+    int const port = argc > 2 ? std::atoi(argv[2]) : 8080;
+
+    ServerOptions options;
+    options.workerCount =
+        argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+    options.address.sin_family = AF_INET;
+    options.address.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, host, &options.address.sin_addr) != 1 || port <= 0 || options.workerCount == 0)
+    {
+        std::fprintf(stderr, "Usage: %s [ADDRESS [PORT [WORKERS]]]\n", argv[0]);
+        return std::nullopt;
+    }
+
+    std::printf("Listening on http://%s:%d/ with %u worker(s).\n", host, port, options.workerCount);
+    return options;
+}
+
+/// Creates a listener socket that shares its port with the other workers' listeners.
+///
+/// @return the listener's file descriptor or -1 on failure.
+inline int openListener(sockaddr_in const& address, int flags)
+{
+    int const fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | flags, 0);
+    if (fd < 0)
+        return -1;
+
+    int const on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0
+        || ::bind(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) < 0
+        || ::listen(fd, SOMAXCONN) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+inline void pinToCpu(unsigned cpu)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+    ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+}
+
+} // namespace example
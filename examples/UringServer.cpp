@@ -0,0 +1,423 @@
+// SPDX-License-Identifier: Apache-2.0
+//
+// Reference HTTP/1 server on io_uring, handing provided buffers straight to HttpParser.
+//
+// Same setup as the epoll server (one pinned worker per core, each with its own SO_REUSEPORT
+// listener), but every worker drives a single io_uring:
+//
+// - connections are accepted with one multishot accept,
+// - every connection has one multishot recv armed, picking its buffers from a ring of
+//   provided buffers shared by all connections of the worker,
+// - a completed buffer is parsed in place and handed back to the kernel as soon as the parser
+//   reports all of its bytes consumed. Tokens straddling two buffers are carried over by the
+//   parser, so no buffer is ever held on to beyond its completion.
+//
+// Requires liburing >= 2.4 and Linux >= 6.0.
+//
+// Usage: example-uring-server [ADDRESS [PORT [WORKERS]]]
+//
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <liburing.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+#include "ServerCommon.h"
+
+namespace
+{
+
+constexpr unsigned RingEntries = 1024;
+constexpr unsigned BufferCount = 1024; // must be a power of two
+constexpr unsigned BufferSize = 16 * 1024;
+constexpr unsigned short BufferGroup = 0;
+
+enum class Operation : uintptr_t
+{
+    Accept = 0,
+    Receive = 1,
+    Send = 2,
+};
+
+constexpr uintptr_t OperationMask = 0x3;
+
+class Connection final: public example::CannedResponder
+{
+  public:
+    void open(int fd) noexcept
+    {
+        _fd = fd;
+        _sending.clear();
+        _sendOffset = 0;
+        receiving = false;
+        sendInFlight = false;
+        peerClosed = false;
+        reset();
+    }
+
+    int fd() const noexcept { return _fd; }
+
+    /// Moves the pending output into the send buffer, unless a send is in flight already.
+    ///
+    /// @return the bytes to send next, or an empty view if there is nothing to do.
+    std::string_view nextSend() noexcept
+    {
+        if (sendInFlight || peerClosed)
+            return {};
+
+        if (_sendOffset == _sending.size())
+        {
+            _sending.clear();
+            _sendOffset = 0;
+            std::swap(_sending, _output);
+        }
+
+        return std::string_view(_sending).substr(_sendOffset);
+    }
+
+    void sent(size_t n) noexcept { _sendOffset += n; }
+
+    bool hasPendingOutput() const noexcept { return _sendOffset < _sending.size() || !_output.empty(); }
+
+    void close() noexcept { _closing = true; }
+
+    bool idle() const noexcept { return !receiving && !sendInFlight; }
+
+    bool receiving = false;    //!< a multishot recv is armed
+    bool sendInFlight = false; //!< a send is submitted but not yet completed
+    bool peerClosed = false;   //!< the peer has gone, there's no point in sending anything anymore
+
+  private:
+    int _fd = -1;
+    std::string _sending; //!< output currently being sent (pipelined requests append to _output meanwhile)
+    size_t _sendOffset = 0;
+};
+
+class Worker
+{
+  public:
+    Worker(sockaddr_in address, unsigned cpu): _address(address), _cpu(cpu) {}
+    ~Worker();
+
+    bool open();
+    void run();
+
+  private:
+    bool setupRing();
+    io_uring_sqe* nextSqe();
+    void armAccept();
+    void armReceive(Connection* connection);
+    void trySend(Connection* connection);
+
+    void onAccept(io_uring_cqe const* cqe);
+    void onReceive(Connection* connection, io_uring_cqe const* cqe);
+    void onSend(Connection* connection, io_uring_cqe const* cqe);
+
+    void recycleBuffer(unsigned bufferId);
+    void settle(Connection* connection);
+
+    char* buffer(unsigned bufferId) noexcept { return _buffers.get() + size_t(bufferId) * BufferSize; }
+
+    sockaddr_in _address;
+    unsigned _cpu;
+    int _listenFd = -1;
+
+    io_uring _ring {};
+    bool _ringInitialized = false;
+    io_uring_buf_ring* _bufferRing = nullptr;
+    std::unique_ptr<char[]> _buffers;
+    unsigned _recycledBuffers = 0; //!< buffers handed back since the last io_uring_buf_ring_advance()
+
+    std::vector<std::unique_ptr<Connection>> _connections; // owns every connection ever created
+    std::vector<Connection*> _freeConnections;              // pool of closed connections to reuse
+};
+
+Worker::~Worker()
+{
+    for (auto& connection: _connections)
+        if (connection->fd() >= 0)
+            ::close(connection->fd());
+
+    if (_bufferRing)
+        io_uring_free_buf_ring(&_ring, _bufferRing, BufferCount, BufferGroup);
+    if (_ringInitialized)
+        io_uring_queue_exit(&_ring);
+    if (_listenFd >= 0)
+        ::close(_listenFd);
+}
+
+bool Worker::open()
+{
+    _listenFd = example::openListener(_address, 0);
+    return _listenFd >= 0;
+}
+
+/// Sets up the ring from within the worker thread, as with IORING_SETUP_SINGLE_ISSUER only that one
+/// may submit.
+bool Worker::setupRing()
+{
+    io_uring_params params {};
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    if (io_uring_queue_init_params(RingEntries, &_ring, &params) < 0)
+    {
+        // older kernel, go without the optimizations
+        params = {};
+        if (io_uring_queue_init_params(RingEntries, &_ring, &params) < 0)
+            return false;
+    }
+    _ringInitialized = true;
+
+    int rv = 0;
+    _bufferRing = io_uring_setup_buf_ring(&_ring, BufferCount, BufferGroup, 0, &rv);
+    if (!_bufferRing)
+        return false;
+
+    _buffers = std::make_unique<char[]>(size_t(BufferCount) * BufferSize);
+    for (unsigned bufferId = 0; bufferId < BufferCount; ++bufferId)
+        io_uring_buf_ring_add(_bufferRing,
+                              buffer(bufferId),
+                              BufferSize,
+                              static_cast<unsigned short>(bufferId),
+                              io_uring_buf_ring_mask(BufferCount),
+                              static_cast<int>(bufferId));
+    io_uring_buf_ring_advance(_bufferRing, BufferCount);
+
+    armAccept();
+    return true;
+}
+
+void Worker::run()
+{
+    example::pinToCpu(_cpu);
+
+    if (!setupRing())
+    {
+        std::fprintf(stderr, "Failed to set up io_uring with a provided buffer ring.\n");
+        return;
+    }
+
+    for (;;)
+    {
+        int const rv = io_uring_submit_and_wait(&_ring, 1);
+        if (rv < 0 && rv != -EINTR)
+        {
+            std::fprintf(stderr, "io_uring_submit_and_wait: %s\n", std::strerror(-rv));
+            return;
+        }
+
+        unsigned head = 0;
+        unsigned count = 0;
+        io_uring_cqe* cqe = nullptr;
+        io_uring_for_each_cqe(&_ring, head, cqe)
+        {
+            ++count;
+            auto const userData = static_cast<uintptr_t>(io_uring_cqe_get_data64(cqe));
+            auto* const connection = reinterpret_cast<Connection*>(userData & ~OperationMask);
+            switch (static_cast<Operation>(userData & OperationMask))
+            {
+                case Operation::Accept: onAccept(cqe); break;
+                case Operation::Receive: onReceive(connection, cqe); break;
+                case Operation::Send: onSend(connection, cqe); break;
+            }
+        }
+        io_uring_cq_advance(&_ring, count);
+
+        if (_recycledBuffers)
+        {
+            io_uring_buf_ring_advance(_bufferRing, static_cast<int>(_recycledBuffers));
+            _recycledBuffers = 0;
+        }
+    }
+}
+
+io_uring_sqe* Worker::nextSqe()
+{
+    io_uring_sqe* sqe = io_uring_get_sqe(&_ring);
+    while (!sqe)
+    {
+        // submission queue is full, make room
+        io_uring_submit(&_ring);
+        sqe = io_uring_get_sqe(&_ring);
+    }
+    return sqe;
+}
+
+void Worker::armAccept()
+{
+    io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_multishot_accept(sqe, _listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    io_uring_sqe_set_data64(sqe, static_cast<uint64_t>(Operation::Accept));
+}
+
+void Worker::armReceive(Connection* connection)
+{
+    io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_recv_multishot(sqe, connection->fd(), nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BufferGroup;
+    io_uring_sqe_set_data64(sqe,
+                            reinterpret_cast<uintptr_t>(connection) | static_cast<uintptr_t>(Operation::Receive));
+    connection->receiving = true;
+}
+
+void Worker::trySend(Connection* connection)
+{
+    auto const bytes = connection->nextSend();
+    if (bytes.empty())
+        return;
+
+    io_uring_sqe* sqe = nextSqe();
+    io_uring_prep_send(sqe, connection->fd(), bytes.data(), bytes.size(), MSG_NOSIGNAL);
+    io_uring_sqe_set_data64(sqe,
+                            reinterpret_cast<uintptr_t>(connection) | static_cast<uintptr_t>(Operation::Send));
+    connection->sendInFlight = true;
+}
+
+void Worker::onAccept(io_uring_cqe const* cqe)
+{
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        armAccept();
+
+    if (cqe->res < 0)
+        return;
+
+    int const fd = cqe->res;
+    int const on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    Connection* connection = nullptr;
+    if (!_freeConnections.empty())
+    {
+        connection = _freeConnections.back();
+        _freeConnections.pop_back();
+    }
+    else
+        connection = _connections.emplace_back(std::make_unique<Connection>()).get();
+
+    connection->open(fd);
+    armReceive(connection);
+}
+
+void Worker::onReceive(Connection* connection, io_uring_cqe const* cqe)
+{
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        connection->receiving = false;
+
+    if (cqe->flags & IORING_CQE_F_BUFFER)
+    {
+        auto const bufferId = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (cqe->res > 0 && !connection->closing())
+            connection->process(std::string_view(buffer(bufferId), static_cast<size_t>(cqe->res)));
+
+        // Either fully consumed or the connection is failing, so the kernel may have it back right away.
+        recycleBuffer(bufferId);
+        trySend(connection);
+    }
+    else if (cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS))
+    {
+        // EOF or a socket error. (-ENOBUFS only means the buffer ring ran dry for a moment.)
+        connection->peerClosed = true;
+        connection->close();
+    }
+
+    if (!connection->receiving && !connection->closing())
+        armReceive(connection);
+
+    settle(connection);
+}
+
+void Worker::onSend(Connection* connection, io_uring_cqe const* cqe)
+{
+    connection->sendInFlight = false;
+
+    if (cqe->res < 0)
+    {
+        connection->peerClosed = true;
+        connection->close();
+    }
+    else
+    {
+        connection->sent(static_cast<size_t>(cqe->res));
+        trySend(connection);
+    }
+
+    settle(connection);
+}
+
+void Worker::recycleBuffer(unsigned bufferId)
+{
+    io_uring_buf_ring_add(_bufferRing,
+                          buffer(bufferId),
+                          BufferSize,
+                          static_cast<unsigned short>(bufferId),
+                          io_uring_buf_ring_mask(BufferCount),
+                          static_cast<int>(_recycledBuffers++));
+}
+
+/// Tears a closing connection down step by step, as it must not be reused before its last completion.
+void Worker::settle(Connection* connection)
+{
+    if (!connection->closing() || connection->fd() < 0)
+        return;
+
+    if (connection->hasPendingOutput() && !connection->peerClosed)
+        return; // still flushing the final response(s)
+
+    if (connection->receiving)
+    {
+        // wakes up the armed recv with EOF, which then completes without IORING_CQE_F_MORE
+        ::shutdown(connection->fd(), SHUT_RDWR);
+        return;
+    }
+
+    if (!connection->idle())
+        return;
+
+    ::close(connection->fd());
+    connection->open(-1);
+    _freeConnections.push_back(connection);
+}
+
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    auto const options = example::parseCommandLine(argc, argv);
+    if (!options)
+        return EXIT_FAILURE;
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned cpu = 0; cpu < options->workerCount; ++cpu)
+    {
+        auto& worker = workers.emplace_back(std::make_unique<Worker>(options->address, cpu));
+        if (!worker->open())
+        {
+            std::perror("listen");
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::thread> threads;
+    for (auto& worker: workers)
+        threads.emplace_back([&worker]() { worker->run(); });
+
+    for (auto& thread: threads)
+        thread.join();
+
+    return EXIT_SUCCESS;
+}